@@ -0,0 +1,387 @@
+//	Times the phases of the solver separately on the bundled maps and on generated mazes
+//
+//	Usage: benchmark_suite [options]
+//		--repetitions=N			runs of every case(default 5)
+//		--sizes=1,4,16			sizes of the generated mazes in megapixels
+//		--full					sizes from 1 up to 400 megapixels
+//		--densities=0.05,0.2,0.4	wall densities of the generated mazes
+//		--keys=0,2,8			numbers of keys(and doors) of the generated mazes
+//		--ends=1,4				numbers of ending zones of the generated mazes
+//		--images=DIR			directory with the bundled maps(default ./images)
+//		--out=FILE				writes the results to FILE instead of the standard output
+//		--baseline=FILE			compares the medians with a file written by --out
+//		--tolerance=0.25			allowed slowdown before a phase counts as a regression
+//
+//	Every parameter of the generated mazes is swept separately, the others keep their
+//	first value. The results are JSON, one case per line, with the median and the
+//	99th percentile of every phase in milliseconds, the nodes expanded by the search
+//	and the peak resident memory of the process after the case.
+//	Exits with 1 if a phase is slower than in the baseline
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include "../src/Image.h"
+#include "../src/ImageInfo.h"
+#include "../src/PathFinder.h"
+#include "SyntheticMaze.h"
+
+namespace {
+
+const char *const PHASES[] = { "load", "analyze", "findPath", "drawPath", "save" };
+const size_t PHASE_COUNT = sizeof(PHASES) / sizeof(PHASES[0]);
+
+//	Differences below this are noise for the baseline comparison(ms)
+const double NOISE_FLOOR = 1.0;
+
+struct Options {
+	size_t repetitions = 5;
+	std::vector<double> sizes = { 1, 4, 16 };
+	std::vector<double> densities = { 0.05, 0.2, 0.4 };
+	std::vector<double> keys = { 0, 2, 8 };
+	std::vector<double> ends = { 1, 4 };
+	std::string images = "./images";
+	std::string out;
+	std::string baseline;
+	double tolerance = 0.25;
+};
+
+struct CaseResult {
+	std::string name;
+	size_t pixels = 0;
+	size_t nodesExpanded = 0;
+	long peakRssKb = 0;
+	bool solved = false;
+	double median[PHASE_COUNT] = {};
+	double p99[PHASE_COUNT] = {};
+};
+
+std::vector<double> parseList(const std::string &value) {
+	std::vector<double> result;
+	std::stringstream stream(value);
+	std::string item;
+
+	while (std::getline(stream, item, ',')) {
+		result.push_back(std::stod(item));
+	}
+
+	return result;
+}
+
+//	Returns *false* if the argument is not valid
+bool parseArgument(const std::string &arg, Options &options) {
+	const size_t eq = arg.find('=');
+	const std::string name = arg.substr(0, eq);
+	const std::string value = eq == std::string::npos ? std::string() : arg.substr(eq + 1);
+
+	if (name == "--repetitions") {
+		options.repetitions = std::max<size_t>(1, std::stoul(value));
+	}
+	else if (name == "--sizes") {
+		options.sizes = parseList(value);
+	}
+	else if (name == "--full") {
+		options.sizes = { 1, 4, 16, 64, 100, 400 };
+	}
+	else if (name == "--densities") {
+		options.densities = parseList(value);
+	}
+	else if (name == "--keys") {
+		options.keys = parseList(value);
+	}
+	else if (name == "--ends") {
+		options.ends = parseList(value);
+	}
+	else if (name == "--images") {
+		options.images = value;
+	}
+	else if (name == "--out") {
+		options.out = value;
+	}
+	else if (name == "--baseline") {
+		options.baseline = value;
+	}
+	else if (name == "--tolerance") {
+		options.tolerance = std::stod(value);
+	}
+	else {
+		std::cout << "Unknown option: " << arg << '\n';
+		return false;
+	}
+
+	return !options.sizes.empty() && !options.densities.empty() && !options.keys.empty() && !options.ends.empty();
+}
+
+//	Peak resident memory of the process in kilobytes, 0 if it is not known
+long peakRssKb() {
+#if defined(__APPLE__)
+	rusage usage;
+	return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss / 1024 : 0;
+#elif defined(__unix__)
+	rusage usage;
+	return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;
+#else
+	return 0;
+#endif
+}
+
+double elapsedMs(std::chrono::steady_clock::time_point begin) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+//	Nearest rank percentile of sorted values
+double percentile(const std::vector<double> &sorted, double p) {
+	const size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+	return sorted[std::max<size_t>(rank, 1) - 1];
+}
+
+//	Runs every phase on the image *repetitions* times. Returns *false* if the image cannot be loaded
+bool runCase(const std::string &name, const std::string &path, size_t repetitions, CaseResult &result) {
+	const std::string outPath = "benchmark_suite_output.bmp";
+	std::vector<double> times[PHASE_COUNT];
+
+	result.name = name;
+
+	for (size_t i = 0; i < repetitions; ++i) {
+		auto begin = std::chrono::steady_clock::now();
+		Image img(path);
+		if (!img.loadImage()) {
+			std::cout << "Could not load " << path << '\n';
+			return false;
+		}
+		times[0].push_back(elapsedMs(begin));
+
+		begin = std::chrono::steady_clock::now();
+		ImageInfo info(std::move(img));
+		info.analyzeImage();
+		times[1].push_back(elapsedMs(begin));
+
+		begin = std::chrono::steady_clock::now();
+		PathFinder finder(info);
+		result.solved = finder.findPath();
+		times[2].push_back(elapsedMs(begin));
+
+		//	There is nothing to draw for mazes without a solution
+		begin = std::chrono::steady_clock::now();
+		if (result.solved) {
+			finder.drawPath();
+		}
+		times[3].push_back(elapsedMs(begin));
+
+		begin = std::chrono::steady_clock::now();
+		info.getImage().saveImage(outPath);
+		times[4].push_back(elapsedMs(begin));
+
+		result.pixels = info.getImage().size();
+		result.nodesExpanded = finder.expandedNodes();
+	}
+
+	for (size_t phase = 0; phase < PHASE_COUNT; ++phase) {
+		std::sort(times[phase].begin(), times[phase].end());
+		result.median[phase] = percentile(times[phase], 0.5);
+		result.p99[phase] = percentile(times[phase], 0.99);
+	}
+
+	result.peakRssKb = peakRssKb();
+	std::remove(outPath.c_str());
+	return true;
+}
+
+//	Generates the maze, runs it and removes the generated file
+bool runGenerated(const SyntheticMazeParams &params, double megapixels, size_t repetitions, CaseResult &result) {
+	char name[96];
+	std::snprintf(name, sizeof(name), "gen-%gmp-d%.2f-k%u-e%u", megapixels, params.wallDensity, params.keys, params.ends);
+
+	const std::string path = std::string("benchmark_suite_") + name + ".bmp";
+	if (!writeBmp(path, generateSyntheticMaze(params), params.width, params.height)) {
+		std::cout << "Could not generate " << path << '\n';
+		return false;
+	}
+
+	const bool loaded = runCase(name, path, repetitions, result);
+	std::remove(path.c_str());
+
+	return loaded;
+}
+
+void writeResults(std::ostream &stream, const std::vector<CaseResult> &results) {
+	stream << "{\"cases\": [\n";
+
+	for (size_t i = 0; i < results.size(); ++i) {
+		const auto &r = results[i];
+		stream << "{\"name\": \"" << r.name << "\", \"pixels\": " << r.pixels << ", \"solved\": " << (r.solved ? "true" : "false")
+			<< ", \"nodesExpanded\": " << r.nodesExpanded << ", \"peakRssKb\": " << r.peakRssKb << ", \"phases\": {";
+
+		for (size_t phase = 0; phase < PHASE_COUNT; ++phase) {
+			char times[64];
+			std::snprintf(times, sizeof(times), "{\"median\": %.3f, \"p99\": %.3f}", r.median[phase], r.p99[phase]);
+			stream << (phase ? ", " : "") << '"' << PHASES[phase] << "\": " << times;
+		}
+
+		stream << "}}" << (i + 1 < results.size() ? "," : "") << '\n';
+	}
+
+	stream << "]}\n";
+}
+
+//	Reads the medians from a file written by writeResults(one case per line)
+bool readBaseline(const std::string &path, std::map<std::string, std::vector<double>> &medians) {
+	std::ifstream ifile(path);
+	if (!ifile) {
+		return false;
+	}
+
+	std::string line;
+	while (std::getline(ifile, line)) {
+		const size_t nameBegin = line.find("{\"name\": \"");
+		if (nameBegin == std::string::npos) {
+			continue;
+		}
+
+		const size_t nameEnd = line.find('"', nameBegin + 10);
+		auto &values = medians[line.substr(nameBegin + 10, nameEnd - nameBegin - 10)];
+
+		for (size_t phase = 0; phase < PHASE_COUNT; ++phase) {
+			const std::string key = std::string("\"") + PHASES[phase] + "\": {\"median\": ";
+			const size_t pos = line.find(key);
+			values.push_back(pos == std::string::npos ? -1.0 : std::stod(line.substr(pos + key.size())));
+		}
+	}
+
+	return true;
+}
+
+//	Returns the number of phases slower than the baseline
+size_t compareWithBaseline(const std::vector<CaseResult> &results, const std::map<std::string, std::vector<double>> &baseline, double tolerance) {
+	size_t regressions = 0;
+
+	for (const auto &r : results) {
+		const auto iter = baseline.find(r.name);
+		if (iter == baseline.end()) {
+			std::cout << r.name << ": not in the baseline\n";
+			continue;
+		}
+
+		for (size_t phase = 0; phase < PHASE_COUNT; ++phase) {
+			const double base = iter->second[phase];
+			if (base < 0.0) {
+				continue;
+			}
+
+			if (r.median[phase] > base * (1.0 + tolerance) && r.median[phase] - base > NOISE_FLOOR) {
+				std::printf("%s %s: %.3f ms, baseline %.3f ms(+%.1f%%)\n", r.name.c_str(), PHASES[phase],
+					r.median[phase], base, 100.0 * (r.median[phase] / base - 1.0));
+				++regressions;
+			}
+		}
+	}
+
+	return regressions;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	Options options;
+
+	for (int i = 1; i < argc; ++i) {
+		//	Numeric values are parsed with std::stoul and std::stod, which throw on invalid input
+		try {
+			if (!parseArgument(argv[i], options)) {
+				return 1;
+			}
+		}
+		catch (std::exception &) {
+			std::cout << "Invalid value: " << argv[i] << '\n';
+			return 1;
+		}
+	}
+
+	std::vector<CaseResult> results;
+
+	//	The bundled maps
+	const char *const maps[] = { "example", "map1", "map2", "map3", "map4" };
+	for (const auto &map : maps) {
+		CaseResult result;
+		if (runCase(map, options.images + "/" + map + ".bmp", options.repetitions, result)) {
+			results.push_back(result);
+		}
+	}
+
+	//	Generated mazes, one parameter swept at a time around the first values
+	std::vector<std::pair<SyntheticMazeParams, double>> cases;
+	const auto addCase = [&](double megapixels, double density, double keys, double ends) {
+		SyntheticMazeParams params;
+		params.width = static_cast<uint32_t>(std::sqrt(megapixels * 1e6));
+		params.height = params.width;
+		params.wallDensity = density;
+		params.keys = static_cast<uint32_t>(keys);
+		params.ends = static_cast<uint32_t>(ends);
+		params.seed = 42;
+		cases.push_back(std::make_pair(params, megapixels));
+	};
+
+	for (const auto size : options.sizes) {
+		addCase(size, options.densities[0], options.keys[0], options.ends[0]);
+	}
+	for (size_t i = 1; i < options.densities.size(); ++i) {
+		addCase(options.sizes[0], options.densities[i], options.keys[0], options.ends[0]);
+	}
+	for (size_t i = 1; i < options.keys.size(); ++i) {
+		addCase(options.sizes[0], options.densities[0], options.keys[i], options.ends[0]);
+	}
+	for (size_t i = 1; i < options.ends.size(); ++i) {
+		addCase(options.sizes[0], options.densities[0], options.keys[0], options.ends[i]);
+	}
+
+	for (const auto &c : cases) {
+		CaseResult result;
+		if (!runGenerated(c.first, c.second, options.repetitions, result)) {
+			return 1;
+		}
+
+		results.push_back(result);
+	}
+
+	if (options.out.empty()) {
+		writeResults(std::cout, results);
+	}
+	else {
+		std::ofstream ofile(options.out);
+		writeResults(ofile, results);
+
+		if (!ofile) {
+			std::cout << "Could not write " << options.out << '\n';
+			return 1;
+		}
+	}
+
+	if (!options.baseline.empty()) {
+		std::map<std::string, std::vector<double>> baseline;
+		if (!readBaseline(options.baseline, baseline)) {
+			std::cout << "Could not read " << options.baseline << '\n';
+			return 1;
+		}
+
+		const size_t regressions = compareWithBaseline(results, baseline, options.tolerance);
+		std::cout << regressions << " regression(s) against " << options.baseline << '\n';
+
+		return regressions > 0 ? 1 : 0;
+	}
+
+	return 0;
+}
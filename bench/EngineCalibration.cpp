@@ -0,0 +1,303 @@
+//	Fits the model of EngineSelector to the times of the engines on generated mazes
+//
+//	Usage: engine_calibration [options]
+//		--repetitions=N			runs of every engine(default 3)
+//		--size=N				side of the generated mazes in pixels, half and twice as large ones are
+//								generated too(default 1024)
+//		--out=FILE				writes the model to FILE(default engine_model.txt)
+//
+//	The mazes are corridor mazes of tools/GenerateMaze.cpp with corridors from 1 to 160 pixels and
+//	maps of bench/SyntheticMaze.cpp with wall densities from 1% to 45%, with several sizes, keys and
+//	ending zones. Every maze is searched
+//	with every engine and connectivity, and log(time / time of A*) of JPS and of the flood is
+//	fitted to the features of EngineSelector with least squares. Prints the median times and the
+//	engine the model chooses for every maze, and how much slower the choices are than the fastest
+//	engines. Pass the model to the solver with --engine-model=FILE
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/EngineSelector.h"
+#include "../src/ImageInfo.h"
+#include "../src/MazeGenerator.h"
+#include "../src/PathFinder.h"
+#include "SyntheticMaze.h"
+
+namespace {
+
+const SearchPolicy::Engine ENGINES[] = { SearchPolicy::Engine::JPS, SearchPolicy::Engine::ASTAR, SearchPolicy::Engine::FLOOD };
+const SearchPolicy::Connectivity CONNECTIVITIES[] = { SearchPolicy::Connectivity::EIGHT, SearchPolicy::Connectivity::EIGHT_STRICT, SearchPolicy::Connectivity::FOUR };
+
+//	Keeps the coefficients of the fit small where the mazes say little about them
+const double RIDGE = 1e-3;
+
+struct Options {
+	size_t repetitions = 3;
+	uint32_t size = 1024;
+	std::string out = "engine_model.txt";
+};
+
+//	Times of a maze, [connectivity][engine] in ms
+struct Sample {
+	std::string name;
+	ImageInfo::Statistics statistics;
+	double times[3][3] = {};
+};
+
+//	Returns *false* if the argument is not valid
+bool parseArgument(const std::string &arg, Options &options) {
+	const size_t eq = arg.find('=');
+	const std::string name = arg.substr(0, eq);
+	const std::string value = eq == std::string::npos ? std::string() : arg.substr(eq + 1);
+
+	if (name == "--repetitions") {
+		options.repetitions = std::max<size_t>(1, std::stoul(value));
+	}
+	else if (name == "--size") {
+		options.size = static_cast<uint32_t>(std::stoul(value));
+	}
+	else if (name == "--out") {
+		options.out = value;
+	}
+	else {
+		std::cout << "Unknown option: " << arg << '\n';
+		return false;
+	}
+
+	return true;
+}
+
+//	Loads the maze, removes the file and times every engine. Returns *false* if it cannot be loaded
+bool runCase(const std::string &name, const std::string &path, size_t repetitions, Sample &sample) {
+	Image img(path);
+	const bool loaded = img.loadImage();
+	std::remove(path.c_str());
+
+	if (!loaded) {
+		std::cout << "Could not load " << path << '\n';
+		return false;
+	}
+
+	ImageInfo info(std::move(img));
+	info.analyzeImage();
+
+	sample.name = name;
+	sample.statistics = info.statistics();
+
+	for (const auto connectivity : CONNECTIVITIES) {
+		for (const auto engine : ENGINES) {
+			std::vector<double> times;
+
+			for (size_t i = 0; i < repetitions; ++i) {
+				SearchPolicy::Movement movement;
+				movement.connectivity = connectivity;
+
+				PathFinder finder(info);
+				finder.setMovement(movement);
+				finder.setEngine(engine);
+
+				const auto begin = std::chrono::steady_clock::now();
+				finder.findPath();
+				times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+			}
+
+			std::sort(times.begin(), times.end());
+			sample.times[static_cast<size_t>(connectivity)][static_cast<size_t>(engine)] = std::max(times[times.size() / 2], 0.01);
+		}
+	}
+
+	return true;
+}
+
+//	Least squares with a small ridge, solved with Gaussian elimination on the normal equations
+void fit(const std::vector<Sample> &samples, SearchPolicy::Connectivity connectivity, SearchPolicy::Engine engine, double (&coefficients)[EngineSelector::FEATURES]) {
+	const size_t n = EngineSelector::FEATURES;
+	double a[EngineSelector::FEATURES][EngineSelector::FEATURES + 1] = {};
+
+	for (const auto &sample : samples) {
+		double values[EngineSelector::FEATURES];
+		EngineSelector::features(sample.statistics, values);
+
+		const auto &times = sample.times[static_cast<size_t>(connectivity)];
+		const double target = std::log(times[static_cast<size_t>(engine)] / times[static_cast<size_t>(SearchPolicy::Engine::ASTAR)]);
+
+		for (size_t i = 0; i < n; ++i) {
+			for (size_t j = 0; j < n; ++j) {
+				a[i][j] += values[i] * values[j];
+			}
+
+			a[i][n] += values[i] * target;
+		}
+	}
+
+	//	The intercept is not held back
+	for (size_t i = 1; i < n; ++i) {
+		a[i][i] += RIDGE * samples.size();
+	}
+
+	for (size_t col = 0; col < n; ++col) {
+		size_t pivot = col;
+		for (size_t row = col + 1; row < n; ++row) {
+			if (std::abs(a[row][col]) > std::abs(a[pivot][col])) {
+				pivot = row;
+			}
+		}
+
+		std::swap(a[col], a[pivot]);
+
+		for (size_t row = 0; row < n; ++row) {
+			if (row != col && a[col][col] != 0.0) {
+				const double factor = a[row][col] / a[col][col];
+
+				for (size_t k = col; k <= n; ++k) {
+					a[row][k] -= factor * a[col][k];
+				}
+			}
+		}
+	}
+
+	for (size_t i = 0; i < n; ++i) {
+		coefficients[i] = a[i][i] != 0.0 ? a[i][n] / a[i][i] : 0.0;
+	}
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	Options options;
+
+	for (int i = 1; i < argc; ++i) {
+		//	Numeric values are parsed with std::stoul, which throws on invalid input
+		try {
+			if (!parseArgument(argv[i], options)) {
+				return 1;
+			}
+		}
+		catch (std::exception &) {
+			std::cout << "Invalid value: " << argv[i] << '\n';
+			return 1;
+		}
+	}
+
+	std::vector<Sample> samples;
+	const std::string path = "engine_calibration.bmp";
+
+	//	The sizes, the keys and the ending zones go round, every kind of maze gets several of them
+	const uint32_t sizes[] = { options.size / 2, options.size, options.size * 2 };
+	size_t round = 0;
+
+	//	Corridor mazes, from twisty to open, and mazes of large rooms with thin walls
+	const uint32_t corridors[][2] = { {1, 1}, {2, 1}, {3, 2}, {4, 4}, {6, 2}, {8, 8}, {12, 3}, {16, 4}, {24, 2}, {32, 6}, {48, 3}, {64, 2},
+		{96, 2}, {128, 1}, {160, 3} };
+
+	for (const auto &corridor : corridors) {
+		MazeGenerator::Params params;
+		//	The rooms need a few cells for the keys and the ending zones
+		params.width = std::max(sizes[round % 3], 12 * (corridor[0] + corridor[1]));
+		params.height = params.width;
+		params.corridor = corridor[0];
+		params.wall = corridor[1];
+		params.depth = static_cast<uint32_t>(1 + round % 4);
+		params.ends = static_cast<uint32_t>(1 + round % 3);
+		params.seed = 42;
+		++round;
+
+		char name[64];
+		std::snprintf(name, sizeof(name), "maze-c%u-w%u-%u", corridor[0], corridor[1], params.width);
+
+		Sample sample;
+
+		//	MazeGenerator throws if the maze is too small for the options
+		try {
+			if (!MazeGenerator(params).saveImage(path) || !runCase(name, path, options.repetitions, sample)) {
+				return 1;
+			}
+		}
+		catch (std::exception &x) {
+			std::cout << name << " is skipped: " << x.what() << '\n';
+			continue;
+		}
+
+		samples.push_back(sample);
+	}
+
+	//	Open maps with scattered blocks
+	const double densities[] = { 0.01, 0.03, 0.05, 0.1, 0.2, 0.3, 0.4, 0.45 };
+
+	for (const auto density : densities) {
+		SyntheticMazeParams params;
+		params.width = sizes[round % 3];
+		params.height = params.width;
+		params.wallDensity = density;
+		params.keys = static_cast<uint32_t>(round % 4);
+		params.ends = static_cast<uint32_t>(1 + round % 3);
+		params.seed = 42;
+		++round;
+
+		char name[64];
+		std::snprintf(name, sizeof(name), "map-d%.2f-%u", density, params.width);
+
+		Sample sample;
+		if (!writeBmp(path, generateSyntheticMaze(params), params.width, params.height) || !runCase(name, path, options.repetitions, sample)) {
+			return 1;
+		}
+
+		samples.push_back(sample);
+	}
+
+	EngineSelector selector;
+
+	for (const auto connectivity : CONNECTIVITIES) {
+		for (const auto engine : { SearchPolicy::Engine::JPS, SearchPolicy::Engine::FLOOD }) {
+			double coefficients[EngineSelector::FEATURES];
+			fit(samples, connectivity, engine, coefficients);
+			selector.setCoefficients(engine, connectivity, coefficients);
+		}
+	}
+
+	//	The scale of the predicted times, for the weight under a time limit
+	std::vector<double> astarNs;
+	for (const auto &sample : samples) {
+		const double freePixels = static_cast<double>(std::max<uint64_t>(sample.statistics.pixels - sample.statistics.walls, 1));
+		astarNs.push_back(sample.times[0][static_cast<size_t>(SearchPolicy::Engine::ASTAR)] * 1e6 / freePixels);
+	}
+
+	std::sort(astarNs.begin(), astarNs.end());
+	selector.setAstarNs(astarNs[astarNs.size() / 2]);
+
+	//	How the choices of the model compare with the fastest engines and with JPS everywhere
+	double chosenMs = 0.0, fastestMs = 0.0, jpsMs = 0.0;
+
+	std::printf("%-20s %-9s %10s %10s %10s  %s\n", "maze", "moves", "jps", "astar", "flood", "chosen");
+
+	for (const auto &sample : samples) {
+		for (const auto connectivity : CONNECTIVITIES) {
+			SearchPolicy::Movement movement;
+			movement.connectivity = connectivity;
+
+			const auto &times = sample.times[static_cast<size_t>(connectivity)];
+			const auto choice = selector.choose(sample.statistics, movement, 0, 1);
+
+			chosenMs += times[static_cast<size_t>(choice.engine)];
+			fastestMs += *std::min_element(std::begin(times), std::end(times));
+			jpsMs += times[static_cast<size_t>(SearchPolicy::Engine::JPS)];
+
+			std::printf("%-20s %-9s %10.2f %10.2f %10.2f  %s\n", sample.name.c_str(), EngineSelector::connectivityName(connectivity),
+				times[0], times[1], times[2], EngineSelector::engineName(choice.engine));
+		}
+	}
+
+	std::printf("total: chosen %.1f ms, fastest %.1f ms, jps %.1f ms\n", chosenMs, fastestMs, jpsMs);
+
+	if (!selector.save(options.out)) {
+		std::cout << "Could not write " << options.out << '\n';
+		return 1;
+	}
+
+	return 0;
+}
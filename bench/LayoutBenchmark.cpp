@@ -0,0 +1,153 @@
+//	Compares the ROW_MAJOR, TILED and RLE layouts of Image on an open map
+//
+//	Usage: layout_benchmark [width] [height] [repetitions]
+//
+//	The workloads mimic the scans of PathFinder::jump:
+//		straight - horizontal and vertical scans until a wall is hit
+//		diagonal - diagonal scans until a wall is hit
+//		mixed    - diagonal scans with a horizontal and a vertical scan from every step
+//		solve    - ImageInfo::analyzeImage + PathFinder::findPath on the whole map
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/Image.h"
+#include "../src/ImageInfo.h"
+#include "../src/PathFinder.h"
+#include "SyntheticMaze.h"
+
+namespace {
+
+//	Scans from (x, y) in direction (dx, dy) until a wall or the border is reached.
+//	Returns the number of visited pixels
+size_t scan(const Image &img, Point::dim_t x, Point::dim_t y, Point::dim_t dx, Point::dim_t dy) {
+	size_t visited = 0;
+
+	while (x >= 0 && x < img.height() && y >= 0 && y < img.width() && img.pixel(Point{ x, y }) != Pixel::BLACK) {
+		++visited;
+		x += dx;
+		y += dy;
+	}
+
+	return visited;
+}
+
+//	Returns the median time of the runs in milliseconds
+double measure(size_t repetitions, const std::function<size_t()> &workload, size_t &checksum) {
+	std::vector<double> times;
+
+	for (size_t i = 0; i < repetitions; ++i) {
+		const auto begin = std::chrono::steady_clock::now();
+		checksum += workload();
+		const auto end = std::chrono::steady_clock::now();
+
+		times.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+	}
+
+	std::sort(times.begin(), times.end());
+	return times[times.size() / 2];
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	const uint32_t width = argc > 1 ? std::stoul(argv[1]) : 4096;
+	const uint32_t height = argc > 2 ? std::stoul(argv[2]) : 4096;
+	const size_t repetitions = argc > 3 ? std::stoul(argv[3]) : 5;
+
+	const std::string path = "layout_benchmark.bmp";
+	SyntheticMazeParams params;
+	params.width = width;
+	params.height = height;
+	params.wallDensity = 0.2;
+	params.seed = 42;
+
+	if (!writeBmp(path, generateSyntheticMaze(params), width, height)) {
+		std::cout << "Could not generate the benchmark map!\n";
+		return 1;
+	}
+
+	//	Scans start from the same random points for every layout
+	std::mt19937 rng(7);
+	std::vector<Point> starts;
+	for (size_t i = 0; i < 2048; ++i) {
+		starts.push_back(Point{ static_cast<Point::dim_t>(rng() % height), static_cast<Point::dim_t>(rng() % width) });
+	}
+
+	const Point::dim_t dirs[4][2] = { {1,1}, {1,-1}, {-1,1}, {-1,-1} };
+
+	const std::pair<Image::Layout, const char *> layouts[] = {
+		{ Image::Layout::ROW_MAJOR, "row-major" },
+		{ Image::Layout::TILED, "tiled" },
+		{ Image::Layout::RLE, "rle" }
+	};
+
+	std::printf("%ux%u, median of %zu runs(ms)\n", width, height, repetitions);
+	std::printf("%-10s %10s %10s %10s %10s\n", "layout", "straight", "diagonal", "mixed", "solve");
+
+	for (const auto &layout : layouts) {
+		Image img(path);
+		img.setLayout(layout.first);
+
+		if (!img.loadImage()) {
+			return 1;
+		}
+
+		size_t checksum = 0;
+
+		const double straight = measure(repetitions, [&]() {
+			size_t visited = 0;
+			for (const auto &p : starts) {
+				visited += scan(img, p.x(), p.y(), 0, 1) + scan(img, p.x(), p.y(), 0, -1);
+				visited += scan(img, p.x(), p.y(), 1, 0) + scan(img, p.x(), p.y(), -1, 0);
+			}
+			return visited;
+		}, checksum);
+
+		const double diagonal = measure(repetitions, [&]() {
+			size_t visited = 0;
+			for (const auto &p : starts) {
+				for (const auto &d : dirs) {
+					visited += scan(img, p.x(), p.y(), d[0], d[1]);
+				}
+			}
+			return visited;
+		}, checksum);
+
+		const double mixed = measure(repetitions, [&]() {
+			size_t visited = 0;
+			for (size_t i = 0; i < starts.size(); i += 16) {
+				const auto &d = dirs[i % 4];
+				Point::dim_t x = starts[i].x();
+				Point::dim_t y = starts[i].y();
+
+				while (x >= 0 && x < img.height() && y >= 0 && y < img.width() && img.pixel(Point{ x, y }) != Pixel::BLACK) {
+					visited += scan(img, x, y, d[0], 0) + scan(img, x, y, 0, d[1]);
+					x += d[0];
+					y += d[1];
+				}
+			}
+			return visited;
+		}, checksum);
+
+		const double solve = measure(repetitions, [&]() {
+			ImageInfo info(img);
+			info.analyzeImage();
+
+			PathFinder finder(info);
+			return static_cast<size_t>(finder.findPath());
+		}, checksum);
+
+		std::printf("%-10s %10.2f %10.2f %10.2f %10.2f   (checksum %zu)\n", layout.second, straight, diagonal, mixed, solve, checksum);
+	}
+
+	std::remove(path.c_str());
+	return 0;
+}
@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include "SyntheticMaze.h"
+#include "../src/MazeGenerator.h"
+
+namespace {
+
+const uint32_t BLOCK = 6;		//	Side of the wall blocks, they are placed every 2 * BLOCK pixels
+const uint32_t KEY = 20;		//	Side of the keys
+const uint32_t DOOR = 3;		//	Thickness of the door bands
+const uint32_t ZONE = 10;		//	Side of the starting and ending zones
+
+void fill(std::vector<Pixel::pxl_t> &pixels, uint32_t width, uint32_t x, uint32_t y, uint32_t rows, uint32_t cols, Pixel::pxl_t value) {
+	for (uint32_t i = x; i < x + rows; ++i) {
+		std::fill_n(pixels.begin() + static_cast<size_t>(i) * width + y, cols, value);
+	}
+}
+
+} // namespace
+
+std::vector<Pixel::pxl_t> generateSyntheticMaze(const SyntheticMazeParams &params) {
+	const uint32_t width = params.width;
+	const uint32_t height = params.height;
+
+	std::vector<Pixel::pxl_t> pixels(static_cast<size_t>(width) * height, Pixel::WHITE);
+	std::mt19937 rng(params.seed);
+	std::uniform_real_distribution<double> chance(0.0, 1.0);
+
+	//	Wall blocks never touch each other, so every white pixel stays reachable
+	for (uint32_t x = BLOCK; x + BLOCK <= height; x += BLOCK * 2) {
+		for (uint32_t y = BLOCK; y + BLOCK <= width; y += BLOCK * 2) {
+			if (chance(rng) < params.wallDensity) {
+				fill(pixels, width, x, y, BLOCK, BLOCK, Pixel::BLACK);
+			}
+		}
+	}
+
+	//	Regions between the door bands, every one of them must fit a key
+	const uint32_t keys = std::min(params.keys, width / (KEY + DOOR * 4) - 1);
+	const uint32_t regions = keys + 1;
+	const uint32_t regionWidth = width / regions;
+
+	for (uint32_t key = 0; key < keys; ++key) {
+		const Pixel::pxl_t color = MazeGenerator::keyColor(key + 1);
+
+		//	The door closes the right side of region *key*
+		const uint32_t door = (key + 1) * regionWidth - DOOR;
+		fill(pixels, width, 0, door, height, DOOR, color);
+
+		//	The key is in the middle of the region, surrounded by white pixels
+		const uint32_t x = (height - KEY) / 2;
+		const uint32_t y = key * regionWidth + (regionWidth - KEY) / 2;
+		fill(pixels, width, x - 1, y - 1, KEY + 2, KEY + 2, Pixel::WHITE);
+		fill(pixels, width, x, y, KEY, KEY, color);
+	}
+
+	fill(pixels, width, 0, 0, ZONE, ZONE, Pixel::START);
+
+	//	Ending zones along the right border of the last region, from the bottom up
+	for (uint32_t end = 0; end < params.ends; ++end) {
+		const uint32_t x = height - ZONE - std::min(height - ZONE, end * (height / std::max(1u, params.ends)));
+		fill(pixels, width, x, width - ZONE, ZONE, ZONE, Pixel::END);
+	}
+
+	return pixels;
+}
+
+bool writeBmp(const std::string &path, const std::vector<Pixel::pxl_t> &pixels, uint32_t width, uint32_t height) {
+	std::ofstream ofile(path, std::ios::binary | std::ios::trunc);
+	if (!ofile) {
+		return false;
+	}
+
+	const uint32_t padding = (4 - (width * 3) % 4) % 4;
+	const uint32_t dataSize = (width * 3 + padding) * height;
+
+	const uint16_t magic = 0x4D42;
+	const uint32_t fileHeader[] = { 54 + dataSize, 0, 54 };
+	const uint32_t infoHeader[] = { 40, width, height, 0x00180001, 0, dataSize, 0, 0, 0, 0 };
+
+	ofile.write((const char *)&magic, sizeof(magic));
+	ofile.write((const char *)fileHeader, sizeof(fileHeader));
+	ofile.write((const char *)infoHeader, sizeof(infoHeader));
+
+	//	Rows are stored bottom-up
+	std::vector<uint8_t> row(width * 3 + padding, 0);
+	for (uint32_t r = 0; r < height; ++r) {
+		const Pixel::pxl_t *src = &pixels[static_cast<size_t>(height - r - 1) * width];
+
+		for (uint32_t c = 0; c < width; ++c) {
+			row[c * 3] = static_cast<uint8_t>(src[c]);
+			row[c * 3 + 1] = static_cast<uint8_t>(src[c] >> 8);
+			row[c * 3 + 2] = static_cast<uint8_t>(src[c] >> 16);
+		}
+
+		ofile.write((const char *)row.data(), row.size());
+	}
+
+	return ofile.good();
+}
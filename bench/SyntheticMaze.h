@@ -0,0 +1,30 @@
+#pragma once
+#ifndef SYNTHETIC_MAZE_HEADER
+#define SYNTHETIC_MAZE_HEADER
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../src/Pixel.h"
+
+//	Parameters of a generated benchmark map
+struct SyntheticMazeParams {
+	uint32_t width = 1024;
+	uint32_t height = 1024;
+	double wallDensity = 0.1;	//	Probability of a wall block on every lattice cell
+	uint32_t keys = 0;			//	Every key opens a door band across the whole map
+	uint32_t ends = 1;
+	uint32_t seed = 1;
+};
+
+//	Builds a map with square wall blocks on a lattice, so it is always solvable.
+//	The map is split in keys + 1 vertical regions by door bands, the key of every door
+//	lies in the region before it, the starting zone is in the first region and the
+//	ending zones are in the last one. Returns the pixels row after row
+std::vector<Pixel::pxl_t> generateSyntheticMaze(const SyntheticMazeParams &params);
+
+//	Writes pixels(row after row) as a 24 bits per pixel .bmp file
+bool writeBmp(const std::string &path, const std::vector<Pixel::pxl_t> &pixels, uint32_t width, uint32_t height);
+
+#endif // !SYNTHETIC_MAZE_HEADER
@@ -0,0 +1,60 @@
+#include <cstdint>
+#include "Arena.h"
+
+Arena::Arena(size_t blockSize)
+	: m_blockSize(blockSize)
+	, m_current(0)
+	, m_offset(0) {
+
+}
+
+void Arena::reset() {
+	m_current = 0;
+	m_offset = 0;
+}
+
+size_t Arena::capacity() const {
+	size_t bytes = 0;
+
+	for (const auto &block : m_blocks) {
+		bytes += block.size;
+	}
+
+	return bytes;
+}
+
+void* Arena::do_allocate(size_t bytes, size_t alignment) {
+	if (bytes > m_blockSize / 4) {
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+
+	//	The blocks are used in order, a block that is too small is skipped until the next reset
+	for (; m_current < m_blocks.size(); ++m_current, m_offset = 0) {
+		const Block &block = m_blocks[m_current];
+		const uintptr_t begin = reinterpret_cast<uintptr_t>(block.data.get());
+		const uintptr_t aligned = (begin + m_offset + alignment - 1) / alignment * alignment;
+
+		if (aligned + bytes <= begin + block.size) {
+			m_offset = aligned + bytes - begin;
+			return reinterpret_cast<void*>(aligned);
+		}
+	}
+
+	//	The blocks are kept for the largest solve, so the next one does not need a new block
+	m_blocks.push_back(Block{ std::unique_ptr<unsigned char[]>(new unsigned char[m_blockSize]), m_blockSize });
+
+	m_current = m_blocks.size() - 1;
+	m_offset = 0;
+
+	return do_allocate(bytes, alignment);
+}
+
+void Arena::do_deallocate(void *block, size_t bytes, size_t alignment) {
+	if (bytes > m_blockSize / 4) {
+		std::pmr::new_delete_resource()->deallocate(block, bytes, alignment);
+	}
+}
+
+bool Arena::do_is_equal(const std::pmr::memory_resource &other) const noexcept {
+	return this == &other;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#ifndef ARENA_CLASS_HEADER
+#define ARENA_CLASS_HEADER
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+//	Monotonic memory for the transient objects of a solve. Freeing does nothing, reset() frees
+//	everything at once and keeps the blocks, so the next solve takes its memory from them.
+//	Allocations larger than a quarter of a block are not monotonic, they are freed right away
+class Arena : public std::pmr::memory_resource {
+public:
+	explicit Arena(size_t blockSize = 1u << 20);
+	Arena(const Arena &r) = delete;
+	Arena& operator=(const Arena &rhs) = delete;
+	~Arena() = default;
+
+public:
+	//	Frees every allocation, the objects in the arena must be destroyed already
+	void reset();
+
+	//	Bytes in the blocks
+	size_t capacity() const;
+
+private:
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void *block, size_t bytes, size_t alignment) override;
+	bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+
+private:
+	struct Block {
+		std::unique_ptr<unsigned char[]> data;
+		size_t size;
+	};
+
+	size_t m_blockSize;
+	std::vector<Block> m_blocks;
+	size_t m_current;		//	Block the allocations are taken from
+	size_t m_offset;		//	First free byte of the current block
+};
+
+#endif // !ARENA_CLASS_HEADER
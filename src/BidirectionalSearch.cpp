@@ -0,0 +1,216 @@
+#include <algorithm>
+#include "BidirectionalSearch.h"
+
+namespace {
+	//	Binary heap with the lowest priority on top
+	template <typename Entry>
+	struct Greater {
+		bool operator()(const Entry &lhs, const Entry &rhs) const { return lhs.priority > rhs.priority; }
+	};
+}
+
+BidirectionalSearch::BidirectionalSearch()
+	: m_finder(nullptr), m_best(SearchState::NO_COST), m_target{ -1, -1 }, m_source{ -1, -1 } {
+
+}
+
+bool BidirectionalSearch::applies(const PathFinder &finder) {
+	for (const auto &key : finder.m_imgData->getKeys()) {
+		if (!finder.hasKey(key.first)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+BidirectionalSearch::Result BidirectionalSearch::run(PathFinder &finder, const Point &start, double weight) {
+	const auto &image = finder.m_imgData->getImage();
+	const auto mode = image.compact() ? SearchState::Mode::SPARSE : SearchState::Mode::DENSE;
+
+	m_finder = &finder;
+	m_best = SearchState::NO_COST;
+	m_target = Point{ -1, -1 };
+	m_source = Point{ -1, -1 };
+
+	//	The backward side steps to the next pixels and through the ending zones, with the same doors
+	m_backward.m_imgData = finder.m_imgData;
+	m_backward.m_inventory = finder.m_inventory;
+	m_backward.m_movement = finder.m_movement;
+	m_backward.m_engine = SearchPolicy::Engine::FLOOD;
+	m_backward.m_passEnds = true;
+	m_backward.m_stats = SearchStats();
+
+	m_forwardState.reset(mode, image.width(), image.size());
+	m_backwardState.reset(mode, image.width(), image.size());
+	m_forwardOpen.clear();
+	m_backwardOpen.clear();
+
+	const auto &ends = finder.m_imgData->getEnds();
+	m_backward.m_readBounds = PathFinder::Bounds{ ends.front().x(), ends.front().y(), ends.front().x(), ends.front().y() };
+
+	//	Every ending zone is flooded from one of its pixels, the steps inside a zone cost nothing
+	for (const auto &end : ends) {
+		m_backward.m_readBounds.include(end.x(), end.y());
+		m_backwardState.set(end, end, 0);
+		m_backwardOpen.push_back(Entry{ 0, 0, 0, end });
+	}
+
+	m_forwardState.set(start, start, 0);
+	pushForward(start, 0, finder.closestKeyCost(start), weight);
+
+	Result result;
+
+	while (!m_forwardOpen.empty()) {
+		//	Every priority is a lower bound of the paths through its point
+		if (m_best != SearchState::NO_COST && m_best <= m_forwardOpen.front().priority) {
+			break;
+		}
+
+		if (finder.outOfBudget()) {
+			result.interrupted = true;
+			break;
+		}
+
+		if (!m_backwardOpen.empty() && m_backwardOpen.size() < m_forwardOpen.size()) {
+			expandBackward();
+		}
+		else {
+			expandForward(weight);
+		}
+	}
+
+	finder.m_readBounds.include(m_backward.m_readBounds.minX, m_backward.m_readBounds.minY);
+	finder.m_readBounds.include(m_backward.m_readBounds.maxX, m_backward.m_readBounds.maxY);
+	finder.m_stats.addCounters(m_backward.m_stats);
+
+	if (result.interrupted || m_best == SearchState::NO_COST) {
+		return result;
+	}
+
+	result.found = true;
+	result.target = m_target;
+	result.source = m_source;
+
+	return result;
+}
+
+Point BidirectionalSearch::parent(const Point &point) const {
+	return m_forwardState.parent(point);
+}
+
+void BidirectionalSearch::expandForward(double weight) {
+	PathFinder &finder = *m_finder;
+
+	const Entry entry = m_forwardOpen.front();
+	std::pop_heap(m_forwardOpen.begin(), m_forwardOpen.end(), Greater<Entry>());
+	m_forwardOpen.pop_back();
+
+	++finder.m_expanded;
+	SEARCH_STAT(++finder.m_stats.heapPops;)
+
+	//	The cost of the point was lowered after it was pushed
+	if (entry.cost > m_forwardState.cost(entry.point)) {
+		SEARCH_STAT(++finder.m_stats.stalePops;)
+		return;
+	}
+
+	//	The backward side went on since the point was pushed, it goes back with the new bound
+	const size_t lower = bound(entry.point);
+
+	if (lower == SearchState::NO_COST) {
+		return;
+	}
+
+	if (weight > 0.0 && entry.cost + static_cast<size_t>(weight * std::max(entry.heuristic, lower)) > entry.priority) {
+		pushForward(entry.point, entry.cost, entry.heuristic, weight);
+		return;
+	}
+
+	Point target{ -1,-1 };
+	const auto &successors = finder.successors(entry.point, m_forwardState.parent(entry.point), target);
+
+	for (const auto &point : successors) {
+		const size_t newCost = entry.cost + finder.stepCost(entry.point, point);
+
+		if (newCost >= m_forwardState.cost(point)) {
+			continue;
+		}
+
+		m_forwardState.set(point, entry.point, newCost);
+		pushForward(point, newCost, finder.closestKeyCost(point), weight);
+	}
+
+	//	A jump stopped at an ending zone, the last successor is the point it went through
+	if (target != Point{ -1,-1 }) {
+		const Point &source = successors.back();
+		const size_t cost = m_forwardState.cost(source) + finder.stepCost(source, target);
+
+		if (cost < m_best) {
+			m_best = cost;
+			m_target = target;
+			m_source = source;
+		}
+	}
+}
+
+void BidirectionalSearch::expandBackward() {
+	PathFinder &finder = *m_finder;
+	const auto &image = finder.m_imgData->getImage();
+
+	const Entry entry = m_backwardOpen.front();
+	std::pop_heap(m_backwardOpen.begin(), m_backwardOpen.end(), Greater<Entry>());
+	m_backwardOpen.pop_back();
+
+	++finder.m_expanded;
+	SEARCH_STAT(++finder.m_stats.heapPops;)
+
+	if (entry.cost > m_backwardState.cost(entry.point)) {
+		SEARCH_STAT(++finder.m_stats.stalePops;)
+		return;
+	}
+
+	const bool inEnd = image.cell(entry.point) == CellClassifier::Cell::END;
+
+	//	No key is left, so the steps never stop at a target
+	Point target{ -1,-1 };
+	const auto &successors = m_backward.successors(entry.point, entry.point, target);
+
+	for (const auto &point : successors) {
+		const bool step = !inEnd || image.cell(point) != CellClassifier::Cell::END;
+		const size_t newCost = entry.cost + (step ? m_backward.stepCost(entry.point, point) : 0);
+
+		if (newCost >= m_backwardState.cost(point)) {
+			continue;
+		}
+
+		m_backwardState.set(point, entry.point, newCost);
+		SEARCH_STAT(++m_backward.m_stats.heapPushes;)
+
+		m_backwardOpen.push_back(Entry{ newCost, newCost, 0, point });
+		std::push_heap(m_backwardOpen.begin(), m_backwardOpen.end(), Greater<Entry>());
+	}
+}
+
+void BidirectionalSearch::pushForward(const Point &point, size_t cost, size_t heuristic, double weight) {
+	const size_t lower = bound(point);
+
+	//	No ending zone can be reached from the point
+	if (lower == SearchState::NO_COST) {
+		return;
+	}
+
+	SEARCH_STAT(++m_finder->m_stats.keyCostEvaluations; ++m_finder->m_stats.heapPushes;)
+
+	const size_t priority = cost + (weight > 0.0 ? static_cast<size_t>(weight * std::max(heuristic, lower)) : 0);
+
+	m_forwardOpen.push_back(Entry{ priority, cost, heuristic, point });
+	std::push_heap(m_forwardOpen.begin(), m_forwardOpen.end(), Greater<Entry>());
+}
+
+size_t BidirectionalSearch::bound(const Point &point) const {
+	//	The pixels cheaper than the open list of the backward side have their exact cost
+	const size_t radius = m_backwardOpen.empty() ? SearchState::NO_COST : m_backwardOpen.front().cost;
+
+	return std::min(m_backwardState.cost(point), radius);
+}
@@ -0,0 +1,84 @@
+#pragma once
+#ifndef BIDIRECTIONAL_SEARCH_CLASS_HEADER
+#define BIDIRECTIONAL_SEARCH_CLASS_HEADER
+
+#include <vector>
+
+#include "PathFinder.h"
+#include "SearchState.h"
+
+//	Bidirectional search for the last stage of PathFinder::findPath().
+//
+//	When every key is collected the stage can only end in an ending zone. The forward side expands
+//	the points of the stage with the jumps of the finder, which stop at the first pixel of an ending
+//	zone, so its paths are the ones the single direction search finds. The backward side floods the
+//	pixels from every pixel of the ending zones in the order of their cost(Dijkstra). The doors and
+//	the walls are the same cells in both directions(the inventory does not change in the stage), so
+//	a pixel the backward side took has the exact cost to the nearest ending zone and any other pixel
+//	costs at least the lowest cost of its open list.
+//
+//	The priority of a forward point uses the larger of that lower bound and the heuristic of the
+//	finder, so the forward side does not go into the dead ends around the ending zones. A priority
+//	is raised when its point is taken and the bound has grown since it was pushed. Every ending zone
+//	reached by a jump is a candidate, the search stops when the lowest priority of the forward side
+//	is not below the cheapest candidate. The side with the shorter open list is expanded next
+class BidirectionalSearch {
+public:
+	//	Outcome of a stage
+	struct Result {
+		bool found = false;
+		bool interrupted = false;	//	The budget of the finder ended or the search was cancelled
+		Point target{ -1, -1 };		//	The pixel of the ending zone
+		Point source{ -1, -1 };		//	The successor whose jump reached the target, the path goes on with its parents
+	};
+
+public:
+	BidirectionalSearch();
+	BidirectionalSearch(const BidirectionalSearch &r) = delete;
+	BidirectionalSearch& operator=(const BidirectionalSearch &rhs) = delete;
+	~BidirectionalSearch() = default;
+
+public:
+	//	Returns *true* if the next stage of *finder* can only end in an ending zone
+	static bool applies(const PathFinder &finder);
+
+	//	Searches the stage of *finder* that starts at *start*. Adds the expanded points,
+	//	the read pixels and the counters to the finder and sets its status if interrupted
+	Result run(PathFinder &finder, const Point &start, double weight);
+
+	//	Parent of a point reached by the forward side of the last run(), the start is its own parent
+	Point parent(const Point &point) const;
+
+private:
+	struct Entry {
+		size_t priority;
+		size_t cost;
+		size_t heuristic;		//	Heuristic of the finder, the lower bound of the backward side may grow
+		Point point;
+	};
+
+	void expandForward(double weight);
+	void expandBackward();
+
+	//	Adds a reached point to the open list of the forward side
+	void pushForward(const Point &point, size_t cost, size_t heuristic, double weight);
+
+	//	Lower bound of the cost from *point* to the nearest ending zone,
+	//	SearchState::NO_COST if the backward side cannot reach it
+	size_t bound(const Point &point) const;
+
+private:
+	PathFinder *m_finder;
+	PathFinder m_backward;		//	Copy of the finder for the steps of the backward side
+
+	SearchState m_forwardState;
+	SearchState m_backwardState;
+	std::vector<Entry> m_forwardOpen;
+	std::vector<Entry> m_backwardOpen;	//	The priority is the cost
+
+	size_t m_best;				//	Cost of the cheapest ending zone reached
+	Point m_target;
+	Point m_source;
+};
+
+#endif // !BIDIRECTIONAL_SEARCH_CLASS_HEADER
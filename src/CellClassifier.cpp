@@ -0,0 +1,238 @@
+#include <cstring>
+#include "CellClassifier.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CELL_CLASSIFIER_X86
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CELL_TARGET_SSE2
+#define CELL_TARGET_AVX2
+#else
+#define CELL_TARGET_SSE2 __attribute__((target("sse2")))
+#define CELL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+//	The AVX2 kernel loads 32 bytes to unpack 8 triplets(24 bytes)
+const size_t CellClassifier::ROW_SLACK = 8;
+
+namespace {
+
+uint32_t loadTriplet(const uint8_t *bgr) {
+	return static_cast<uint32_t>(bgr[0]) | static_cast<uint32_t>(bgr[1]) << 8 | static_cast<uint32_t>(bgr[2]) << 16;
+}
+
+void setBits(uint64_t *passable, size_t from, uint64_t bits) {
+	passable[from / 64] |= bits << (from % 64);
+}
+
+//	Classifies the triplets [from, to) one by one
+void classifyRange(const uint8_t *bgr, size_t from, size_t to, uint32_t *pixels, CellClassifier::Cell *cells, uint64_t *passable) {
+	for (size_t i = from; i < to; ++i) {
+		pixels[i] = loadTriplet(bgr + i * 3);
+		cells[i] = CellClassifier::classify(pixels[i]);
+
+		if (cells[i] != CellClassifier::Cell::WALL) {
+			setBits(passable, i, 1);
+		}
+	}
+}
+
+} // namespace
+
+CellClassifier::Cell CellClassifier::classify(const Pixel::pxl_t &pixel) {
+	if (pixel == Pixel::BLACK) {
+		return Cell::WALL;
+	}
+	else if (pixel == Pixel::WHITE) {
+		return Cell::FREE;
+	}
+	else if (pixel == Pixel::START) {
+		return Cell::START;
+	}
+	else if (pixel == Pixel::END) {
+		return Cell::END;
+	}
+
+	return Cell::COLOR;
+}
+
+void CellClassifier::classifyRow(const uint8_t *bgr, size_t count, uint32_t *pixels, Cell *cells, uint64_t *passable) {
+	//	Chosen once, the first time a row is classified
+	static const char *name = nullptr;
+	static const Kernel kernel = selectKernel(name);
+
+	kernel(bgr, count, pixels, cells, passable);
+}
+
+void CellClassifier::classifyIndices(const uint8_t *indices, size_t count, const uint32_t *palette, const Cell *paletteCells, uint32_t *pixels, Cell *cells, uint64_t *passable) {
+	for (size_t i = 0; i < count; ++i) {
+		pixels[i] = palette[indices[i]];
+		cells[i] = paletteCells[indices[i]];
+
+		if (cells[i] != Cell::WALL) {
+			setBits(passable, i, 1);
+		}
+	}
+}
+
+const char* CellClassifier::kernelName() {
+	const char *name = nullptr;
+	selectKernel(name);
+
+	return name;
+}
+
+void CellClassifier::classifyRowScalar(const uint8_t *bgr, size_t count, uint32_t *pixels, Cell *cells, uint64_t *passable) {
+	classifyRange(bgr, 0, count, pixels, cells, passable);
+}
+
+#ifdef CELL_CLASSIFIER_X86
+
+CELL_TARGET_SSE2 void CellClassifier::classifyRowSSE2(const uint8_t *bgr, size_t count, uint32_t *pixels, Cell *cells, uint64_t *passable) {
+	const __m128i black = _mm_set1_epi32(static_cast<int>(Pixel::BLACK));
+	const __m128i white = _mm_set1_epi32(static_cast<int>(Pixel::WHITE));
+	const __m128i start = _mm_set1_epi32(static_cast<int>(Pixel::START));
+	const __m128i end = _mm_set1_epi32(static_cast<int>(Pixel::END));
+
+	const __m128i codeFree = _mm_set1_epi32(static_cast<int>(Cell::FREE));
+	const __m128i codeStart = _mm_set1_epi32(static_cast<int>(Cell::START));
+	const __m128i codeEnd = _mm_set1_epi32(static_cast<int>(Cell::END));
+	const __m128i codeColor = _mm_set1_epi32(static_cast<int>(Cell::COLOR));
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		//	SSE2 has no byte shuffle, so the triplets are unpacked one by one
+		for (size_t j = 0; j < 4; ++j) {
+			pixels[i + j] = loadTriplet(bgr + (i + j) * 3);
+		}
+
+		const __m128i pxl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i));
+
+		const __m128i isBlack = _mm_cmpeq_epi32(pxl, black);
+		const __m128i isWhite = _mm_cmpeq_epi32(pxl, white);
+		const __m128i isStart = _mm_cmpeq_epi32(pxl, start);
+		const __m128i isEnd = _mm_cmpeq_epi32(pxl, end);
+		const __m128i known = _mm_or_si128(_mm_or_si128(isBlack, isWhite), _mm_or_si128(isStart, isEnd));
+
+		//	WALL is 0, so black pixels need no code
+		__m128i code = _mm_andnot_si128(known, codeColor);
+		code = _mm_or_si128(code, _mm_and_si128(isWhite, codeFree));
+		code = _mm_or_si128(code, _mm_and_si128(isStart, codeStart));
+		code = _mm_or_si128(code, _mm_and_si128(isEnd, codeEnd));
+
+		//	32 bit codes -> 8 bit codes
+		code = _mm_packs_epi32(code, code);
+		code = _mm_packus_epi16(code, code);
+
+		const int packed = _mm_cvtsi128_si32(code);
+		std::memcpy(cells + i, &packed, 4);
+
+		const int walls = _mm_movemask_ps(_mm_castsi128_ps(isBlack));
+		setBits(passable, i, static_cast<uint64_t>(~walls & 0xf));
+	}
+
+	classifyRange(bgr, i, count, pixels, cells, passable);
+}
+
+CELL_TARGET_AVX2 void CellClassifier::classifyRowAVX2(const uint8_t *bgr, size_t count, uint32_t *pixels, Cell *cells, uint64_t *passable) {
+	const __m256i black = _mm256_set1_epi32(static_cast<int>(Pixel::BLACK));
+	const __m256i white = _mm256_set1_epi32(static_cast<int>(Pixel::WHITE));
+	const __m256i start = _mm256_set1_epi32(static_cast<int>(Pixel::START));
+	const __m256i end = _mm256_set1_epi32(static_cast<int>(Pixel::END));
+
+	const __m256i codeFree = _mm256_set1_epi32(static_cast<int>(Cell::FREE));
+	const __m256i codeStart = _mm256_set1_epi32(static_cast<int>(Cell::START));
+	const __m256i codeEnd = _mm256_set1_epi32(static_cast<int>(Cell::END));
+	const __m256i codeColor = _mm256_set1_epi32(static_cast<int>(Cell::COLOR));
+
+	//	Moves bytes 0-11 to the low lane and bytes 12-23 to the high lane
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 0, 3, 4, 5, 0);
+
+	//	Expands 4 triplets of a lane to 4 zero extended 32 bit values
+	const __m256i expand = _mm256_setr_epi8(
+		0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+		0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i pxl = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bgr + i * 3));
+		pxl = _mm256_permutevar8x32_epi32(pxl, lanes);
+		pxl = _mm256_shuffle_epi8(pxl, expand);
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(pixels + i), pxl);
+
+		const __m256i isBlack = _mm256_cmpeq_epi32(pxl, black);
+		const __m256i isWhite = _mm256_cmpeq_epi32(pxl, white);
+		const __m256i isStart = _mm256_cmpeq_epi32(pxl, start);
+		const __m256i isEnd = _mm256_cmpeq_epi32(pxl, end);
+		const __m256i known = _mm256_or_si256(_mm256_or_si256(isBlack, isWhite), _mm256_or_si256(isStart, isEnd));
+
+		__m256i code = _mm256_andnot_si256(known, codeColor);
+		code = _mm256_or_si256(code, _mm256_and_si256(isWhite, codeFree));
+		code = _mm256_or_si256(code, _mm256_and_si256(isStart, codeStart));
+		code = _mm256_or_si256(code, _mm256_and_si256(isEnd, codeEnd));
+
+		//	Every lane keeps its 4 codes in its lowest 4 bytes
+		code = _mm256_packs_epi32(code, code);
+		code = _mm256_packus_epi16(code, code);
+
+		const int low = _mm_cvtsi128_si32(_mm256_castsi256_si128(code));
+		const int high = _mm_cvtsi128_si32(_mm256_extracti128_si256(code, 1));
+		std::memcpy(cells + i, &low, 4);
+		std::memcpy(cells + i + 4, &high, 4);
+
+		const int walls = _mm256_movemask_ps(_mm256_castsi256_ps(isBlack));
+		setBits(passable, i, static_cast<uint64_t>(~walls & 0xff));
+	}
+
+	classifyRange(bgr, i, count, pixels, cells, passable);
+}
+
+#else
+
+void CellClassifier::classifyRowSSE2(const uint8_t *bgr, size_t count, uint32_t *pixels, Cell *cells, uint64_t *passable) {
+	classifyRowScalar(bgr, count, pixels, cells, passable);
+}
+
+void CellClassifier::classifyRowAVX2(const uint8_t *bgr, size_t count, uint32_t *pixels, Cell *cells, uint64_t *passable) {
+	classifyRowScalar(bgr, count, pixels, cells, passable);
+}
+
+#endif // CELL_CLASSIFIER_X86
+
+CellClassifier::Kernel CellClassifier::selectKernel(const char *&name) {
+#ifdef CELL_CLASSIFIER_X86
+	bool avx2 = false;
+	bool sse2 = false;
+
+#if defined(_MSC_VER)
+	int info[4] = { 0 };
+	__cpuid(info, 1);
+	sse2 = (info[3] & (1 << 26)) != 0;
+
+	//	AVX2 needs support from both the CPU and the OS(saved YMM registers)
+	const bool osxsave = (info[2] & (1 << 27)) != 0;
+	__cpuidex(info, 7, 0);
+	avx2 = osxsave && (info[1] & (1 << 5)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+#else
+	__builtin_cpu_init();
+	sse2 = __builtin_cpu_supports("sse2");
+	avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+	if (avx2) {
+		name = "avx2";
+		return &CellClassifier::classifyRowAVX2;
+	}
+	else if (sse2) {
+		name = "sse2";
+		return &CellClassifier::classifyRowSSE2;
+	}
+#endif // CELL_CLASSIFIER_X86
+
+	name = "scalar";
+	return &CellClassifier::classifyRowScalar;
+}
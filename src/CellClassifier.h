@@ -0,0 +1,53 @@
+#pragma once
+#ifndef CELL_CLASSIFIER_CLASS_HEADER
+#define CELL_CLASSIFIER_CLASS_HEADER
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Pixel.h"
+
+//	Maps pixels to the type of cell they represent in the maze.
+//	Rows of a .bmp file are classified while their BGR triplets are unpacked,
+//	so the solver never has to compare raw pixel values again
+class CellClassifier {
+public:
+	enum class Cell : uint8_t {
+		WALL,	//	Pixel::BLACK
+		FREE,	//	Pixel::WHITE
+		START,	//	Pixel::START
+		END,	//	Pixel::END
+		COLOR	//	Any other color(keys and doors)
+	};
+
+	//	Unpacks and classifies *count* BGR triplets.
+	//	Writes the pixel values, their cells and a bit for every passable(not WALL) pixel.
+	//	*bgr* must be readable for at least count * 3 + ROW_SLACK bytes and
+	//	*passable* must be zeroed for at least *count* bits
+	using Kernel = void (*)(const uint8_t *bgr, size_t count, uint32_t *pixels, Cell *cells, uint64_t *passable);
+
+	//	Extra bytes the kernels may read after the last triplet
+	static const size_t ROW_SLACK;
+
+public:
+	static Cell classify(const Pixel::pxl_t &pixel);
+
+	//	Classifies a row with the fastest kernel supported by the CPU
+	static void classifyRow(const uint8_t *bgr, size_t count, uint32_t *pixels, Cell *cells, uint64_t *passable);
+
+	//	Looks up *count* palette indices. The cells of the palette are classified once, so the
+	//	colors of an indexed image are never compared. *palette* must have an entry for every index
+	static void classifyIndices(const uint8_t *indices, size_t count, const uint32_t *palette, const Cell *paletteCells, uint32_t *pixels, Cell *cells, uint64_t *passable);
+
+	//	Name of the kernel chosen at runtime("avx2", "sse2" or "scalar")
+	static const char* kernelName();
+
+private:
+	static void classifyRowScalar(const uint8_t *bgr, size_t count, uint32_t *pixels, Cell *cells, uint64_t *passable);
+	static void classifyRowSSE2(const uint8_t *bgr, size_t count, uint32_t *pixels, Cell *cells, uint64_t *passable);
+	static void classifyRowAVX2(const uint8_t *bgr, size_t count, uint32_t *pixels, Cell *cells, uint64_t *passable);
+
+	static Kernel selectKernel(const char *&name);
+};
+
+#endif // !CELL_CLASSIFIER_CLASS_HEADER
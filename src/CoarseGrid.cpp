@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <numeric>
+#include "CoarseGrid.h"
+#include "Trace.h"
+
+CoarseGrid::CoarseGrid()
+	: m_info(Image(std::string()))
+	, m_pitch(0)
+	, m_shiftX(0)
+	, m_shiftY(0)
+	, m_width(0)
+	, m_height(0) {
+
+}
+
+bool CoarseGrid::build(const ImageInfo &info, Point::dim_t minPitch) {
+	TRACE_SCOPE("coarse grid");
+
+	const Image &image = info.m_image;
+	const Point::dim_t width = image.width();
+	const Point::dim_t height = image.height();
+	const Point::dim_t half = ImageInfo::KEY_WIDTH / 2;
+
+	m_pitch = 0;
+
+	if (width == 0 || height == 0) {
+		return false;
+	}
+
+	//	Returns *true* if the colored pixel is a part of a key of its color
+	const auto inKey = [&](Point::dim_t x, Point::dim_t y, Pixel::pxl_t value) {
+		const auto key = info.m_keys.find(value);
+		if (key == info.m_keys.end()) {
+			return false;
+		}
+
+		for (const auto &center : key->second) {
+			if (x >= center.x() - half && x < center.x() + half && y >= center.y() - half && y < center.y() + half) {
+				return true;
+			}
+		}
+
+		return false;
+	};
+
+	//	The walls and the doors keep their value, the keys, the ending zones and the start are free,
+	//	they may be anywhere inside the corridors
+	const auto structure = [&](Point::dim_t x, Point::dim_t y, Pixel::pxl_t value, CellClassifier::Cell cell) {
+		if (cell == CellClassifier::Cell::WALL || (cell == CellClassifier::Cell::COLOR && !inKey(x, y, value))) {
+			return value;
+		}
+
+		return Pixel::WHITE;
+	};
+
+	std::vector<uint32_t> pixels(width);
+	std::vector<CellClassifier::Cell> cells(width);
+	std::vector<Pixel::pxl_t> row(width), above(width);
+
+	//	Every change of the structure is on a border of the blocks, so the pitch divides the distance
+	//	between any two borders of the same axis
+	Point::dim_t pitchX = 0, pitchY = 0;
+	Point::dim_t firstX = -1, firstY = -1;
+
+	for (Point::dim_t x = 0; x < height; ++x) {
+		image.readRow(x, pixels.data(), cells.data());
+
+		for (Point::dim_t y = 0; y < width; ++y) {
+			row[y] = structure(x, y, pixels[y], cells[y]);
+		}
+
+		for (Point::dim_t y = 1; y < width; ++y) {
+			if (row[y] == row[y - 1]) {
+				continue;
+			}
+
+			if (firstY < 0) {
+				firstY = y;
+			}
+			else if (pitchY == 0 || (y - firstY) % pitchY != 0) {
+				pitchY = std::gcd(pitchY, y - firstY);
+			}
+		}
+
+		//	A single change is enough, the rows are either equal or on a border
+		if (x > 0 && row != above) {
+			if (firstX < 0) {
+				firstX = x;
+			}
+			else {
+				pitchX = std::gcd(pitchX, x - firstX);
+			}
+		}
+
+		//	The pitch only gets smaller, an irregular image is known early
+		const Point::dim_t pitch = std::gcd(pitchX, pitchY);
+		if (pitch != 0 && pitch < minPitch) {
+			return false;
+		}
+
+		row.swap(above);
+	}
+
+	const Point::dim_t pitch = std::gcd(pitchX, pitchY);
+	if (pitch == 0 || pitch < minPitch) {
+		return false;
+	}
+
+	m_pitch = pitch;
+	m_shiftX = firstX < 0 ? 0 : (pitch - firstX % pitch) % pitch;
+	m_shiftY = firstY < 0 ? 0 : (pitch - firstY % pitch) % pitch;
+	m_width = width;
+	m_height = height;
+
+	const Point::dim_t cellsWidth = (width + m_shiftY + pitch - 1) / pitch;
+	const Point::dim_t cellsHeight = (height + m_shiftX + pitch - 1) / pitch;
+
+	//	Value of every cell and the rank of the pixel it was taken from. A key beats an ending zone,
+	//	an ending zone beats the start and the start beats the structure of the block
+	std::vector<Pixel::pxl_t> values(static_cast<size_t>(cellsWidth) * cellsHeight, Pixel::BLACK);
+	std::vector<uint8_t> ranks(values.size(), 0);
+
+	for (Point::dim_t x = 0; x < height; ++x) {
+		image.readRow(x, pixels.data(), cells.data());
+
+		const size_t first = static_cast<size_t>((x + m_shiftX) / pitch) * cellsWidth;
+
+		for (Point::dim_t y = 0; y < width; ++y) {
+			const size_t cell = first + (y + m_shiftY) / pitch;
+
+			uint8_t rank = 1;
+			if (cells[y] == CellClassifier::Cell::START) {
+				rank = 2;
+			}
+			else if (cells[y] == CellClassifier::Cell::END) {
+				rank = 3;
+			}
+			else if (cells[y] == CellClassifier::Cell::COLOR && inKey(x, y, pixels[y])) {
+				rank = 4;
+			}
+
+			if (rank > ranks[cell]) {
+				ranks[cell] = rank;
+				values[cell] = pixels[y];
+			}
+		}
+	}
+
+	m_info = ImageInfo(Image(image.path()));
+
+	Image &cellsImage = m_info.m_image;
+	cellsImage.m_width = cellsWidth;
+	cellsImage.m_height = cellsHeight;
+	cellsImage.allocate();
+
+	for (Point::dim_t x = 0; x < cellsHeight; ++x) {
+		for (Point::dim_t y = 0; y < cellsWidth; ++y) {
+			cellsImage.setPixelUnchecked(x, y, values[static_cast<size_t>(x) * cellsWidth + y]);
+		}
+	}
+
+	//	A key is found within m_keyWidth of its middle, which has to cover every cell of its square
+	m_info.m_keyWidth = 0;
+
+	for (const auto &key : info.m_keys) {
+		for (const auto &center : key.second) {
+			const Point middle = toCell(center);
+			const Point first = toCell(Point{ center.x() - half, center.y() - half });
+			const Point last = toCell(Point{ center.x() + half - 1, center.y() + half - 1 });
+
+			const Point::dim_t reach = std::max(middle.x() - first.x(), last.x() - middle.x()) + std::max(middle.y() - first.y(), last.y() - middle.y());
+
+			m_info.m_keyWidth = std::max(m_info.m_keyWidth, reach);
+			m_info.m_keys[key.first].push_back(middle);
+		}
+	}
+
+	for (const auto &end : info.m_ends) {
+		m_info.m_ends.push_back(toCell(end));
+	}
+
+	m_info.m_start = toCell(info.m_start);
+
+	return true;
+}
+
+ImageInfo& CoarseGrid::info() {
+	return m_info;
+}
+
+Point::dim_t CoarseGrid::pitch() const {
+	return m_pitch;
+}
+
+SearchPolicy::Movement CoarseGrid::movement(const SearchPolicy::Movement &movement) {
+	SearchPolicy::Movement cells = movement;
+
+	if (cells.connectivity == SearchPolicy::Connectivity::EIGHT) {
+		cells.connectivity = SearchPolicy::Connectivity::EIGHT_STRICT;
+	}
+
+	return cells;
+}
+
+Point CoarseGrid::toCell(const Point &pixel) const {
+	return Point{ (pixel.x() + m_shiftX) / m_pitch, (pixel.y() + m_shiftY) / m_pitch };
+}
+
+Point CoarseGrid::toPixel(const Point &cell) const {
+	const Point::dim_t x = cell.x() * m_pitch - m_shiftX + m_pitch / 2;
+	const Point::dim_t y = cell.y() * m_pitch - m_shiftY + m_pitch / 2;
+
+	return Point{ std::min(std::max(x, blockBegin(cell.x(), m_shiftX)), blockEnd(cell.x(), m_shiftX, m_height) - 1),
+		std::min(std::max(y, blockBegin(cell.y(), m_shiftY)), blockEnd(cell.y(), m_shiftY, m_width) - 1) };
+}
+
+void CoarseGrid::mapStage(const Image &image, const Point &from, std::vector<Point> &points) const {
+	if (points.empty()) {
+		return;
+	}
+
+	const Point target = points.front();
+	const Pixel::pxl_t value = m_info.m_image.pixel(target);
+
+	std::vector<Point> pixels;
+	pixels.reserve(points.size() + 4);
+
+	//	The block of a key or an ending zone may be only partly covered by it
+	const Point middle = toPixel(target);
+	Point nearest = middle;
+	size_t nearestDistance = std::numeric_limits<size_t>::max();
+
+	for (Point::dim_t x = blockBegin(target.x(), m_shiftX); x < blockEnd(target.x(), m_shiftX, m_height); ++x) {
+		for (Point::dim_t y = blockBegin(target.y(), m_shiftY); y < blockEnd(target.y(), m_shiftY, m_width); ++y) {
+			const size_t distance = static_cast<size_t>(std::abs(x - middle.x()) + std::abs(y - middle.y()));
+
+			if (distance < nearestDistance && image.pixel(Point{ x, y }) == value) {
+				nearest = Point{ x, y };
+				nearestDistance = distance;
+			}
+		}
+	}
+
+	if (nearest != middle) {
+		pixels.push_back(nearest);
+		addCorner(nearest, middle, pixels);
+	}
+
+	for (const auto &point : points) {
+		pixels.push_back(toPixel(point));
+	}
+
+	if (pixels.back() != from) {
+		addCorner(pixels.back(), from, pixels);
+		pixels.push_back(from);
+	}
+
+	points.swap(pixels);
+}
+
+void CoarseGrid::addCorner(const Point &from, const Point &to, std::vector<Point> &points) {
+	if (from.x() != to.x() && from.y() != to.y()) {
+		points.push_back(Point{ from.x(), to.y() });
+	}
+}
+
+Point::dim_t CoarseGrid::blockBegin(Point::dim_t cell, Point::dim_t shift) const {
+	return std::max(cell * m_pitch - shift, 0);
+}
+
+Point::dim_t CoarseGrid::blockEnd(Point::dim_t cell, Point::dim_t shift, Point::dim_t size) const {
+	return std::min(cell * m_pitch - shift + m_pitch, size);
+}
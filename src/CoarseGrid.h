@@ -0,0 +1,68 @@
+#pragma once
+#ifndef COARSE_GRID_CLASS_HEADER
+#define COARSE_GRID_CLASS_HEADER
+
+#include <vector>
+
+#include "ImageInfo.h"
+#include "SearchPolicy.h"
+
+//	Maze of the logical cells of an image drawn with corridors and walls whose sides are multiples
+//	of a pitch. The walls and the doors are found on a grid of pitch x pitch blocks, so every block is
+//	a single pixel of the maze of the cells, with the same passability. A block with a part of a key,
+//	an ending zone or the start becomes that key, ending zone or start. The searches run on the cells,
+//	pitch * pitch times fewer than the pixels, and the path is mapped back through the middle of the blocks
+class CoarseGrid {
+public:
+	CoarseGrid();
+	CoarseGrid(const CoarseGrid &r) = delete;
+	CoarseGrid& operator=(const CoarseGrid &rhs) = delete;
+	~CoarseGrid() = default;
+
+public:
+	//	Finds the pitch and the origin of the blocks of an analyzed image and builds the maze of its
+	//	cells. Returns *false* if the pitch is below *minPitch*, the walls are not on a regular grid
+	bool build(const ImageInfo &info, Point::dim_t minPitch = 2);
+
+	//	The maze of the cells, its keys and ending zones are cells too
+	ImageInfo& info();
+
+	//	Side of a block in pixels
+	Point::dim_t pitch() const;
+
+	//	Rules of the searches of the cells for the rules *movement* of the pixels. The corners of the
+	//	blocks are not cut: the line between the middles of two diagonal blocks of an even pitch goes
+	//	through one of the blocks beside them, so both have to be passable
+	static SearchPolicy::Movement movement(const SearchPolicy::Movement &movement);
+
+	//	Cell of the block that contains *pixel*
+	Point toCell(const Point &pixel) const;
+
+	//	Pixel in the middle of block *cell*, the blocks on the border may be cut by the image
+	Point toPixel(const Point &cell) const;
+
+	//	Maps the points of a stage(the target first) from cells to pixels of *image*. The target is
+	//	moved to the pixel of its block nearest to the middle with the value of the cell, so the path
+	//	touches the key or the ending zone in the image too, and the stage goes on from pixel *from*
+	//	(where the stage before it ended, in the block of its first cell)
+	void mapStage(const Image &image, const Point &from, std::vector<Point> &points) const;
+
+private:
+	//	First pixel of the blocks of *cell* along an axis, and the pixel after the last one
+	Point::dim_t blockBegin(Point::dim_t cell, Point::dim_t shift) const;
+	Point::dim_t blockEnd(Point::dim_t cell, Point::dim_t shift, Point::dim_t size) const;
+
+	//	Point between two pixels of the same block where a horizontal and a vertical segment meet,
+	//	every connectivity allows them
+	static void addCorner(const Point &from, const Point &to, std::vector<Point> &points);
+
+private:
+	ImageInfo m_info;
+	Point::dim_t m_pitch;
+	Point::dim_t m_shiftX;		//	Pixels the first row of blocks lacks at the top of the image
+	Point::dim_t m_shiftY;		//	Pixels the first column of blocks lacks at the left of the image
+	Point::dim_t m_width;		//	Size of the image in pixels
+	Point::dim_t m_height;
+};
+
+#endif // !COARSE_GRID_CLASS_HEADER
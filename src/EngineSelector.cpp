@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "EngineSelector.h"
+
+namespace {
+
+//	Fitted by bench/EngineCalibration.cpp with the default options on a single core machine
+const double COEFFICIENTS[2][3][EngineSelector::FEATURES] = {
+	//	JPS
+	{
+		{ -1.8276, 0.0455662, 0.456441, -0.393379, 0.322945, -1.46444, -0.358956 },
+		{ -5.58428, 0.265155, 0.0927272, -0.0145945, 0.303828, 0.0961516, -0.116985 },
+		{ -2.18556, 0.0520564, 0.973423, -0.725184, 0.364302, -1.26725, 0.0599486 }
+	},
+	//	Flood
+	{
+		{ -3.60688, 0.235804, -0.589535, 0.649625, 0.343958, -1.1195, -0.123826 },
+		{ -6.45488, 0.425233, -0.860352, 0.805316, 0.43085, -0.761742, 0.0910286 },
+		{ -2.66549, 0.163268, -0.245149, 0.290273, 0.356895, -1.62268, 0.111565 }
+	}
+};
+
+const double ASTAR_NS = 510.293;
+
+//	Not timed, a stage pays off on several threads only when it is huge
+const uint64_t PARALLEL_PIXELS = 16u << 20;
+const double ANYTIME_WEIGHT = 3.0;
+
+const SearchPolicy::Connectivity CONNECTIVITIES[] = {
+	SearchPolicy::Connectivity::EIGHT, SearchPolicy::Connectivity::EIGHT_STRICT, SearchPolicy::Connectivity::FOUR
+};
+
+//	Row of the coefficients of an engine with a model, -1 for A*
+int modelIndex(SearchPolicy::Engine engine) {
+	switch (engine) {
+	case SearchPolicy::Engine::JPS:
+		return 0;
+	case SearchPolicy::Engine::FLOOD:
+		return 1;
+	default:
+		return -1;
+	}
+}
+
+} // namespace
+
+EngineSelector::EngineSelector()
+	: m_astarNs(ASTAR_NS)
+	, m_anytimeWeight(ANYTIME_WEIGHT)
+	, m_parallelPixels(PARALLEL_PIXELS) {
+
+	std::copy(&COEFFICIENTS[0][0][0], &COEFFICIENTS[0][0][0] + 2 * 3 * FEATURES, &m_coefficients[0][0][0]);
+}
+
+bool EngineSelector::load(const std::string &path) {
+	std::ifstream ifile(path);
+	if (!ifile) {
+		std::cout << "The engine model " << path << " cannot be read!\n";
+		return false;
+	}
+
+	std::string line;
+	for (size_t number = 1; std::getline(ifile, line); ++number) {
+		std::istringstream stream(line);
+		std::string name;
+
+		if (!(stream >> name) || name[0] == '#') {
+			continue;
+		}
+
+		bool valid = true;
+
+		if (name == "astar-ns") {
+			valid = static_cast<bool>(stream >> m_astarNs) && m_astarNs > 0.0;
+		}
+		else if (name == "anytime-weight") {
+			valid = static_cast<bool>(stream >> m_anytimeWeight) && m_anytimeWeight >= 1.0;
+		}
+		else if (name == "parallel-pixels") {
+			valid = static_cast<bool>(stream >> m_parallelPixels) && m_parallelPixels > 0;
+		}
+		else {
+			const SearchPolicy::Engine engines[] = { SearchPolicy::Engine::JPS, SearchPolicy::Engine::FLOOD };
+			const auto engine = std::find_if(std::begin(engines), std::end(engines), [&](SearchPolicy::Engine e) { return name == engineName(e); });
+
+			std::string moves;
+			stream >> moves;
+			const auto connectivity = std::find_if(std::begin(CONNECTIVITIES), std::end(CONNECTIVITIES), [&](SearchPolicy::Connectivity c) { return moves == connectivityName(c); });
+
+			double coefficients[FEATURES];
+			for (auto &coefficient : coefficients) {
+				valid = valid && static_cast<bool>(stream >> coefficient);
+			}
+
+			valid = valid && engine != std::end(engines) && connectivity != std::end(CONNECTIVITIES);
+			if (valid) {
+				setCoefficients(*engine, *connectivity, coefficients);
+			}
+		}
+
+		if (!valid) {
+			std::cout << "Invalid line " << number << " of the engine model " << path << '\n';
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool EngineSelector::save(const std::string &path) const {
+	std::ofstream ofile(path);
+
+	ofile << "# log(time / time of A*) = c0 + c1 * log(free pixels) + c2 * log(mean run) + c3 * log(mean column) + c4 * log(1 + obstacles per million free pixels) + c5 * wall density + c6 * log(1 + targets)\n";
+
+	for (const auto engine : { SearchPolicy::Engine::JPS, SearchPolicy::Engine::FLOOD }) {
+		for (const auto connectivity : CONNECTIVITIES) {
+			ofile << engineName(engine) << ' ' << connectivityName(connectivity);
+
+			for (const auto coefficient : m_coefficients[modelIndex(engine)][static_cast<size_t>(connectivity)]) {
+				ofile << ' ' << coefficient;
+			}
+
+			ofile << '\n';
+		}
+	}
+
+	ofile << "astar-ns " << m_astarNs << '\n';
+	ofile << "anytime-weight " << m_anytimeWeight << '\n';
+	ofile << "parallel-pixels " << m_parallelPixels << '\n';
+
+	return static_cast<bool>(ofile);
+}
+
+EngineSelector::Choice EngineSelector::choose(const ImageInfo::Statistics &statistics, const SearchPolicy::Movement &movement, size_t timeLimitMs, unsigned hardwareThreads) const {
+	Choice choice;
+	choice.engine = SearchPolicy::Engine::ASTAR;
+
+	double best = 0.0;
+
+	for (const auto engine : { SearchPolicy::Engine::JPS, SearchPolicy::Engine::FLOOD }) {
+		const double prediction = predict(engine, movement.connectivity, statistics);
+
+		if (prediction < best) {
+			choice.engine = engine;
+			best = prediction;
+		}
+	}
+
+	//	The first pass is inflated only if the search may not end in time, the flood has no heuristic
+	if (timeLimitMs > 0 && choice.engine != SearchPolicy::Engine::FLOOD && astarMs(statistics) * std::exp(best) > timeLimitMs / 2.0) {
+		choice.weight = m_anytimeWeight;
+	}
+
+	const uint64_t freePixels = statistics.pixels - statistics.walls;
+	choice.threads = static_cast<unsigned>(std::max<uint64_t>(1, std::min<uint64_t>(freePixels / m_parallelPixels, std::max(hardwareThreads, 1u))));
+
+	return choice;
+}
+
+double EngineSelector::predict(SearchPolicy::Engine engine, SearchPolicy::Connectivity connectivity, const ImageInfo::Statistics &statistics) const {
+	const int index = modelIndex(engine);
+	if (index < 0) {
+		return 0.0;
+	}
+
+	double values[FEATURES];
+	features(statistics, values);
+
+	const auto &coefficients = m_coefficients[index][static_cast<size_t>(connectivity)];
+	double prediction = 0.0;
+
+	for (size_t i = 0; i < FEATURES; ++i) {
+		prediction += coefficients[i] * values[i];
+	}
+
+	return prediction;
+}
+
+double EngineSelector::astarMs(const ImageInfo::Statistics &statistics) const {
+	return m_astarNs * static_cast<double>(statistics.pixels - statistics.walls) / 1e6;
+}
+
+void EngineSelector::features(const ImageInfo::Statistics &statistics, double (&values)[FEATURES]) {
+	const double freePixels = static_cast<double>(std::max<uint64_t>(statistics.pixels - statistics.walls, 1));
+
+	values[0] = 1.0;
+	values[1] = std::log(freePixels);
+	values[2] = std::log(std::max(statistics.meanRun(), 1.0));
+	values[3] = std::log(std::max(statistics.meanColumn(), 1.0));
+	values[4] = std::log1p(statistics.obstacles * 1e6 / freePixels);
+	values[5] = statistics.wallDensity();
+	values[6] = std::log1p(static_cast<double>(statistics.keys + statistics.ends));
+}
+
+void EngineSelector::setCoefficients(SearchPolicy::Engine engine, SearchPolicy::Connectivity connectivity, const double (&coefficients)[FEATURES]) {
+	const int index = modelIndex(engine);
+	if (index < 0) {
+		return;
+	}
+
+	std::copy(std::begin(coefficients), std::end(coefficients), m_coefficients[index][static_cast<size_t>(connectivity)]);
+}
+
+void EngineSelector::setAstarNs(double ns) {
+	m_astarNs = ns;
+}
+
+const char* EngineSelector::engineName(SearchPolicy::Engine engine) {
+	switch (engine) {
+	case SearchPolicy::Engine::ASTAR:
+		return "astar";
+	case SearchPolicy::Engine::FLOOD:
+		return "flood";
+	default:
+		return "jps";
+	}
+}
+
+const char* EngineSelector::connectivityName(SearchPolicy::Connectivity connectivity) {
+	switch (connectivity) {
+	case SearchPolicy::Connectivity::EIGHT_STRICT:
+		return "8-strict";
+	case SearchPolicy::Connectivity::FOUR:
+		return "4";
+	default:
+		return "8";
+	}
+}
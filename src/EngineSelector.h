@@ -0,0 +1,82 @@
+#pragma once
+#ifndef ENGINE_SELECTOR_CLASS_HEADER
+#define ENGINE_SELECTOR_CLASS_HEADER
+
+#include <cstdint>
+#include <string>
+
+#include "ImageInfo.h"
+#include "SearchPolicy.h"
+
+//	Chooses the engine, the anytime weight and the threads of the search of a maze from its
+//	statistics(see ImageInfo::Statistics).
+//
+//	The time of jump point search and of the flood is predicted relative to the time of plain A*,
+//	for every connectivity with a linear model of the features of the maze:
+//		log(time / time of A*) = c0 + c1 * log(free pixels) + c2 * log(mean run) + c3 * log(mean column)
+//			+ c4 * log(1 + obstacles per million free pixels) + c5 * wall density + c6 * log(1 + targets)
+//	A* expands most of the free pixels, while JPS expands its jump points and scans between them:
+//	long runs in both directions make the scans long(without diagonal steps it scans across from
+//	every pixel of a scan) and many small obstacles give it many jump points. In twisty corridors
+//	the heuristic of A* is worth less than it costs, so the flood may win. The engine with the lowest
+//	prediction is chosen. The coefficients were fitted to timings of generated mazes with
+//	bench/EngineCalibration.cpp, which writes them in the format of load()
+class EngineSelector {
+public:
+	static const size_t FEATURES = 7;
+
+	//	What the search of a maze runs with
+	struct Choice {
+		SearchPolicy::Engine engine = SearchPolicy::Engine::JPS;
+		double weight = 1.0;		//	Weight of the heuristic of the first pass(PathFinder::Budget)
+		unsigned threads = 1;
+	};
+
+public:
+	//	The coefficients of the calibration of the sources
+	EngineSelector();
+	EngineSelector(const EngineSelector &r) = default;
+	EngineSelector& operator=(const EngineSelector &rhs) = default;
+	~EngineSelector() = default;
+
+public:
+	//	Reads the model written by save(), a line for every setting or set of coefficients:
+	//		jps|flood 8|8-strict|4 c0 c1 c2 c3 c4 c5 c6
+	//		astar-ns N			time of A* for every free pixel
+	//		anytime-weight W	first weight when the search may not end before half the time limit
+	//		parallel-pixels N	free pixels for every search thread
+	//	The settings that are not in the file keep their values. Lines starting with '#' are comments.
+	//	Returns *false* if the file cannot be read or a line is not valid
+	bool load(const std::string &path);
+	bool save(const std::string &path) const;
+
+	//	Engine for a maze with *statistics* searched with the rules *movement*. The weight is above 1
+	//	only when the predicted time is more than half of *timeLimitMs*(0 means no limit), and there
+	//	are more threads only for mazes with more than parallel-pixels free pixels per thread
+	Choice choose(const ImageInfo::Statistics &statistics, const SearchPolicy::Movement &movement, size_t timeLimitMs, unsigned hardwareThreads) const;
+
+	//	Predicted log(time / time of A*) of *engine*, 0 for A*
+	double predict(SearchPolicy::Engine engine, SearchPolicy::Connectivity connectivity, const ImageInfo::Statistics &statistics) const;
+
+	//	Predicted time of A* in milliseconds
+	double astarMs(const ImageInfo::Statistics &statistics) const;
+
+	//	Features of the model, the first one is 1
+	static void features(const ImageInfo::Statistics &statistics, double (&values)[FEATURES]);
+
+	void setCoefficients(SearchPolicy::Engine engine, SearchPolicy::Connectivity connectivity, const double (&coefficients)[FEATURES]);
+	void setAstarNs(double ns);
+
+	//	Names of the engines and the connectivities in the model and on the command line
+	static const char* engineName(SearchPolicy::Engine engine);
+	static const char* connectivityName(SearchPolicy::Connectivity connectivity);
+
+private:
+	//	Coefficients of JPS(0) and the flood(1) for every connectivity
+	double m_coefficients[2][3][FEATURES];
+	double m_astarNs;
+	double m_anytimeWeight;
+	uint64_t m_parallelPixels;
+};
+
+#endif // !ENGINE_SELECTOR_CLASS_HEADER
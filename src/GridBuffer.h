@@ -0,0 +1,110 @@
+#pragma once
+#ifndef GRID_BUFFER_CLASS_HEADER
+#define GRID_BUFFER_CLASS_HEADER
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "MappedFile.h"
+
+//	Array of grid elements that either owns its memory or lives inside a mapped file.
+//	Copies always own their memory, so they never share elements with the original
+template <typename T>
+class GridBuffer {
+public:
+	GridBuffer()
+		: m_data(nullptr)
+		, m_size(0) {
+
+	}
+
+	GridBuffer(const GridBuffer &r)
+		: m_owned(r.m_data, r.m_data + r.m_size)
+		, m_data(m_owned.data())
+		, m_size(r.m_size) {
+
+	}
+
+	GridBuffer(GridBuffer &&r)
+		: GridBuffer() {
+		swap(r);
+	}
+
+	GridBuffer& operator=(GridBuffer rhs) {
+		swap(rhs);
+		return *this;
+	}
+
+	~GridBuffer() = default;
+
+public:
+	//	Owns *count* copies of *value*
+	void assign(size_t count, const T &value) {
+		m_mapping.reset();
+		m_owned.assign(count, value);
+		m_data = m_owned.data();
+		m_size = count;
+	}
+
+	//	Takes the elements of *data*
+	void adopt(std::vector<T> &&data) {
+		m_mapping.reset();
+		m_owned = std::move(data);
+		m_data = m_owned.data();
+		m_size = m_owned.size();
+	}
+
+	//	Uses *count* elements inside the mapping, which is kept alive by the buffer
+	void attach(const std::shared_ptr<MappedFile> &mapping, T *data, size_t count) {
+		m_owned.clear();
+		m_owned.shrink_to_fit();
+		m_mapping = mapping;
+		m_data = data;
+		m_size = count;
+	}
+
+	void swap(GridBuffer &r) {
+		m_owned.swap(r.m_owned);
+		m_mapping.swap(r.m_mapping);
+		std::swap(m_data, r.m_data);
+		std::swap(m_size, r.m_size);
+	}
+
+	//	Returns *true* if the elements live inside a mapped file
+	bool mapped() const {
+		return m_mapping != nullptr;
+	}
+
+	T& operator[](size_t i) {
+		return m_data[i];
+	}
+
+	const T& operator[](size_t i) const {
+		return m_data[i];
+	}
+
+	T* data() {
+		return m_data;
+	}
+
+	const T* data() const {
+		return m_data;
+	}
+
+	size_t size() const {
+		return m_size;
+	}
+
+	bool empty() const {
+		return m_size == 0;
+	}
+
+private:
+	std::vector<T> m_owned;
+	std::shared_ptr<MappedFile> m_mapping;
+	T *m_data;
+	size_t m_size;
+};
+
+#endif // !GRID_BUFFER_CLASS_HEADER
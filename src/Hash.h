@@ -0,0 +1,34 @@
+#pragma once
+#ifndef HASH_HEADER
+#define HASH_HEADER
+
+#include <cstdint>
+
+//	64 bit hash of a stream of words, used for the content of the images, the source files of the
+//	maze cache and the keys of the result cache. Every word is mixed in with a multiplication and a
+//	rotation, and the result is finalized like MurmurHash3
+namespace Hash {
+	const uint64_t SEED = 0x9e3779b97f4a7c15ull;
+
+	const uint64_t K1 = 0xff51afd7ed558ccdull;
+	const uint64_t K2 = 0xc4ceb9fe1a85ec53ull;
+
+	//	State *h* with *word* mixed in
+	inline uint64_t mix(uint64_t h, uint64_t word) {
+		h ^= word * K1;
+		return ((h << 31) | (h >> 33)) * K2;
+	}
+
+	//	Spreads every bit of the state over the whole hash
+	inline uint64_t finalize(uint64_t h) {
+		h ^= h >> 33;
+		h *= K1;
+		h ^= h >> 33;
+		h *= K2;
+		h ^= h >> 33;
+
+		return h;
+	}
+}
+
+#endif // !HASH_HEADER
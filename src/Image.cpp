@@ -1,19 +1,543 @@
 #include <iostream>
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define IMAGE_USE_PREAD
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #include "Image.h"
+#include "Hash.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+//	Set the side of the tiles used by the TILED layout
+const Point::dim_t Image::TILE_SIZE = 8;
+
+//	A tile of the PAGED layout keeps 64K pixels(576KB)
+const Point::dim_t Image::PAGE_SIZE = 256;
+
+//	Size of the blocks read by every decoding thread
+const size_t Image::ROWS_BLOCK_BYTES = 1 << 20;
+
+namespace {
+
+//	Reads blocks of a file at given offsets without a shared file position
+class BlockReader {
+public:
+	explicit BlockReader(const std::string &path)
+#ifdef IMAGE_USE_PREAD
+		: m_fd(::open(path.c_str(), O_RDONLY)) {
+#else
+		: m_file(path, std::ios::binary) {
+#endif
+
+	}
+
+	~BlockReader() {
+#ifdef IMAGE_USE_PREAD
+		if (m_fd >= 0) {
+			::close(m_fd);
+		}
+#endif
+	}
+
+	explicit operator bool() const {
+#ifdef IMAGE_USE_PREAD
+		return m_fd >= 0;
+#else
+		return static_cast<bool>(m_file);
+#endif
+	}
+
+	bool read(uint64_t offset, uint8_t *dst, size_t count) {
+#ifdef IMAGE_USE_PREAD
+		while (count > 0) {
+			const ssize_t done = ::pread(m_fd, dst, count, static_cast<off_t>(offset));
+			if (done <= 0) {
+				return false;
+			}
+
+			dst += done;
+			offset += done;
+			count -= done;
+		}
+
+		return true;
+#else
+		m_file.seekg(offset, std::ios::beg);
+		m_file.read((char*)dst, count);
+
+		return static_cast<bool>(m_file);
+#endif
+	}
+
+private:
+#ifdef IMAGE_USE_PREAD
+	int m_fd;
+#else
+	std::ifstream m_file;
+#endif
+};
+
+} // namespace
 
 Image::Image(const std::string &path)
-	: m_imagePath(path) {
+	: m_imagePath(path)
+	, m_width(0)
+	, m_height(0)
+	, m_tilesPerRow(0)
+	, m_passableStride(0)
+	, m_layout(Layout::ROW_MAJOR)
+	, m_decodeThreads(1)
+	, m_outputBits(24)
+	, m_pageBudget(size_t(256) << 20)
+	, m_modified(false) {
 
 }
 
 bool Image::loadImage() {
+	TRACE_SCOPE("load");
+
 	if (m_imagePath.empty()) {
 		std::cout << "There is no set path!\n";
 		return false;
 	}
 
+	Header header;
+
+	if (!readHeader(header)) {
+		return false;
+	}
+
+	//Set dimensions
+	m_width = static_cast<Point::dim_t>(header.width);
+	m_height = static_cast<Point::dim_t>(header.height);
+
+	//Reserve enough space
+	allocate();
+	m_modified = false;
+
+	if (m_layout == Layout::PAGED && !*m_pages) {
+		std::cout << "Cannot create the page file!\n";
+		return false;
+	}
+
+	//Split the rows in contiguous ranges, one for every thread
+	const size_t chunks = std::min<size_t>(m_decodeThreads, header.height);
+	std::atomic<bool> decoded(true);
+
+	if (header.compression != COMPRESSION_NONE) {
+		decoded = decodeCompressed(header);
+	}
+	else if (chunks <= 1) {
+		decoded = decodeRows(header, 0, header.height);
+	}
+	else {
+		ThreadPool::shared().parallelFor(chunks, [&](size_t chunk) {
+			if (!decodeRows(header, header.height * chunk / chunks, header.height * (chunk + 1) / chunks)) {
+				decoded = false;
+			}
+		});
+	}
+
+	if (!decoded) {
+		std::cout << "The image was not loaded correctly!\n";
+		return false;
+	}
+
+	return true;
+}
+
+void Image::prefetch() const {
+#if defined(IMAGE_USE_PREAD) && defined(POSIX_FADV_WILLNEED)
+	const int fd = ::open(m_imagePath.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return;
+	}
+
+	//	The read ahead goes on after the file is closed
+	posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+	::close(fd);
+#endif
+}
+
+bool Image::saveImage(const std::string &path) const {
+	TRACE_SCOPE("save");
+
+	return writeImage(path, nullptr);
+}
+
+bool Image::saveImage(const std::string &path, const PathOverlay &overlay) const {
+	TRACE_SCOPE("save");
+
+	Header header;
+
+	if (!readHeader(header)) {
+		return false;
+	}
+
+	const uint32_t width = header.width, height = header.height;
+
+	//The overlay was drawn on the loaded pixels
+	if (static_cast<Point::dim_t>(width) != m_width || static_cast<Point::dim_t>(height) != m_height) {
+		std::cout << "The source image has changed!\n";
+		return false;
+	}
+
+	//Only the triplets of 24 bits per pixel rows can be patched in place, and only if the loaded
+	//pixels are still the ones of the file
+	if (header.bitsPerPixel != 24 || m_outputBits != 24 || m_modified) {
+		return writeImage(path, &overlay);
+	}
+
+	BlockReader reader(m_imagePath);
+	if (!reader) {
+		std::cout << "Cannot open the image path!\n";
+		return false;
+	}
+
+	std::ofstream ofile(path, std::ios::binary | std::ios::trunc);
+	if (!ofile) {
+		std::cout << "Could not load the output file!\n";
+		return false;
+	}
+
+	writeHeader(ofile, width, height, std::vector<uint32_t>());
+
+	//BMP rows are aligned at 4 bytes
+	const size_t rowBytes = static_cast<size_t>(width) * 3;
+	const size_t stride = (rowBytes + 3) / 4 * 4;
+
+	const size_t rowsPerBlock = std::max<size_t>(1, ROWS_BLOCK_BYTES / stride);
+	std::vector<uint8_t> block(rowsPerBlock * stride);
+
+	//The pixels are stored as 0x00RRGGBB, the file keeps them as B, G, R
+	const uint8_t color[] = {
+		static_cast<uint8_t>(overlay.color()),
+		static_cast<uint8_t>(overlay.color() >> 8),
+		static_cast<uint8_t>(overlay.color() >> 16)
+	};
+
+	for (size_t row = 0; row < height; row += rowsPerBlock) {
+		const size_t rows = std::min<size_t>(rowsPerBlock, height - row);
+
+		//The padding after the last row of the file may be missing
+		{
+			TRACE_SCOPE("read", static_cast<int64_t>(row));
+			if (!reader.read(header.dataOffset + row * stride, block.data(), (rows - 1) * stride + rowBytes)) {
+				std::cout << "The image was not read correctly!\n";
+				return false;
+			}
+		}
+
+		for (size_t i = 0; i < rows; ++i) {
+			uint8_t *data = &block[i * stride];
+
+			//The rows are stored bottom-up
+			overlay.visitRow(static_cast<Point::dim_t>(height - (row + i) - 1), [&](Point::dim_t y) {
+				std::copy(color, color + 3, data + static_cast<size_t>(y) * 3);
+			});
+
+			std::fill(data + rowBytes, data + stride, 0);
+		}
+
+		ofile.write((const char *)block.data(), rows * stride);
+	}
+
+	if (ofile.fail()) {
+		std::cout << "The image might be not saved properly!\n";
+	}
+
+	bool output = ofile.good();
+	ofile.clear();
+	ofile.close();
+
+	return output;
+}
+
+size_t Image::size() const {
+	return static_cast<size_t>(m_width) * m_height;
+}
+
+const std::string& Image::path() const {
+	return m_imagePath;
+}
+
+void Image::setLayout(Layout layout) {
+	if (layout == m_layout) {
+		return;
+	}
+
+	//	Nothing is loaded yet, the layout will be used by loadImage()
+	if (m_width == 0 || m_height == 0) {
+		m_layout = layout;
+		return;
+	}
+
+	//	Rearrange the loaded pixels, row by row
+	Image target(m_imagePath);
+	target.m_width = m_width;
+	target.m_height = m_height;
+	target.m_layout = layout;
+	target.m_pageBudget = m_pageBudget;
+	target.allocate();
+
+	if (layout == Layout::PAGED && !*target.m_pages) {
+		std::cout << "Cannot create the page file!\n";
+		return;
+	}
+
+	std::vector<uint32_t> pixels(m_width);
+	std::vector<CellClassifier::Cell> cells(m_width);
+
+	for (Point::dim_t x = 0; x < m_height; ++x) {
+		readRow(x, pixels.data(), cells.data());
+		target.storeRow(x, pixels.data(), cells.data());
+
+		//	The passability mask is not kept for run-length encoded rows
+		for (Point::dim_t y = 0; !target.m_passable.empty() && y < m_width; ++y) {
+			if (cells[y] != CellClassifier::Cell::WALL) {
+				target.m_passable[x * target.m_passableStride + y / 64] |= uint64_t(1) << (y % 64);
+			}
+		}
+	}
+
+	m_data.swap(target.m_data);
+	m_cells.swap(target.m_cells);
+	m_passable.swap(target.m_passable);
+	m_rows.swap(target.m_rows);
+	m_pages.swap(target.m_pages);
+	m_tilesPerRow = target.m_tilesPerRow;
+	m_passableStride = target.m_passableStride;
+	m_layout = layout;
+}
+
+Image::Layout Image::layout() const {
+	return m_layout;
+}
+
+void Image::setDecodeThreads(unsigned threads) {
+	m_decodeThreads = threads > 0 ? threads : ThreadPool::shared().size();
+}
+
+unsigned Image::decodeThreads() const {
+	return m_decodeThreads;
+}
+
+void Image::setOutputBitsPerPixel(unsigned bits) {
+	m_outputBits = bits == 8 ? 8 : 24;
+}
+
+unsigned Image::outputBitsPerPixel() const {
+	return m_outputBits;
+}
+
+void Image::setPageBudget(size_t bytes) {
+	m_pageBudget = bytes;
+}
+
+size_t Image::pageBudget() const {
+	return m_pageBudget;
+}
+
+bool Image::compact() const {
+	return m_layout == Layout::RLE || m_layout == Layout::PAGED;
+}
+
+bool Image::modified() const {
+	return m_modified;
+}
+
+Point::dim_t Image::width() const {
+	return m_width;
+}
+
+Point::dim_t Image::height() const {
+	return m_height;
+}
+
+uint64_t Image::contentHash() const {
+	TRACE_SCOPE("content hash");
+
+	uint64_t h = Hash::SEED;
+	const auto mix = [&](uint64_t word) {
+		h = Hash::mix(h, word);
+	};
+
+	mix(static_cast<uint64_t>(static_cast<uint32_t>(m_width)) << 32 | static_cast<uint32_t>(m_height));
+
+	std::vector<uint32_t> pixels(m_width);
+	std::vector<CellClassifier::Cell> cells(m_width);
+
+	for (Point::dim_t x = 0; x < m_height; ++x) {
+		readRow(x, pixels.data(), cells.data());
+
+		for (Point::dim_t y = 0; y < m_width; ++y) {
+			mix(static_cast<uint64_t>(cells[y]) << 32 | pixels[y]);
+		}
+	}
+
+	return Hash::finalize(h);
+}
+
+Pixel::pxl_t Image::pixel(const Point &position) const {
+	if (position.x() < 0 || position.x() >= m_height || position.y() < 0 || position.y() >= m_width) {
+		throw std::range_error("Out of bounds!");
+	}
+
+	if (m_layout == Layout::RLE) {
+		return m_rows[position.x()][findRun(position.x(), position.y())].value;
+	}
+	else if (m_layout == Layout::PAGED) {
+		Pixel::pxl_t pxl = Pixel::BLACK;
+		m_pages->read(pageTile(position.x(), position.y()), pageOffset(position.x(), position.y()) * sizeof(Pixel::pxl_t), &pxl, sizeof(pxl));
+
+		return pxl;
+	}
+
+	return m_data[index(position.x(), position.y(), m_layout)];
+}
+
+void Image::setPixel(const Point &position, const Pixel::pxl_t &pxl) {
+	if (position.x() < 0 || position.x() >= m_height || position.y() < 0 || position.y() >= m_width) {
+		throw std::range_error("Out of bounds!");
+	}
+
+	setPixelUnchecked(position.x(), position.y(), pxl);
+}
+
+void Image::setPixelUnchecked(Point::dim_t x, Point::dim_t y, const Pixel::pxl_t &pxl) {
+	m_modified = true;
+
+	if (m_layout == Layout::RLE) {
+		setRunPixel(x, y, pxl);
+		return;
+	}
+
+	const CellClassifier::Cell cell = CellClassifier::classify(pxl);
+
+	if (m_layout == Layout::PAGED) {
+		const size_t area = static_cast<size_t>(PAGE_SIZE) * PAGE_SIZE;
+		const size_t tile = pageTile(x, y), offset = pageOffset(x, y);
+
+		m_pages->write(tile, offset * sizeof(Pixel::pxl_t), &pxl, sizeof(pxl));
+		m_pages->write(tile, area * sizeof(Pixel::pxl_t) + offset, &cell, sizeof(cell));
+	}
+	else {
+		const size_t pos = index(x, y, m_layout);
+		m_data[pos] = pxl;
+		m_cells[pos] = cell;
+	}
+
+	//	Keep the passability mask up to date
+	uint64_t &word = m_passable[x * m_passableStride + y / 64];
+	const uint64_t bit = uint64_t(1) << (y % 64);
+
+	if (cell == CellClassifier::Cell::WALL) {
+		word &= ~bit;
+	}
+	else {
+		word |= bit;
+	}
+}
+
+CellClassifier::Cell Image::cell(const Point &position) const {
+	if (position.x() < 0 || position.x() >= m_height || position.y() < 0 || position.y() >= m_width) {
+		throw std::range_error("Out of bounds!");
+	}
+
+	if (m_layout == Layout::RLE) {
+		return m_rows[position.x()][findRun(position.x(), position.y())].cell;
+	}
+	else if (m_layout == Layout::PAGED) {
+		const size_t area = static_cast<size_t>(PAGE_SIZE) * PAGE_SIZE;
+
+		CellClassifier::Cell cell = CellClassifier::Cell::WALL;
+		m_pages->read(pageTile(position.x(), position.y()), area * sizeof(Pixel::pxl_t) + pageOffset(position.x(), position.y()), &cell, sizeof(cell));
+
+		return cell;
+	}
+
+	return m_cells[index(position.x(), position.y(), m_layout)];
+}
+
+bool Image::passable(Point::dim_t x, Point::dim_t y) const {
+	if (x < 0 || x >= m_height || y < 0 || y >= m_width) {
+		return false;
+	}
+
+	if (m_layout == Layout::RLE) {
+		return m_rows[x][findRun(x, y)].cell != CellClassifier::Cell::WALL;
+	}
+
+	return (m_passable[x * m_passableStride + y / 64] >> (y % 64)) & 1;
+}
+
+Point::dim_t Image::runLength(Point::dim_t x, Point::dim_t y, Point::dim_t dy) const {
+	if (m_layout != Layout::RLE || x < 0 || x >= m_height || y < 0 || y >= m_width) {
+		return 0;
+	}
+
+	const auto &row = m_rows[x];
+	const size_t run = findRun(x, y);
+
+	if (dy > 0) {
+		const Point::dim_t end = run + 1 < row.size() ? row[run + 1].start : m_width;
+		return end - y - 1;
+	}
+
+	return y - row[run].start;
+}
+
+void Image::allocate() {
+	m_tilesPerRow = (m_width + TILE_SIZE - 1) / TILE_SIZE;
+
+	//	Every row of the passability mask starts at a new word
+	m_passableStride = (static_cast<size_t>(m_width) + 63) / 64;
+
+	if (m_layout == Layout::RLE) {
+		m_data.assign(0, Pixel::BLACK);
+		m_cells.assign(0, CellClassifier::Cell::WALL);
+		m_passable.assign(0, 0);
+		m_rows.assign(m_height, std::vector<Run>());
+		m_pages.reset();
+		return;
+	}
+	else if (m_layout == Layout::PAGED) {
+		//	The tiles start as zeros, which are black walls
+		const size_t pagesPerRow = (static_cast<size_t>(m_width) + PAGE_SIZE - 1) / PAGE_SIZE;
+		const size_t pagesPerColumn = (static_cast<size_t>(m_height) + PAGE_SIZE - 1) / PAGE_SIZE;
+		const size_t area = static_cast<size_t>(PAGE_SIZE) * PAGE_SIZE;
+
+		m_data.assign(0, Pixel::BLACK);
+		m_cells.assign(0, CellClassifier::Cell::WALL);
+		m_passable.assign(m_passableStride * m_height, 0);
+		m_rows.clear();
+		const size_t tileBytes = area * (sizeof(Pixel::pxl_t) + sizeof(CellClassifier::Cell));
+
+		//	A whole row of tiles fits, so the scans of the rows(decoding, analysis, saving) read every tile once
+		const size_t budget = std::max(m_pageBudget, (pagesPerRow + 1) * tileBytes);
+
+		m_pages = std::make_shared<TileCache>(m_imagePath + ".pages", tileBytes, pagesPerRow * pagesPerColumn, budget);
+		return;
+	}
+
+	m_data.assign(storageSize(m_layout), Pixel::BLACK);
+	m_cells.assign(storageSize(m_layout), CellClassifier::Cell::WALL);
+	m_passable.assign(m_passableStride * m_height, 0);
+	m_rows.clear();
+	m_pages.reset();
+}
+
+bool Image::readHeader(Header &header) const {
 	std::ifstream ifile(m_imagePath, std::ios::binary);
 	if (!ifile) {
 		std::cout << "Cannot open the image path!\n";
@@ -29,7 +553,6 @@ bool Image::loadImage() {
 	const uint32_t headerBM = 0x4D42;
 
 	uint16_t buffer16 = 0;
-	uint32_t buffer32 = 0;
 
 	//Check "BM"
 	ifile.read((char*)&buffer16, sizeof(buffer16));
@@ -47,18 +570,22 @@ bool Image::loadImage() {
 	ifile.seekg(10, std::ios::beg);
 
 	//The distance to the pixels
-	uint32_t imageDataOffset = 0;
-	ifile.read((char*)&imageDataOffset, sizeof(imageDataOffset));
+	ifile.read((char*)&header.dataOffset, sizeof(header.dataOffset));
 
-	//Skip bytes to width/height
-	ifile.seekg(18, std::ios::beg);
+	//The size of the information header, the palette follows it
+	uint32_t informationSize = 0;
+	ifile.read((char*)&informationSize, sizeof(informationSize));
+	if (informationSize < 40) {
+		std::cout << "Unsupported image header!\n";
+		clearAndClose();
+		return false;
+	}
 
-	//Buffer variables for imageWidth and imageHeight
-	uint32_t width = 0, height = 0;
-	ifile.read((char*)&width, sizeof(width));
-	ifile.read((char*)&height, sizeof(height));
+	//Dimensions of the image
+	ifile.read((char*)&header.width, sizeof(header.width));
+	ifile.read((char*)&header.height, sizeof(header.height));
 
-	if (width == 0 || height == 0) {
+	if (header.width == 0 || header.height == 0) {
 		std::cout << "Invalid image size!\n";
 		clearAndClose();
 		return false;
@@ -73,70 +600,67 @@ bool Image::loadImage() {
 		return false;
 	}
 
-	//Check if there are 24 bits per pixel
-	uint16_t bitsPerPixel;
-	ifile.read((char*)&bitsPerPixel, sizeof(bitsPerPixel));
-	if (bitsPerPixel != 24) {
-		std::cout << "No 24 bits on pixel!\n";
+	//Check if there are 24 bits per pixel or an index in a palette
+	ifile.read((char*)&header.bitsPerPixel, sizeof(header.bitsPerPixel));
+	if (header.bitsPerPixel != 24 && header.bitsPerPixel != 8 && header.bitsPerPixel != 4 && header.bitsPerPixel != 1) {
+		std::cout << "No 1, 4, 8 or 24 bits on pixel!\n";
 		clearAndClose();
 		return false;
 	}
 
-	//Check for compression
-	ifile.read((char*)&buffer32, sizeof(buffer32));
-	if (buffer32 != 0) {
-		std::cout << "The image is compressed!\n";
+	//Check for compression, RLE8 and RLE4 match only their own bits per pixel
+	ifile.read((char*)&header.compression, sizeof(header.compression));
+	if (header.compression != COMPRESSION_NONE &&
+		!(header.compression == COMPRESSION_RLE8 && header.bitsPerPixel == 8) &&
+		!(header.compression == COMPRESSION_RLE4 && header.bitsPerPixel == 4)) {
+		std::cout << "The image compression is not supported!\n";
 		clearAndClose();
 		return false;
 	}
 
-	//Seekg to the beginning ot the pixels
-	ifile.seekg(imageDataOffset, std::ios::beg);
-
-	//Reserve enough space
-	m_data.resize(width * height);
-
-	//There is a padding
-	//BMP is aligned at 4 bytes
-	uint32_t padding = (4 - (width * 3) % 4) % 4;
-
-	for (size_t row = 0; row < height; ++row) {
-		for (size_t col = 0; col < width && ifile; ++col) {
-			size_t RGB = 0;
+	if (header.bitsPerPixel <= 8) {
+		//Number of colors in the palette, 0 means all of them
+		uint32_t colors = 0;
+		ifile.seekg(46, std::ios::beg);
+		ifile.read((char*)&colors, sizeof(colors));
 
-			ifile.read((char*)&RGB, 3);
+		const uint32_t maxColors = 1u << header.bitsPerPixel;
+		if (colors == 0 || colors > maxColors) {
+			colors = maxColors;
+		}
 
-			/*Pixel::pxlcs_t R = static_cast<Pixel::pxlcs_t>((RGB & 0xff0000) >> 16);
-			Pixel::pxlcs_t G = static_cast<Pixel::pxlcs_t>((RGB & 0xff00) >> 8);
-			Pixel::pxlcs_t B = static_cast<Pixel::pxlcs_t>(RGB & 0xff);*/
+		//The entries are stored as B, G, R, 0, which is the layout of the pixel values
+		header.palette.assign(256, static_cast<uint32_t>(Pixel::BLACK));
+		ifile.seekg(14 + informationSize, std::ios::beg);
+		ifile.read((char*)header.palette.data(), colors * sizeof(uint32_t));
 
-			//Red - Green - Blue
-			m_data[(height - row - 1) * width + col] = RGB;
+		header.paletteCells.resize(header.palette.size());
+		for (size_t i = 0; i < header.palette.size(); ++i) {
+			header.palette[i] &= 0x00FFFFFF;
+			header.paletteCells[i] = CellClassifier::classify(header.palette[i]);
 		}
-
-		ifile.seekg(padding, std::ios::cur);
 	}
 
-	//Set dimensions
-	m_width = static_cast<Point::dim_t>(width);
-	m_height = static_cast<Point::dim_t>(height);
-
-	if (ifile.fail()) {
-		std::cout << "The image was not loaded correctly!\n";
+	if (!ifile) {
+		std::cout << "The image header is not complete!\n";
 		clearAndClose();
 		return false;
 	}
 
+	//Compressed pixels are read up to the end of the file
+	ifile.seekg(0, std::ios::end);
+	const uint64_t fileSize = static_cast<uint64_t>(ifile.tellg());
+	header.dataSize = fileSize > header.dataOffset ? static_cast<uint32_t>(fileSize - header.dataOffset) : 0;
+
+	//The pixels are read separately, by the decoding threads or the streaming writer
 	clearAndClose();
 	return true;
 }
 
-bool Image::saveImage(const std::string &path) const {
-	std::ofstream ofile(path, std::ios::binary | std::ios::trunc);
-	if (!ofile) {
-		std::cout << "Could not load the output file!\n";
-		return false;
-	}
+void Image::writeHeader(std::ofstream &ofile, uint32_t width, uint32_t height, const std::vector<uint32_t> &palette) {
+	//The palette is between the headers and the pixels
+	const uint32_t dataOffset = 54 + static_cast<uint32_t>(palette.size()) * 4;
+	const uint32_t bitsPerPixel = palette.empty() ? 24 : 8;
 
 	//Header of the .bmp file
 	unsigned short fileHeader[] = {
@@ -144,20 +668,20 @@ bool Image::saveImage(const std::string &path) const {
 		0x0000, 0x0000,	//file size, 4 bytes
 		0x0000,			//reserverd, 2 bytes
 		0x0000,			//reserved, 2 bytes
-		0x0036, 0x0000	//start of array data, 4 bytes
+		static_cast<unsigned short>(dataOffset), static_cast<unsigned short>(dataOffset >> 16)	//start of array data, 4 bytes
 	};
 
 	//Header with the image information
 	unsigned informationHeader[]{
 		0x00000028,				//BITMAPCOREHEADER, 4 bytes
-		(unsigned)m_width,		//width, 4 bytes
-		(unsigned)m_height,		//height, 4 bytes
-		0x00180001,				//1 plane, 2 bytes ; 24 bits per pixel, 2 bytes
+		width,					//width, 4 bytes
+		height,					//height, 4 bytes
+		0x00000001 | bitsPerPixel << 16,	//1 plane, 2 bytes ; bits per pixel, 2 bytes
 		0x00000000,				//compression - 0, 4 bytes
 		0x00000000,				//raw bitmap data, 4 bytes
 		0x00000000,				//pixels per point - horizontal, 4 bytes 
 		0x00000000,				//pixels per point - vertical, 4 bytes 
-		0x00000000,				//number of colors in the palette, 4 bytes
+		static_cast<unsigned>(palette.size()),	//number of colors in the palette, 4 bytes
 		0x00000000				//0 means all colors are important, 4 bytes
 	};
 
@@ -165,18 +689,294 @@ bool Image::saveImage(const std::string &path) const {
 	ofile.write((const char *)&fileHeader, 14);			//fileHeader - 14 bytes
 	ofile.write((const char *)&informationHeader, 40);	//informationHeader - 40 bytes
 
+	//The pixels are stored as 0x00RRGGBB, the palette keeps them as B, G, R, 0
+	ofile.write((const char *)palette.data(), palette.size() * sizeof(uint32_t));
+}
+
+bool Image::decodeRows(const Header &header, size_t firstRow, size_t lastRow) {
+	TRACE_SCOPE("decode chunk", static_cast<int64_t>(firstRow));
+
+	BlockReader reader(m_imagePath);
+	if (!reader) {
+		return false;
+	}
+
+	//BMP rows are aligned at 4 bytes
+	const size_t rowBytes = (static_cast<size_t>(m_width) * header.bitsPerPixel + 7) / 8;
+	const size_t stride = (rowBytes + 3) / 4 * 4;
+
+	//Read several rows at once, the classifier may read a few bytes after the last triplet
+	const size_t rowsPerBlock = std::max<size_t>(1, ROWS_BLOCK_BYTES / stride);
+	std::vector<uint8_t> block(rowsPerBlock * stride + CellClassifier::ROW_SLACK, 0);
+
+	std::vector<uint32_t> pixels(m_width);
+	std::vector<CellClassifier::Cell> cells(m_width);
+
+	//Indices of 1 and 4 bits per pixel rows, unpacked to a byte each
+	std::vector<uint8_t> indices(header.bitsPerPixel < 8 ? m_width : 0);
+
+	//Run-length encoded rows do not keep a passability mask
+	std::vector<uint64_t> passable(m_layout == Layout::RLE ? m_passableStride : 0);
+
+	for (size_t row = firstRow; row < lastRow; row += rowsPerBlock) {
+		const size_t rows = std::min(rowsPerBlock, lastRow - row);
+
+		//The padding after the last row of the file may be missing
+		{
+			TRACE_SCOPE("read", static_cast<int64_t>(row));
+			if (!reader.read(header.dataOffset + row * stride, block.data(), (rows - 1) * stride + rowBytes)) {
+				return false;
+			}
+		}
+
+		TRACE_SCOPE("classify", static_cast<int64_t>(row));
+		for (size_t i = 0; i < rows; ++i) {
+			//The rows are stored bottom-up
+			const Point::dim_t x = static_cast<Point::dim_t>(m_height - (row + i) - 1);
+			const uint8_t *data = &block[i * stride];
+
+			if (header.bitsPerPixel == 8) {
+				storeIndexedRow(header, x, data, pixels.data(), cells.data(), passable);
+				continue;
+			}
+			else if (header.bitsPerPixel < 8) {
+				//The first pixel is in the high bits of a byte
+				const unsigned bits = header.bitsPerPixel;
+				const unsigned perByte = 8 / bits;
+				const uint8_t low = static_cast<uint8_t>((1u << bits) - 1);
+
+				for (Point::dim_t y = 0; y < m_width; ++y) {
+					indices[y] = (data[y / perByte] >> ((perByte - 1 - y % perByte) * bits)) & low;
+				}
+
+				storeIndexedRow(header, x, indices.data(), pixels.data(), cells.data(), passable);
+				continue;
+			}
+
+			uint64_t *mask = passable.data();
+			if (passable.empty()) {
+				mask = &m_passable[x * m_passableStride];
+			}
+			else {
+				std::fill(passable.begin(), passable.end(), 0);
+			}
+
+			//Unpack and classify the pixels in a single pass
+			CellClassifier::classifyRow(data, m_width, pixels.data(), cells.data(), mask);
+			storeRow(x, pixels.data(), cells.data());
+		}
+	}
+
+	return true;
+}
+
+bool Image::decodeCompressed(const Header &header) {
+	TRACE_SCOPE("decode compressed");
+
+	BlockReader reader(m_imagePath);
+	if (!reader) {
+		return false;
+	}
+
+	//The stream is read in blocks, its end ends the image
+	std::vector<uint8_t> block(std::max<size_t>(1, std::min<size_t>(ROWS_BLOCK_BYTES, header.dataSize)));
+	size_t blockBegin = 0, blockSize = 0, position = 0;
+	bool failed = false;
+
+	const auto next = [&](uint8_t &byte) {
+		if (position >= blockBegin + blockSize) {
+			if (position >= header.dataSize) {
+				return false;
+			}
+
+			TRACE_SCOPE("read", static_cast<int64_t>(position));
+			blockBegin = position;
+			blockSize = std::min<size_t>(block.size(), header.dataSize - position);
+
+			if (!reader.read(header.dataOffset + blockBegin, block.data(), blockSize)) {
+				failed = true;
+				return false;
+			}
+		}
+
+		byte = block[position++ - blockBegin];
+		return true;
+	};
+
+	//The pixels skipped by the stream keep index 0
+	std::vector<uint8_t> indices(m_width, 0);
+	std::vector<uint32_t> pixels(m_width);
+	std::vector<CellClassifier::Cell> cells(m_width);
+	std::vector<uint64_t> passable(m_layout == Layout::RLE ? m_passableStride : 0);
+
+	const bool rle4 = header.compression == COMPRESSION_RLE4;
+	size_t row = 0, col = 0;
+
+	//Pixels past the end of a row are dropped
+	const auto put = [&](uint8_t index) {
+		if (col < indices.size()) {
+			indices[col] = index;
+		}
+
+		++col;
+	};
+
+	//The rows are stored bottom-up
+	const auto endRow = [&]() {
+		storeIndexedRow(header, static_cast<Point::dim_t>(m_height - row - 1), indices.data(), pixels.data(), cells.data(), passable);
+		std::fill(indices.begin(), indices.end(), 0);
+
+		++row;
+		col = 0;
+	};
+
+	uint8_t count = 0, value = 0;
+
+	while (row < static_cast<size_t>(m_height) && next(count) && next(value)) {
+		if (count > 0) {
+			//Encoded mode: *count* pixels of one index, or of the two indices in the nibbles of RLE4
+			for (unsigned i = 0; i < count; ++i) {
+				put(rle4 ? (i % 2 == 0 ? value >> 4 : value & 0x0F) : value);
+			}
+		}
+		else if (value == 0) {
+			//End of line
+			endRow();
+		}
+		else if (value == 1) {
+			//End of bitmap
+			break;
+		}
+		else if (value == 2) {
+			//Delta: the next pixel is dx to the right and dy rows up
+			uint8_t dx = 0, dy = 0;
+			if (!next(dx) || !next(dy)) {
+				break;
+			}
+
+			for (; dy > 0 && row < static_cast<size_t>(m_height); --dy) {
+				const size_t column = col;
+				endRow();
+				col = column;
+			}
+
+			col += dx;
+		}
+		else {
+			//Absolute mode: *value* indices as they are, padded to 2 bytes
+			const size_t bytes = rle4 ? (value + 1) / 2 : value;
+			uint8_t byte = 0;
+
+			for (size_t i = 0; i < bytes && next(byte); ++i) {
+				if (!rle4) {
+					put(byte);
+					continue;
+				}
+
+				put(byte >> 4);
+				if (2 * i + 1 < value) {
+					put(byte & 0x0F);
+				}
+			}
+
+			if (bytes % 2 == 1) {
+				next(byte);
+			}
+		}
+	}
+
+	//The rows after the end of the bitmap
+	while (row < static_cast<size_t>(m_height)) {
+		endRow();
+	}
+
+	return !failed;
+}
+
+void Image::storeIndexedRow(const Header &header, Point::dim_t x, const uint8_t *indices, uint32_t *pixels, CellClassifier::Cell *cells, std::vector<uint64_t> &passable) {
+	//Run-length encoded rows do not keep a passability mask
+	uint64_t *mask = passable.data();
+	if (passable.empty()) {
+		mask = &m_passable[x * m_passableStride];
+	}
+	else {
+		std::fill(passable.begin(), passable.end(), 0);
+	}
+
+	CellClassifier::classifyIndices(indices, m_width, header.palette.data(), header.paletteCells.data(), pixels, cells, mask);
+	storeRow(x, pixels, cells);
+}
+
+bool Image::writeImage(const std::string &path, const PathOverlay *overlay) const {
+	std::vector<uint32_t> pixels(m_width);
+	std::vector<CellClassifier::Cell> cells(m_width);
+
+	//Reads row x with the pixels of the overlay
+	const auto loadRow = [&](Point::dim_t x) {
+		readRow(x, pixels.data(), cells.data());
+
+		if (overlay) {
+			overlay->visitRow(x, [&](Point::dim_t y) {
+				pixels[y] = static_cast<uint32_t>(overlay->color());
+			});
+		}
+	};
+
+	//The palette of an 8 bits per pixel output, in the order the colors are found
+	std::vector<uint32_t> palette;
+	std::unordered_map<uint32_t, uint8_t> indices;
+
+	if (m_outputBits == 8) {
+		for (Point::dim_t x = 0; x < m_height && palette.size() <= 256; ++x) {
+			loadRow(x);
+
+			for (Point::dim_t y = 0; y < m_width && palette.size() <= 256; ++y) {
+				if ((y == 0 || pixels[y] != pixels[y - 1]) && indices.emplace(pixels[y], static_cast<uint8_t>(palette.size())).second) {
+					palette.push_back(pixels[y]);
+				}
+			}
+		}
+
+		if (palette.size() > 256) {
+			std::cout << "The image has more than 256 colors, it is saved with 24 bits per pixel!\n";
+			palette.clear();
+		}
+	}
+
+	std::ofstream ofile(path, std::ios::binary | std::ios::trunc);
+	if (!ofile) {
+		std::cout << "Could not load the output file!\n";
+		return false;
+	}
+
+	writeHeader(ofile, static_cast<uint32_t>(m_width), static_cast<uint32_t>(m_height), palette);
+
 	//BMP is aligned at 4 bytes
-	size_t padding = (4 - (m_width * 3) % 4) % 4;
-	const size_t buffer = 0;
+	const size_t rowBytes = static_cast<size_t>(m_width) * (palette.empty() ? 3 : 1);
+	std::vector<uint8_t> data((rowBytes + 3) / 4 * 4, 0);
 
 	for (Point::dim_t row = 0; row < m_height; ++row) {
-		for (Point::dim_t col = 0; col < m_width; ++col) {
-			const auto &pixel = m_data[(m_height - row - 1) * m_width + col];
-			//uint32_t RGB = pixel.R() << 16u | pixel.G() << 8u | pixel.B();
-			ofile.write((const char *)&pixel, 3);
+		loadRow(m_height - row - 1);
+
+		if (palette.empty()) {
+			//The pixels are stored as 0x00RRGGBB, the file keeps them as B, G, R
+			for (Point::dim_t y = 0; y < m_width; ++y) {
+				std::copy((const uint8_t *)&pixels[y], (const uint8_t *)&pixels[y] + 3, &data[y * 3]);
+			}
+		}
+		else {
+			uint8_t index = indices.find(pixels[0])->second;
+
+			for (Point::dim_t y = 0; y < m_width; ++y) {
+				if (y > 0 && pixels[y] != pixels[y - 1]) {
+					index = indices.find(pixels[y])->second;
+				}
+
+				data[y] = index;
+			}
 		}
 
-		ofile.write((const char *)&buffer, padding);
+		ofile.write((const char *)data.data(), data.size());
 	}
 
 	if (ofile.fail()) {
@@ -190,34 +990,164 @@ bool Image::saveImage(const std::string &path) const {
 	return output;
 }
 
-size_t Image::size() const {
-	return m_data.size();
-}
+void Image::storeRow(Point::dim_t x, const uint32_t *pixels, const CellClassifier::Cell *cells) {
+	if (m_layout == Layout::RLE) {
+		std::vector<Run> runs;
 
-const std::string& Image::path() const {
-	return m_imagePath;
+		for (Point::dim_t y = 0; y < m_width; ++y) {
+			if (runs.empty() || runs.back().value != pixels[y]) {
+				runs.push_back(Run{ y, cells[y], pixels[y] });
+			}
+		}
+
+		runs.shrink_to_fit();
+		m_rows[x].swap(runs);
+		return;
+	}
+	else if (m_layout == Layout::PAGED) {
+		const size_t area = static_cast<size_t>(PAGE_SIZE) * PAGE_SIZE;
+		std::vector<Pixel::pxl_t> values(PAGE_SIZE);
+
+		//	The part of the row in every tile is contiguous
+		for (Point::dim_t y = 0; y < m_width; y += PAGE_SIZE) {
+			const size_t count = std::min(PAGE_SIZE, m_width - y);
+			const size_t tile = pageTile(x, y), offset = pageOffset(x, y);
+
+			std::copy(pixels + y, pixels + y + count, values.begin());
+			m_pages->write(tile, offset * sizeof(Pixel::pxl_t), values.data(), count * sizeof(Pixel::pxl_t));
+			m_pages->write(tile, area * sizeof(Pixel::pxl_t) + offset, cells + y, count * sizeof(CellClassifier::Cell));
+		}
+
+		return;
+	}
+
+	for (Point::dim_t y = 0; y < m_width; ++y) {
+		const size_t pos = index(x, y, m_layout);
+
+		m_data[pos] = pixels[y];
+		m_cells[pos] = cells[y];
+	}
 }
 
-Point::dim_t Image::width() const {
-	return m_width;
+size_t Image::index(Point::dim_t x, Point::dim_t y, Layout layout) const {
+	if (layout == Layout::ROW_MAJOR) {
+		return static_cast<size_t>(x) * m_width + y;
+	}
+
+	//	The tile that contains the pixel and the offset of the pixel inside that tile
+	const size_t tile = static_cast<size_t>(x / TILE_SIZE) * m_tilesPerRow + y / TILE_SIZE;
+	const size_t offset = static_cast<size_t>(x % TILE_SIZE) * TILE_SIZE + y % TILE_SIZE;
+
+	return tile * TILE_SIZE * TILE_SIZE + offset;
 }
 
-Point::dim_t Image::height() const {
-	return m_height;
+size_t Image::storageSize(Layout layout) const {
+	//	Run-length encoded rows and tiles in a file are not kept in m_data
+	if (layout == Layout::RLE || layout == Layout::PAGED) {
+		return 0;
+	}
+	else if (layout == Layout::ROW_MAJOR) {
+		return static_cast<size_t>(m_width) * m_height;
+	}
+
+	//	Every tile is complete, even the ones on the right and bottom border
+	const size_t tilesPerColumn = (m_height + TILE_SIZE - 1) / TILE_SIZE;
+	return tilesPerColumn * m_tilesPerRow * TILE_SIZE * TILE_SIZE;
 }
 
-const Pixel::pxl_t& Image::pixel(const Point &position) const {
-	if (static_cast<size_t>(position.x() * m_width + position.y()) >= m_data.size()) {
-		throw std::range_error("Out of bounds!");
+void Image::readRow(Point::dim_t x, uint32_t *pixels, CellClassifier::Cell *cells) const {
+	if (m_layout == Layout::RLE) {
+		const auto &row = m_rows[x];
+
+		for (size_t run = 0; run < row.size(); ++run) {
+			const Point::dim_t end = run + 1 < row.size() ? row[run + 1].start : m_width;
+
+			for (Point::dim_t y = row[run].start; y < end; ++y) {
+				pixels[y] = static_cast<uint32_t>(row[run].value);
+				cells[y] = row[run].cell;
+			}
+		}
+
+		return;
+	}
+	else if (m_layout == Layout::PAGED) {
+		const size_t area = static_cast<size_t>(PAGE_SIZE) * PAGE_SIZE;
+		std::vector<Pixel::pxl_t> values(PAGE_SIZE);
+
+		for (Point::dim_t y = 0; y < m_width; y += PAGE_SIZE) {
+			const size_t count = std::min(PAGE_SIZE, m_width - y);
+			const size_t tile = pageTile(x, y), offset = pageOffset(x, y);
+
+			m_pages->read(tile, offset * sizeof(Pixel::pxl_t), values.data(), count * sizeof(Pixel::pxl_t));
+			m_pages->read(tile, area * sizeof(Pixel::pxl_t) + offset, cells + y, count * sizeof(CellClassifier::Cell));
+			std::copy(values.begin(), values.begin() + count, pixels + y);
+		}
+
+		return;
 	}
 
-	return m_data[position.x() * m_width + position.y()];
+	for (Point::dim_t y = 0; y < m_width; ++y) {
+		const size_t pos = index(x, y, m_layout);
+
+		pixels[y] = static_cast<uint32_t>(m_data[pos]);
+		cells[y] = m_cells[pos];
+	}
 }
 
-void Image::setPixel(const Point &position, const Pixel::pxl_t &pxl) {
-	if (static_cast<size_t>(position.x() * m_width + position.y()) >= m_data.size()) {
-		throw std::range_error("Out of bounds!");
+size_t Image::pageTile(Point::dim_t x, Point::dim_t y) const {
+	const size_t pagesPerRow = (static_cast<size_t>(m_width) + PAGE_SIZE - 1) / PAGE_SIZE;
+	return static_cast<size_t>(x / PAGE_SIZE) * pagesPerRow + y / PAGE_SIZE;
+}
+
+size_t Image::pageOffset(Point::dim_t x, Point::dim_t y) const {
+	return static_cast<size_t>(x % PAGE_SIZE) * PAGE_SIZE + y % PAGE_SIZE;
+}
+
+size_t Image::findRun(Point::dim_t x, Point::dim_t y) const {
+	const auto &row = m_rows[x];
+
+	//	The last run that starts at or before y
+	auto iter = std::upper_bound(row.begin(), row.end(), y, [](Point::dim_t col, const Run &run) {
+		return col < run.start;
+	});
+
+	return static_cast<size_t>(iter - row.begin()) - 1;
+}
+
+void Image::setRunPixel(Point::dim_t x, Point::dim_t y, const Pixel::pxl_t &pxl) {
+	auto &row = m_rows[x];
+	const size_t run = findRun(x, y);
+
+	if (row[run].value == pxl) {
+		return;
+	}
+
+	const Run old = row[run];
+	const Point::dim_t end = run + 1 < row.size() ? row[run + 1].start : m_width;
+
+	//	Split the run in up to three parts: before y, y and after y
+	std::vector<Run> parts;
+	if (old.start < y) {
+		parts.push_back(old);
+	}
+
+	parts.push_back(Run{ y, CellClassifier::classify(pxl), pxl });
+
+	if (y + 1 < end) {
+		parts.push_back(Run{ y + 1, old.cell, old.value });
+	}
+
+	row.erase(row.begin() + run);
+	row.insert(row.begin() + run, parts.begin(), parts.end());
+
+	//	Merge the new run with equal neighbours
+	const size_t single = run + (old.start < y ? 1 : 0);
+
+	if (single + 1 < row.size() && row[single + 1].value == pxl) {
+		row.erase(row.begin() + single + 1);
 	}
 
-	m_data[position.x() * m_width + position.y()] = pxl;
+	if (single > 0 && row[single - 1].value == pxl) {
+		row.erase(row.begin() + single);
+	}
 }
@@ -2,37 +2,210 @@
 #ifndef IMAGE_CLASS_HEADER
 #define IMAGE_CLASS_HEADER
 
+#include <iosfwd>
+#include <memory>
 #include <vector>
 #include <string>
 
-#include "Pixel.h"	//describes RGB value of each pixel
-#include "Point.h"	//describes the position of each pixel on the grid
+#include "Pixel.h"			//describes RGB value of each pixel
+#include "Point.h"			//describes the position of each pixel on the grid
+#include "CellClassifier.h"	//describes the type of each pixel
+#include "GridBuffer.h"		//owned or memory mapped storage of the grid
+#include "PathOverlay.h"	//sparse pixels drawn over the image
+#include "TileCache.h"		//tiles of the grid paged to a file
 
 class Image {
+	//	Stores and restores the grid without decoding the .bmp file
+	friend class MazeCache;
+	//	Scans the rows and builds the grid of the cells of a regular maze
+	friend class CoarseGrid;
+	//	Measures the maze row by row
+	friend class ImageInfo;
+
+public:
+	//	How the pixel grid is laid out in memory
+	enum class Layout {
+		ROW_MAJOR,	//	Row after row, index = x * width + y
+		TILED,		//	TILE_SIZE x TILE_SIZE tiles, every tile is stored contiguously
+		RLE,		//	Every row is a sequence of runs of equal pixels, for huge sparse mazes
+		PAGED		//	PAGE_SIZE x PAGE_SIZE tiles in a file, only the recently used ones are in memory
+	};
+
+	//	Side of a tile in pixels. A row of a tile(8 pixels * 8 bytes) fills exactly one cache line
+	static const Point::dim_t TILE_SIZE;
+
+	//	Side of a tile of the PAGED layout in pixels
+	static const Point::dim_t PAGE_SIZE;
+
+	//	Approximate number of bytes every decoding thread reads at once
+	static const size_t ROWS_BLOCK_BYTES;
+
 public:
 	Image(const std::string &path);
 	Image(const Image &r) = default;
+	Image(Image &&r) = default;
 	Image& operator=(const Image &rhs) = default;
+	Image& operator=(Image &&rhs) = default;
 	~Image() = default;
 
 public:
 	bool loadImage();
 	bool saveImage(const std::string &path) const;
 
+	//	Asks the system to start reading the file in the background, so a later loadImage() finds
+	//	it in memory. Does nothing where there is no such hint
+	void prefetch() const;
+
+	//	Writes the source .bmp file with the pixels of *overlay* patched in. The rows of 24 bits per
+	//	pixel sources are streamed from the file, so the loaded pixels are neither read nor modified.
+	//	Palettized or compressed sources, the 8 bits per pixel output and images whose pixels were
+	//	changed after loading(see modified()) are written from the loaded pixels
+	bool saveImage(const std::string &path, const PathOverlay &overlay) const;
+
 	size_t size() const;
 	const std::string& path() const;
 
+	//	Selects the layout used by the next loadImage(). If an image is already loaded
+	//	its pixels are rearranged in the new layout
+	void setLayout(Layout layout);
+	Layout layout() const;
+
+	//	Number of threads that decode the pixels of the next loadImage(), 0 means one for every core.
+	//	Every thread decodes a contiguous range of rows and the result does not depend on their count
+	void setDecodeThreads(unsigned threads);
+	unsigned decodeThreads() const;
+
+	//	Bits per pixel of the saved images, 24 or 8. An 8 bits per pixel image has a palette of the
+	//	colors it uses, an image with more than 256 colors is saved with 24 bits per pixel anyway
+	void setOutputBitsPerPixel(unsigned bits);
+	unsigned outputBitsPerPixel() const;
+
+	//	Bytes of the tiles the PAGED layout keeps in memory. The passability mask(a bit for every
+	//	pixel) is always in memory. Copies of a PAGED image share its tiles
+	void setPageBudget(size_t bytes);
+	size_t pageBudget() const;
+
+	//	Returns *true* if the pixels are not kept in arrays as large as the image(RLE and PAGED),
+	//	so the searches keep only the pixels they reach too
+	bool compact() const;
+
 	Point::dim_t width() const;
 	Point::dim_t height() const;
 
-	const Pixel::pxl_t& pixel(const Point &position) const;
+	//	64 bit hash of the dimensions, the pixels and their cells. Does not depend on the layout
+	uint64_t contentHash() const;
+
+	Pixel::pxl_t pixel(const Point &position) const;
 	void setPixel(const Point &position, const Pixel::pxl_t &pxl);
 
+	//	Same as setPixel() without the bounds check, for callers that clip their writes
+	void setPixelUnchecked(Point::dim_t x, Point::dim_t y, const Pixel::pxl_t &pxl);
+
+	//	Returns *true* if a pixel was set since the image was loaded, so it differs from its file
+	bool modified() const;
+
+	//	Type of the cell, computed while the image was decoded
+	CellClassifier::Cell cell(const Point &position) const;
+
+	//	Returns *true* if the position is inside the image and it is not a wall
+	bool passable(Point::dim_t x, Point::dim_t y) const;
+
+	//	Number of pixels after (x, y) in direction dy that are in the same run of row x.
+	//	Every pixel is a run of its own in layouts other than RLE
+	Point::dim_t runLength(Point::dim_t x, Point::dim_t y, Point::dim_t dy) const;
+
+private:
+	//	Sequence of equal pixels in a row of the RLE layout
+	struct Run {
+		Point::dim_t start;			//	Column of the first pixel
+		CellClassifier::Cell cell;
+		Pixel::pxl_t value;
+	};
+
+	//	Values of the compression field of a .bmp file
+	enum Compression : uint32_t {
+		COMPRESSION_NONE = 0,
+		COMPRESSION_RLE8 = 1,	//	8 bits per pixel, run-length encoded
+		COMPRESSION_RLE4 = 2	//	4 bits per pixel, run-length encoded
+	};
+
+	//	Layout of the pixels in the source .bmp file
+	struct Header {
+		uint32_t dataOffset = 0;
+		uint32_t dataSize = 0;			//	Bytes from dataOffset to the end of the file
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint16_t bitsPerPixel = 0;		//	1, 4, 8 or 24
+		uint32_t compression = COMPRESSION_NONE;
+
+		//	Colors of the indices and their cells, classified once for the whole image.
+		//	Always 256 entries for indexed images, the indices past the palette of the file are walls
+		std::vector<uint32_t> palette;
+		std::vector<CellClassifier::Cell> paletteCells;
+	};
+
+private:
+	//	Allocates the storage of the current layout for the current dimensions
+	void allocate();
+
+	//	Position of pixel (x, y) in m_data for the given layout
+	size_t index(Point::dim_t x, Point::dim_t y, Layout layout) const;
+
+	//	Number of elements m_data needs for the current dimensions and the given layout
+	size_t storageSize(Layout layout) const;
+
+	//	Reads and validates the header and the palette of the source .bmp file
+	bool readHeader(Header &header) const;
+
+	//	Writes the headers of a .bmp file, 24 bits per pixel without a palette and 8 bits per pixel with one
+	static void writeHeader(std::ofstream &ofile, uint32_t width, uint32_t height, const std::vector<uint32_t> &palette);
+
+	//	Reads, classifies and stores the rows [firstRow, lastRow) of an uncompressed .bmp file(bottom-up order)
+	bool decodeRows(const Header &header, size_t firstRow, size_t lastRow);
+
+	//	Decodes the whole RLE8 or RLE4 stream of a compressed .bmp file. The runs of a row start
+	//	where the runs of the previous row end, so the rows are decoded by a single thread
+	bool decodeCompressed(const Header &header);
+
+	//	Classifies a row of palette indices and stores it
+	void storeIndexedRow(const Header &header, Point::dim_t x, const uint8_t *indices, uint32_t *pixels, CellClassifier::Cell *cells, std::vector<uint64_t> &passable);
+
+	//	Writes the loaded pixels with the pixels of *overlay*, if any, in the output format
+	bool writeImage(const std::string &path, const PathOverlay *overlay) const;
+
+	//	Copies a decoded row of pixels and their cells in the storage of the current layout
+	void storeRow(Point::dim_t x, const uint32_t *pixels, const CellClassifier::Cell *cells);
+
+	//	Reads a whole row of pixels and their cells from the storage of the current layout
+	void readRow(Point::dim_t x, uint32_t *pixels, CellClassifier::Cell *cells) const;
+
+	//	Index of the run of row x that contains column y(RLE layout only)
+	size_t findRun(Point::dim_t x, Point::dim_t y) const;
+
+	//	Changes a single pixel of a run-length encoded row
+	void setRunPixel(Point::dim_t x, Point::dim_t y, const Pixel::pxl_t &pxl);
+
+	//	Tile of the PAGED layout that contains pixel (x, y) and the position of the pixel inside it.
+	//	A tile keeps the values of its pixels, then their cells
+	size_t pageTile(Point::dim_t x, Point::dim_t y) const;
+	size_t pageOffset(Point::dim_t x, Point::dim_t y) const;
+
 private:
 	std::string m_imagePath;
-	std::vector<Pixel::pxl_t> m_data;
+	GridBuffer<Pixel::pxl_t> m_data;			//	Not used by the RLE layout
+	GridBuffer<CellClassifier::Cell> m_cells;	//	Same layout as m_data
+	GridBuffer<uint64_t> m_passable;			//	One bit for every pixel, row after row(not used by RLE)
+	std::vector<std::vector<Run>> m_rows;		//	Runs of every row(RLE layout only)
+	std::shared_ptr<TileCache> m_pages;			//	Pixels and cells(PAGED layout only)
 	Point::dim_t m_width;
 	Point::dim_t m_height;
+	Point::dim_t m_tilesPerRow;	//	Number of tiles in a row of tiles(TILED layout only)
+	size_t m_passableStride;	//	Number of words in a row of m_passable
+	Layout m_layout;
+	unsigned m_decodeThreads;
+	unsigned m_outputBits;		//	Bits per pixel of the saved images
+	size_t m_pageBudget;		//	Bytes of the resident tiles(PAGED layout only)
+	bool m_modified;			//	A pixel was set after loadImage()
 };
 
 #endif // !IMAGE_CLASS_HEADER
@@ -1,45 +1,70 @@
 #include <iostream>
+#include <algorithm>
+#include <iterator>
 #include <stdexcept>
+#include <deque>
 #include <queue>
+#include <unordered_set>
+#include <utility>
 #include "ImageInfo.h"
+#include "CoarseGrid.h"
+#include "Trace.h"
+#include "Workspace.h"
 
 //	Set the width of the keys
 const int ImageInfo::KEY_WIDTH = 20;
 
 ImageInfo::ImageInfo(const Image &img)
 	: m_image(img)
-	, m_start(Point{ -1, -1 }) {
+	, m_start(Point{ -1, -1 })
+	, m_keyWidth(KEY_WIDTH)
+	, m_measured(false) {
 
 }
 
-void ImageInfo::analyzeImage() {
+ImageInfo::ImageInfo(Image &&img)
+	: m_image(std::move(img))
+	, m_start(Point{ -1, -1 })
+	, m_keyWidth(KEY_WIDTH)
+	, m_measured(false) {
+
+}
+
+void ImageInfo::analyzeImage(Workspace *workspace) {
+	TRACE_SCOPE("analyze");
+
 	//	Vector of visited pixels
-	std::vector<bool> visited(m_image.size(), false);
+	std::vector<bool> local;
+	std::vector<bool> &visited = workspace ? workspace->m_visited : local;
+	visited.assign(m_image.size(), false);
+
+	std::pmr::memory_resource *memory = workspace ? workspace->memory() : std::pmr::get_default_resource();
 
 	for (Point::dim_t row = 0, height = m_image.height(); row < height; ++row) {
 		for (Point::dim_t col = 0, width = m_image.width(); col < width; ++col) {
-			if (visited[row * m_image.width() + col]) {
+			if (visited[static_cast<size_t>(row) * m_image.width() + col]) {
 				continue;
 			}
 
-			//	The color of the current pixel
+			//	The color of the current pixel and its type
 			const auto &pxl = m_image.pixel(Point{ row, col });
+			const auto cell = m_image.cell(Point{ row, col });
 
 			//	Add keys
-			if (color(pxl) && isKey(pxl, m_image, row, col, visited)) {
+			if (cell == CellClassifier::Cell::COLOR && isKey(pxl, m_image, row, col, &visited)) {
 				m_keys[pxl].push_back(Point{ row + ImageInfo::KEY_WIDTH / 2,col + ImageInfo::KEY_WIDTH / 2 });
 			}
 			//	Find the starting point
-			else if (m_start.x() == -1 && m_start.y() == -1 && pxl == Pixel::START) {
+			else if (m_start.x() == -1 && m_start.y() == -1 && cell == CellClassifier::Cell::START) {
 				m_start = Point{ row, col };
 			}
 			//	Add ending points
-			else if (pxl == Pixel::END) {
+			else if (cell == CellClassifier::Cell::END) {
 				m_ends.push_back(Point{ row, col });
 
 				//	Fill the ending zone, because we do not want 
 				//	to add several pixels for the same figure
-				fillZone(Point{ row, col }, m_image, visited);
+				fillZone(Point{ row, col }, m_image, visited, memory);
 			}
 		}
 	}
@@ -47,20 +72,16 @@ void ImageInfo::analyzeImage() {
 	if (m_start.x() == -1 || m_start.y() == -1) {
 		throw std::logic_error("Starting point was not found!");
 	}
+
+	measure();
 }
 
 void ImageInfo::saveImage() const {
-	//	Construct the output path
-	std::string output = m_image.path();
-
-	while (output.back() != '.') {
-		output.pop_back();
-	}
-
-	output.pop_back();
-	output.append("_output.bmp");
+	m_image.saveImage(outputPath());
+}
 
-	m_image.saveImage(output);
+void ImageInfo::saveImage(const PathOverlay &overlay) const {
+	m_image.saveImage(outputPath(), overlay);
 }
 
 Image& ImageInfo::getImage() {
@@ -83,14 +104,259 @@ const ImageInfo::EndsContainer& ImageInfo::getEnds() const {
 	return m_ends;
 }
 
+void ImageInfo::buildLandmarks(unsigned count, const SearchPolicy::Movement &movement) {
+	auto landmarks = std::make_shared<Landmarks>();
+
+	if (count > 0 && landmarks->build(m_image, m_start, count, movement)) {
+		m_landmarks = landmarks;
+	}
+	else {
+		m_landmarks.reset();
+	}
+}
+
+const Landmarks* ImageInfo::landmarks() const {
+	return m_landmarks.get();
+}
+
+bool ImageInfo::buildCoarseGrid() {
+	auto grid = std::make_shared<CoarseGrid>();
+
+	if (grid->build(*this)) {
+		m_coarse = grid;
+		return true;
+	}
+
+	m_coarse.reset();
+	return false;
+}
+
+CoarseGrid* ImageInfo::coarseGrid() {
+	return m_coarse.get();
+}
+
+const ImageInfo::Statistics& ImageInfo::statistics() {
+	if (!m_measured) {
+		measure();
+	}
+
+	return m_statistics;
+}
+
+double ImageInfo::Statistics::wallDensity() const {
+	return pixels > 0 ? static_cast<double>(walls) / pixels : 0.0;
+}
+
+double ImageInfo::Statistics::meanRun() const {
+	return free > 0 ? static_cast<double>(runSquares) / free : 0.0;
+}
+
+double ImageInfo::Statistics::meanColumn() const {
+	return free > 0 ? static_cast<double>(columnSquares) / free : 0.0;
+}
+
+void ImageInfo::measure() {
+	TRACE_SCOPE("measure");
+
+	//	Horizontal run of pixels of the same kind, *label* is its zone among the zones of its row
+	struct Run {
+		Point::dim_t begin;
+		Point::dim_t end;
+		uint8_t kind;
+		uint32_t label;
+	};
+
+	enum Kind : uint8_t { FREE, WALL, COLOR, KINDS };
+
+	const Point::dim_t width = m_image.width();
+	const Point::dim_t height = m_image.height();
+
+	std::vector<uint32_t> pixels(width);
+	std::vector<CellClassifier::Cell> cells(width);
+	std::vector<Run> above, row;
+	std::vector<uint32_t> columns(width, 0);	//	Lengths of the vertical runs of free pixels up to the row above
+	std::vector<uint32_t> parent, labels;
+	uint32_t zones = 0;		//	Zones of the row above
+
+	uint64_t runs[KINDS] = {};
+	uint64_t joins[KINDS] = {};
+	uint64_t walls = 0;
+	uint64_t free = 0;
+	uint64_t runSquares = 0;
+	uint64_t columnSquares = 0;
+
+	const auto find = [&parent](uint32_t node) {
+		while (parent[node] != node) {
+			parent[node] = parent[parent[node]];
+			node = parent[node];
+		}
+
+		return node;
+	};
+
+	for (Point::dim_t x = 0; x < height; ++x) {
+		m_image.readRow(x, pixels.data(), cells.data());
+
+		row.clear();
+
+		for (Point::dim_t y = 0; y < width; ++y) {
+			const uint8_t kind = cells[y] == CellClassifier::Cell::WALL ? WALL : cells[y] == CellClassifier::Cell::COLOR ? COLOR : FREE;
+			walls += kind == WALL;
+			free += kind == FREE;
+
+			if (kind == FREE) {
+				++columns[y];
+			}
+			else {
+				columnSquares += static_cast<uint64_t>(columns[y]) * columns[y];
+				columns[y] = 0;
+			}
+
+			if (row.empty() || row.back().kind != kind) {
+				row.push_back(Run{ y, y + 1, kind, 0 });
+				++runs[kind];
+			}
+			else {
+				row.back().end = y + 1;
+			}
+		}
+
+		for (const auto &run : row) {
+			if (run.kind == FREE) {
+				runSquares += static_cast<uint64_t>(run.end - run.begin) * (run.end - run.begin);
+			}
+		}
+
+		//	The zones of the row above come first, then the runs of this row
+		const uint32_t first = zones;
+		parent.resize(first + row.size());
+		for (uint32_t node = 0; node < parent.size(); ++node) {
+			parent[node] = node;
+		}
+
+		//	Every run of the row above that overlaps a run of the same kind joins its zone
+		for (size_t i = 0, j = 0; i < above.size() && j < row.size(); ) {
+			if (above[i].kind == row[j].kind) {
+				const uint32_t a = find(above[i].label);
+				const uint32_t b = find(first + static_cast<uint32_t>(j));
+
+				if (a != b) {
+					parent[b] = a;
+					++joins[row[j].kind];
+				}
+			}
+
+			if (above[i].end < row[j].end) {
+				++i;
+			}
+			else {
+				++j;
+			}
+		}
+
+		//	The zones of this row get consecutive labels for the next one
+		labels.assign(parent.size(), UINT32_MAX);
+		uint32_t next = 0;
+
+		for (uint32_t j = 0; j < row.size(); ++j) {
+			const uint32_t root = find(first + j);
+
+			if (labels[root] == UINT32_MAX) {
+				labels[root] = next++;
+			}
+
+			row[j].label = labels[root];
+		}
+
+		zones = next;
+		above.swap(row);
+	}
+
+	for (const auto length : columns) {
+		columnSquares += static_cast<uint64_t>(length) * length;
+	}
+
+	Statistics statistics;
+	statistics.pixels = m_image.size();
+	statistics.walls = walls;
+	statistics.free = free;
+	statistics.runSquares = runSquares;
+	statistics.columnSquares = columnSquares;
+	statistics.ends = m_ends.size();
+	statistics.components = runs[FREE] - joins[FREE];
+	statistics.obstacles = runs[WALL] - joins[WALL];
+
+	for (const auto &key : m_keys) {
+		statistics.keys += key.second.size();
+	}
+
+	//	A key is a colored zone too
+	const uint64_t colored = runs[COLOR] - joins[COLOR];
+	statistics.doors = colored > statistics.keys ? colored - statistics.keys : 0;
+
+	m_statistics = statistics;
+	m_measured = true;
+}
+
+int ImageInfo::keyWidth() const {
+	return m_keyWidth;
+}
+
 bool ImageInfo::color(const Pixel::pxl_t &pixel) {
-	return  pixel != Pixel::WHITE &&
-			pixel != Pixel::BLACK &&
-			pixel != Pixel::START &&
-			pixel != Pixel::END;
+	return CellClassifier::classify(pixel) == CellClassifier::Cell::COLOR;
+}
+
+bool ImageInfo::applyEdits(const std::vector<PixelEdit> &edits, std::vector<Point> &changed) {
+	TRACE_SCOPE("apply edits", static_cast<int64_t>(edits.size()));
+
+	changed.clear();
+
+	for (const auto &edit : edits) {
+		if (edit.position.x() < 0 || edit.position.x() >= m_image.height() || edit.position.y() < 0 || edit.position.y() >= m_image.width()) {
+			throw std::range_error("Out of bounds!");
+		}
+	}
+
+	for (const auto &edit : edits) {
+		if (m_image.pixel(edit.position) != edit.pixel) {
+			m_image.setPixel(edit.position, edit.pixel);
+			changed.push_back(edit.position);
+		}
+	}
+
+	if (changed.empty()) {
+		return false;
+	}
+
+	m_landmarks.reset();
+	m_coarse.reset();
+	m_measured = false;
+
+	const KeysContainer keys = m_keys;
+	const EndsContainer ends = m_ends;
+	const Point start = m_start;
+
+	updateKeys(changed);
+	updateEnds(changed);
+	updateStart(changed);
+
+	return keys != m_keys || ends != m_ends || start != m_start;
+}
+
+std::string ImageInfo::outputPath() const {
+	std::string output = m_image.path();
+
+	while (output.back() != '.') {
+		output.pop_back();
+	}
+
+	output.pop_back();
+	output.append("_output.bmp");
+
+	return output;
 }
 
-bool ImageInfo::isKey(const Pixel::pxl_t &color, const Image &image, Point::dim_t row, Point::dim_t col, std::vector<bool> &visited) {
+bool ImageInfo::isKey(const Pixel::pxl_t &color, const Image &image, Point::dim_t row, Point::dim_t col, std::vector<bool> *visited) {
 	//	Check if the key is contained entirely in the image
 	if (row + KEY_WIDTH >= image.height() || col + KEY_WIDTH >= image.width()) {
 		return false;
@@ -103,7 +369,9 @@ bool ImageInfo::isKey(const Pixel::pxl_t &color, const Image &image, Point::dim_
 				return false;
 			}
 
-			visited[x * image.width() + y] = true;
+			if (visited) {
+				(*visited)[static_cast<size_t>(x) * image.width() + y] = true;
+			}
 		}
 	}
 
@@ -140,12 +408,12 @@ bool ImageInfo::isKey(const Pixel::pxl_t &color, const Image &image, Point::dim_
 	return true;
 }
 
-void ImageInfo::fillZone(const Point &pos, const Image &img, std::vector<bool> &visited) {
-	std::queue<Point> queue;
+void ImageInfo::fillZone(const Point &pos, const Image &img, std::vector<bool> &visited, std::pmr::memory_resource *memory) {
+	std::queue<Point, std::pmr::deque<Point>> queue{ std::pmr::deque<Point>(memory) };
 	queue.push(pos);
 
 	const auto &color = img.pixel(pos);
-	visited[pos.x() * img.width() + pos.y()] = true;
+	visited[static_cast<size_t>(pos.x()) * img.width() + pos.y()] = true;
 
 	while (!queue.empty()) {
 		auto curr = queue.front();
@@ -153,14 +421,163 @@ void ImageInfo::fillZone(const Point &pos, const Image &img, std::vector<bool> &
 
 		const auto &adjacent = getAdjacent(curr);
 		for (const auto &adj : adjacent) {
-			if (!visited[adj.x() * img.width() + adj.y()] && img.pixel(adj) == color) {
-				visited[adj.x() * img.width() + adj.y()] = true;
+			if (!visited[static_cast<size_t>(adj.x()) * img.width() + adj.y()] && img.pixel(adj) == color) {
+				visited[static_cast<size_t>(adj.x()) * img.width() + adj.y()] = true;
 				queue.push(adj);
 			}
 		}
 	}
 }
 
+void ImageInfo::updateKeys(const std::vector<Point> &changed) {
+	//	Top left corners of the keys that can contain a changed pixel in their square or frame
+	std::vector<uint64_t> corners;
+	const auto corner = [](Point::dim_t x, Point::dim_t y) {
+		return static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32 | static_cast<uint32_t>(y);
+	};
+
+	for (const auto &point : changed) {
+		for (Point::dim_t x = std::max(point.x() - KEY_WIDTH, 0); x <= point.x() + 1; ++x) {
+			for (Point::dim_t y = std::max(point.y() - KEY_WIDTH, 0); y <= point.y() + 1; ++y) {
+				corners.push_back(corner(x, y));
+			}
+		}
+	}
+
+	std::sort(corners.begin(), corners.end());
+	corners.erase(std::unique(corners.begin(), corners.end()), corners.end());
+
+	//	Keys are kept by their centers
+	for (auto it = m_keys.begin(); it != m_keys.end();) {
+		auto &points = it->second;
+
+		points.erase(std::remove_if(points.begin(), points.end(), [&](const Point &center) {
+			return std::binary_search(corners.begin(), corners.end(), corner(center.x() - KEY_WIDTH / 2, center.y() - KEY_WIDTH / 2));
+		}), points.end());
+
+		it = points.empty() ? m_keys.erase(it) : std::next(it);
+	}
+
+	//	The squares of the keys do not overlap, so every key is found from its own corner
+	std::vector<Pixel::pxl_t> found;
+
+	for (const auto &key : corners) {
+		const Point::dim_t x = static_cast<Point::dim_t>(key >> 32);
+		const Point::dim_t y = static_cast<Point::dim_t>(key & 0xFFFFFFFFu);
+
+		if (x >= m_image.height() || y >= m_image.width()) {
+			continue;
+		}
+
+		const auto &pxl = m_image.pixel(Point{ x, y });
+		if (m_image.cell(Point{ x, y }) == CellClassifier::Cell::COLOR && isKey(pxl, m_image, x, y, nullptr)) {
+			m_keys[pxl].push_back(Point{ x + KEY_WIDTH / 2, y + KEY_WIDTH / 2 });
+			found.push_back(pxl);
+		}
+	}
+
+	//	Same order as analyzeImage()
+	for (const auto &color : found) {
+		auto &points = m_keys[color];
+
+		std::sort(points.begin(), points.end(), [](const Point &lhs, const Point &rhs) {
+			return lhs.x() != rhs.x() ? lhs.x() < rhs.x() : lhs.y() < rhs.y();
+		});
+	}
+}
+
+void ImageInfo::updateEnds(const std::vector<Point> &changed) {
+	const auto index = [this](const Point &point) {
+		return static_cast<uint64_t>(point.x()) * m_image.width() + point.y();
+	};
+
+	//	Every ending pixel of a zone that contains or touches a changed pixel
+	std::unordered_set<uint64_t> zones;
+	std::vector<Point> corners;
+
+	for (const auto &point : changed) {
+		std::vector<Point> seeds = getAdjacent(point);
+		seeds.push_back(point);
+
+		for (const auto &seed : seeds) {
+			if (m_image.cell(seed) != CellClassifier::Cell::END || zones.count(index(seed))) {
+				continue;
+			}
+
+			//	The zone is represented by its first pixel, like in analyzeImage()
+			Point first = seed;
+			std::queue<Point> queue;
+			queue.push(seed);
+			zones.insert(index(seed));
+
+			while (!queue.empty()) {
+				const auto curr = queue.front();
+				queue.pop();
+
+				if (index(curr) < index(first)) {
+					first = curr;
+				}
+
+				for (const auto &adj : getAdjacent(curr)) {
+					if (!zones.count(index(adj)) && m_image.pixel(adj) == Pixel::END) {
+						zones.insert(index(adj));
+						queue.push(adj);
+					}
+				}
+			}
+
+			corners.push_back(first);
+		}
+	}
+
+	//	The old zones that touched a changed pixel were filled again, or they are gone
+	m_ends.erase(std::remove_if(m_ends.begin(), m_ends.end(), [&](const Point &end) {
+		return zones.count(index(end)) || m_image.cell(end) != CellClassifier::Cell::END;
+	}), m_ends.end());
+
+	m_ends.insert(m_ends.end(), corners.begin(), corners.end());
+	std::sort(m_ends.begin(), m_ends.end(), [&](const Point &lhs, const Point &rhs) {
+		return index(lhs) < index(rhs);
+	});
+}
+
+void ImageInfo::updateStart(const std::vector<Point> &changed) {
+	const auto before = [](const Point &lhs, const Point &rhs) {
+		return lhs.x() != rhs.x() ? lhs.x() < rhs.x() : lhs.y() < rhs.y();
+	};
+
+	Point start{ -1, -1 };
+
+	//	No pixel before the old start was a starting pixel, so only the changed ones can be
+	for (const auto &point : changed) {
+		if (m_image.cell(point) == CellClassifier::Cell::START && (start.x() == -1 || before(point, start))) {
+			start = point;
+		}
+	}
+
+	if (start.x() != -1 && before(start, m_start)) {
+		m_start = start;
+		return;
+	}
+
+	if (m_image.cell(m_start) == CellClassifier::Cell::START) {
+		return;
+	}
+
+	//	The old start was removed, the next one is after it
+	for (Point::dim_t row = m_start.x(), height = m_image.height(); row < height; ++row) {
+		for (Point::dim_t col = row == m_start.x() ? m_start.y() : 0, width = m_image.width(); col < width; ++col) {
+			if (m_image.cell(Point{ row, col }) == CellClassifier::Cell::START) {
+				m_start = Point{ row, col };
+				return;
+			}
+		}
+	}
+
+	m_start = Point{ -1, -1 };
+	throw std::logic_error("Starting point was not found!");
+}
+
 const std::vector<Point> ImageInfo::getAdjacent(const Point &point) const {
 	const size_t nSize = 8;
 	const Point::dim_t dir[nSize][2] = { {-1,0}, {-1,-1}, {0,-1}, {1,-1}, {1,0},{1,1}, {0,1},{-1,1} };
@@ -2,12 +2,23 @@
 #ifndef IMAGE_ANALYZE_CLASS_HEADER
 #define IMAGE_ANALYZE_CLASS_HEADER
 
+#include <memory>
+#include <memory_resource>
 #include <unordered_map>
 #include <vector>
 
 #include "Image.h"
+#include "Landmarks.h"
+
+class CoarseGrid;
+class Workspace;
 
 class ImageInfo {
+	//	Stores and restores the results of analyzeImage()
+	friend class MazeCache;
+	//	Builds the maze of the cells of a regular maze
+	friend class CoarseGrid;
+
 public:
 	static const int KEY_WIDTH;
 
@@ -18,15 +29,76 @@ public:
 	//	Vector of points that keeps the positions of the end zone(s)
 	using EndsContainer = std::vector<Point>;
 
+	//	New value of a single pixel
+	struct PixelEdit {
+		Point position;
+		Pixel::pxl_t pixel;
+	};
+
+	//	Cheap statistics of the maze, the search is chosen with them(see EngineSelector)
+	struct Statistics {
+		uint64_t pixels = 0;
+		uint64_t walls = 0;			//	Pixels of the walls
+		uint64_t free = 0;			//	Pixels that are neither walls nor colored
+		uint64_t runSquares = 0;	//	Sum of the squared lengths of the horizontal runs of free pixels
+		uint64_t columnSquares = 0;	//	Sum of the squared lengths of the vertical runs of free pixels
+		uint64_t keys = 0;			//	Squares of the keys
+		uint64_t doors = 0;			//	Colored zones that are not keys
+		uint64_t ends = 0;			//	Ending zones
+		uint64_t components = 0;	//	Regions of free pixels joined horizontally or vertically, the doors split them
+		uint64_t obstacles = 0;		//	Walls joined horizontally or vertically
+
+		//	Part of the pixels that are walls
+		double wallDensity() const;
+		//	Mean length of the horizontal and of the vertical run a free pixel lies in, so large rooms
+		//	count with their area and not as a single run
+		double meanRun() const;
+		double meanColumn() const;
+	};
+
 public:
 	ImageInfo(const Image &img);
+	ImageInfo(Image &&img);
 	ImageInfo(const ImageInfo &r) = default;
 	ImageInfo& operator=(const ImageInfo &rhs) = default;
 	~ImageInfo() = default;
 
 public:
-	void analyzeImage();
+	//	The buffers of the analysis are taken from *workspace*, if it is not null
+	void analyzeImage(Workspace *workspace = nullptr);
 	void saveImage() const;
+	//	Saves the source image with the overlay drawn on it, see Image::saveImage()
+	void saveImage(const PathOverlay &overlay) const;
+
+	//	Changes the pixels of an analyzed image and updates the keys, the ending zones and the
+	//	starting point around them, with the same result as analyzeImage() but without scanning
+	//	the whole image. *changed* gets the pixels whose value changed. Returns *true* if the keys,
+	//	the ending zones or the starting point changed. Throws std::range_error(before changing
+	//	anything) if a pixel is outside the image and std::logic_error if there is no start left
+	bool applyEdits(const std::vector<PixelEdit> &edits, std::vector<Point> &changed);
+
+	//	Computes the costs from *count* landmarks to every pixel with the rules of *movement*, for
+	//	the heuristic of the searches(see Landmarks). 0 removes them. applyEdits() removes them too,
+	//	their costs may not hold for the changed pixels
+	void buildLandmarks(unsigned count, const SearchPolicy::Movement &movement);
+
+	//	nullptr if there are no landmarks
+	const Landmarks* landmarks() const;
+
+	//	Finds the pitch of the corridors and the walls of the maze and builds the maze of its cells
+	//	(see CoarseGrid), which the searches use instead of the pixels. Returns *false* and removes
+	//	it if the maze is not drawn on a regular grid. applyEdits() removes it too
+	bool buildCoarseGrid();
+
+	//	nullptr if there is no grid of cells
+	CoarseGrid* coarseGrid();
+
+	//	Keys are found within this distance of their middle, less than KEY_WIDTH in a maze of cells
+	int keyWidth() const;
+
+	//	Collected by analyzeImage(). The maze is measured again on the first call after it was loaded
+	//	from the maze cache or changed by applyEdits(), and a maze of cells on the first call
+	const Statistics& statistics();
 
 	//	Returns *true* if the pixel is colored
 	static bool color(const Pixel::pxl_t &pixel);
@@ -41,17 +113,40 @@ public:
 	const EndsContainer& getEnds() const;
 
 private:
+	//	Path of the _output.bmp file next to the image
+	std::string outputPath() const;
+
 	//	Returns *true* if the zone in that position is a key
-	static bool isKey(const Pixel::pxl_t &pixel, const Image &img, Point::dim_t row, Point::dim_t col, std::vector<bool> &visited);
+	//	The pixels of the key are marked in *visited* if it is not null
+	static bool isKey(const Pixel::pxl_t &pixel, const Image &img, Point::dim_t row, Point::dim_t col, std::vector<bool> *visited);
 
 	const std::vector<Point> getAdjacent(const Point &point) const;
-	void fillZone(const Point &pos, const Image &img, std::vector<bool> &visited);
+	//	The queue of the fill is allocated from *memory*
+	void fillZone(const Point &pos, const Image &img, std::vector<bool> &visited, std::pmr::memory_resource *memory);
+
+	//	Counts the walls, the runs and the zones of the image row by row, only the runs of the row
+	//	above are kept to join the zones
+	void measure();
+
+	//	Finds again the keys whose square or frame contains one of the *changed* pixels
+	void updateKeys(const std::vector<Point> &changed);
+
+	//	Fills again the ending zones that contain or touch one of the *changed* pixels
+	void updateEnds(const std::vector<Point> &changed);
+
+	//	Finds the first starting pixel again, if it was changed or a new one was drawn before it
+	void updateStart(const std::vector<Point> &changed);
 
 private:
 	Image m_image;
 	Point m_start;
 	KeysContainer m_keys;
 	EndsContainer m_ends;
+	std::shared_ptr<const Landmarks> m_landmarks;	//	Never changed, shared by the copies
+	std::shared_ptr<CoarseGrid> m_coarse;			//	Shared by the copies
+	int m_keyWidth;
+	Statistics m_statistics;
+	bool m_measured;								//	m_statistics are the ones of the pixels
 };
 
 #endif // !IMAGE_ANALYZE_CLASS_HEADER
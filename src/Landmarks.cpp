@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <utility>
+#include "Landmarks.h"
+#include "Trace.h"
+
+Landmarks::Landmarks()
+	: m_width(0)
+	, m_stride(0)
+	, m_scale(1)
+	, m_unreached(UINT16_MAX) {
+
+}
+
+bool Landmarks::build(const Image &image, const Point &start, unsigned count, const SearchPolicy::Movement &movement) {
+	TRACE_SCOPE("landmarks", static_cast<int64_t>(count));
+
+	m_width = image.width();
+	m_movement = movement;
+	m_points.clear();
+	m_costs16.clear();
+	m_costs32.clear();
+	m_stride = count;
+	m_scale = 1;
+
+	if (count == 0 || !image.passable(start.x(), start.y())) {
+		return false;
+	}
+
+	std::vector<uint64_t> field;
+	distances(image, start, field);
+
+	//	The cost between two pixels reachable from the start is at most twice the largest cost from the start
+	uint64_t farthest = 0;
+	for (const uint64_t cost : field) {
+		if (cost != UINT64_MAX) {
+			farthest = std::max(farthest, cost);
+		}
+	}
+
+	const uint64_t largest = 2 * farthest;
+
+	if (largest < UINT16_MAX) {
+		m_unreached = UINT16_MAX;
+		m_costs16.assign(field.size() * m_stride, UINT16_MAX);
+	}
+	else {
+		m_unreached = UINT32_MAX;
+		m_scale = largest / (UINT32_MAX - 1) + 1;
+		m_costs32.assign(field.size() * m_stride, UINT32_MAX);
+	}
+
+	//	Cost to the nearest of the start and the landmarks, the next landmark is the farthest pixel
+	std::vector<uint64_t> nearest(field);
+
+	for (size_t landmark = 0; landmark < m_stride; ++landmark) {
+		size_t best = 0;
+		for (size_t i = 1; i < nearest.size(); ++i) {
+			if (nearest[i] != UINT64_MAX && (nearest[best] == UINT64_MAX || nearest[i] > nearest[best])) {
+				best = i;
+			}
+		}
+
+		//	Every reachable pixel is a landmark already
+		if (nearest[best] == UINT64_MAX || nearest[best] == 0) {
+			break;
+		}
+
+		m_points.push_back(Point{ static_cast<Point::dim_t>(best / m_width), static_cast<Point::dim_t>(best % m_width) });
+		distances(image, m_points.back(), field);
+
+		for (size_t i = 0; i < field.size(); ++i) {
+			if (field[i] == UINT64_MAX) {
+				continue;
+			}
+
+			if (m_costs16.empty()) {
+				m_costs32[i * m_stride + landmark] = static_cast<uint32_t>(field[i] / m_scale);
+			}
+			else {
+				m_costs16[i * m_stride + landmark] = static_cast<uint16_t>(field[i]);
+			}
+
+			nearest[i] = std::min(nearest[i], field[i]);
+		}
+	}
+
+	return !m_points.empty();
+}
+
+size_t Landmarks::bound(const Point &a, const Point &b) const {
+	if (m_points.empty()) {
+		return 0;
+	}
+
+	const size_t first = (static_cast<size_t>(a.x()) * m_width + a.y()) * m_stride;
+	const size_t second = (static_cast<size_t>(b.x()) * m_width + b.y()) * m_stride;
+
+	uint64_t best = 0;
+
+	for (size_t landmark = 0; landmark < m_points.size(); ++landmark) {
+		const uint64_t from = value(first + landmark);
+		const uint64_t to = value(second + landmark);
+
+		if (from == m_unreached || to == m_unreached || from == to) {
+			continue;
+		}
+
+		//	The stored costs are rounded down, so the costs differ by more than scale - 1 less
+		const uint64_t difference = from > to ? from - to : to - from;
+		best = std::max(best, difference * m_scale - (m_scale - 1));
+	}
+
+	return static_cast<size_t>(best);
+}
+
+const std::vector<Point>& Landmarks::points() const {
+	return m_points;
+}
+
+const SearchPolicy::Movement& Landmarks::movement() const {
+	return m_movement;
+}
+
+size_t Landmarks::bytes() const {
+	return m_costs16.size() * sizeof(uint16_t) + m_costs32.size() * sizeof(uint32_t);
+}
+
+void Landmarks::distances(const Image &image, const Point &source, std::vector<uint64_t> &field) const {
+	TRACE_SCOPE("landmark distances");
+
+	const Point::dim_t width = image.width();
+	field.assign(image.size(), UINT64_MAX);
+
+	//	Every diagonal step is allowed between passable pixels, which is never more expensive than
+	//	the rules of the search, so the costs stay lower bounds for any connectivity
+	const uint64_t straight = SearchPolicy::distance(m_movement.cost, Point{ 0, 0 }, Point{ 0, 1 });
+	const uint64_t diagonal = SearchPolicy::distance(m_movement.cost, Point{ 0, 0 }, Point{ 1, 1 });
+	const size_t directions = m_movement.connectivity == SearchPolicy::Connectivity::FOUR ? 4 : 8;
+
+	static const Point::dim_t DX[] = { -1, 1, 0, 0, -1, -1, 1, 1 };
+	static const Point::dim_t DY[] = { 0, 0, -1, 1, -1, 1, -1, 1 };
+
+	const size_t first = static_cast<size_t>(source.x()) * width + source.y();
+	field[first] = 0;
+
+	//	Lowers the costs of the neighbours of *index* through it, *push* gets the lowered ones
+	const auto expand = [&](size_t index, uint64_t cost, auto &&push) {
+		const Point::dim_t x = static_cast<Point::dim_t>(index / width);
+		const Point::dim_t y = static_cast<Point::dim_t>(index % width);
+
+		for (size_t direction = 0; direction < directions; ++direction) {
+			const Point::dim_t nextX = x + DX[direction];
+			const Point::dim_t nextY = y + DY[direction];
+
+			if (!image.passable(nextX, nextY)) {
+				continue;
+			}
+
+			const size_t next = static_cast<size_t>(nextX) * width + nextY;
+			const uint64_t nextCost = cost + (direction < 4 ? straight : diagonal);
+
+			if (nextCost < field[next]) {
+				field[next] = nextCost;
+				push(next, nextCost);
+			}
+		}
+	};
+
+	//	Steps of 1 and 2: a bucket for every cost modulo 3(Dial), no step lands in the bucket being read
+	if (diagonal <= 2) {
+		std::vector<std::vector<size_t>> buckets(diagonal + 1);
+		buckets[0].push_back(first);
+		size_t pending = 1;
+
+		for (uint64_t cost = 0; pending > 0; ++cost) {
+			auto &bucket = buckets[cost % buckets.size()];
+
+			for (const size_t index : bucket) {
+				if (field[index] == cost) {
+					expand(index, cost, [&](size_t next, uint64_t nextCost) {
+						buckets[nextCost % buckets.size()].push_back(next);
+						++pending;
+					});
+				}
+			}
+
+			pending -= bucket.size();
+			bucket.clear();
+		}
+
+		return;
+	}
+
+	using Entry = std::pair<uint64_t, size_t>;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+	open.push(Entry{ 0, first });
+
+	while (!open.empty()) {
+		const Entry top = open.top();
+		open.pop();
+
+		if (top.first == field[top.second]) {
+			expand(top.second, top.first, [&](size_t next, uint64_t nextCost) {
+				open.push(Entry{ nextCost, next });
+			});
+		}
+	}
+}
+
+uint32_t Landmarks::value(size_t index) const {
+	return m_costs16.empty() ? m_costs32[index] : m_costs16[index];
+}
@@ -0,0 +1,60 @@
+#pragma once
+#ifndef LANDMARKS_CLASS_HEADER
+#define LANDMARKS_CLASS_HEADER
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Image.h"
+#include "SearchPolicy.h"
+
+//	Exact costs from a few pixels(landmarks) to every pixel of the image, for the ALT heuristic.
+//	By the triangle inequality |d(L, a) - d(L, b)| <= d(a, b) for every landmark L, which is much
+//	closer to the cost of a winding path than the distance without walls. The costs are computed
+//	with the doors open, so the bound holds for any collected keys. The costs of every pixel are
+//	stored together in 16 bits when they fit and in 32 bits otherwise
+class Landmarks {
+public:
+	Landmarks();
+	Landmarks(const Landmarks &r) = default;
+	Landmarks& operator=(const Landmarks &rhs) = default;
+	~Landmarks() = default;
+
+public:
+	//	Selects *count* landmarks in the part of the maze reachable from *start*, each one the
+	//	pixel farthest from the landmarks before it, and computes their costs with the rules of
+	//	*movement*. Returns *false* if *start* is not passable
+	bool build(const Image &image, const Point &start, unsigned count, const SearchPolicy::Movement &movement);
+
+	//	Lower bound of the cost of the cheapest path between *a* and *b*, 0 without landmarks
+	size_t bound(const Point &a, const Point &b) const;
+
+	const std::vector<Point>& points() const;
+	const SearchPolicy::Movement& movement() const;
+
+	//	Memory of the costs
+	size_t bytes() const;
+
+private:
+	//	Cost of the cheapest path from *source* to every pixel, UINT64_MAX where it is not reachable
+	void distances(const Image &image, const Point &source, std::vector<uint64_t> &field) const;
+
+	//	Stored cost at position *index* of the costs
+	uint32_t value(size_t index) const;
+
+private:
+	Point::dim_t m_width;
+	SearchPolicy::Movement m_movement;
+	std::vector<Point> m_points;
+	size_t m_stride;		//	Costs of every pixel, the landmarks that were asked for
+
+	//	Pixel after pixel, the costs of every landmark. The costs are divided by m_scale when
+	//	the largest one does not fit in 32 bits
+	std::vector<uint16_t> m_costs16;
+	std::vector<uint32_t> m_costs32;
+	uint64_t m_scale;
+	uint32_t m_unreached;	//	Stored for the pixels a landmark does not reach
+};
+
+#endif // !LANDMARKS_CLASS_HEADER
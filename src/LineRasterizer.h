@@ -0,0 +1,94 @@
+#pragma once
+#ifndef LINE_RASTERIZER_CLASS_HEADER
+#define LINE_RASTERIZER_CLASS_HEADER
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
+#include "Point.h"
+
+//	Rasterizes segments without allocating memory.
+//
+//	A segment of n = max(|dx|, |dy|) steps has the pixels round(from + i / n * (to - from)), i = 0..n,
+//	which is what the solver has always drawn with floating point interpolation. Both coordinates
+//	are advanced with integer error terms(Bresenham) and a step is computed in floating point,
+//	exactly like before, only when it is so close to a tie that the rounding errors of the floats
+//	could decide it. So the pixels are identical to the old ones, bit for bit
+class LineRasterizer {
+public:
+	//	Calls visit(x, y) for every pixel of the segment, *from* and *to* included
+	template <typename Visit>
+	static void rasterize(const Point &from, const Point &to, Visit &&visit) {
+		const int64_t steps = std::max(std::abs(to.x() - from.x()), std::abs(to.y() - from.y()));
+
+		if (steps == 0) {
+			visit(from.x(), from.y());
+			return;
+		}
+
+		Axis x(from.x(), to.x(), steps);
+		Axis y(from.y(), to.y(), steps);
+
+		for (int64_t step = 0; step <= steps; ++step) {
+			visit(x.value(step, steps), y.value(step, steps));
+
+			x.advance(steps);
+			y.advance(steps);
+		}
+	}
+
+private:
+	//	One coordinate of the segment
+	class Axis {
+	public:
+		Axis(Point::dim_t start, Point::dim_t end, int64_t steps)
+			: m_start(start)
+			, m_end(end)
+			, m_pos(start)
+			, m_sign(end >= start ? 1 : -1)
+			, m_twiceDelta(2 * std::abs(static_cast<int64_t>(end) - start))
+			, m_error(steps)
+			, m_window(static_cast<uint64_t>(steps) * (static_cast<uint64_t>(std::abs(static_cast<int64_t>(end) - start)) +
+				static_cast<uint64_t>(std::max(std::abs(start), std::abs(end))) + 1)) {
+
+		}
+
+		//	Coordinate of step *step*, m_pos is round(start + step * delta / steps) up to the rounding of ties
+		Point::dim_t value(int64_t step, int64_t steps) const {
+			//	Distance of the exact value from a tie, in units of 1 / (2 * steps)
+			const uint64_t distance = static_cast<uint64_t>(m_error < steps ? m_error : 2 * steps - m_error);
+
+			//	The float errors are below (|delta| + |coordinate| + 1) * 2^-22 pixels, so only decide
+			//	the steps inside(a safe multiple of) that window in floating point
+			if ((distance << 20) <= m_window) {
+				const float t = step / static_cast<float>(steps);
+				return static_cast<Point::dim_t>(std::round(static_cast<float>(m_start) + t * (m_end - m_start)));
+			}
+
+			return m_pos;
+		}
+
+		void advance(int64_t steps) {
+			//	m_error is (2 * step * |delta| + steps) mod (2 * steps)
+			m_error += m_twiceDelta;
+
+			if (m_error >= 2 * steps) {
+				m_error -= 2 * steps;
+				m_pos += m_sign;
+			}
+		}
+
+	private:
+		Point::dim_t m_start;
+		Point::dim_t m_end;
+		Point::dim_t m_pos;
+		Point::dim_t m_sign;
+		int64_t m_twiceDelta;
+		int64_t m_error;
+		uint64_t m_window;
+	};
+};
+
+#endif // !LINE_RASTERIZER_CLASS_HEADER
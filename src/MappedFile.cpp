@@ -0,0 +1,122 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+	: m_data(nullptr)
+	, m_size(0)
+#if defined(_WIN32)
+	, m_file(INVALID_HANDLE_VALUE)
+	, m_mapping(nullptr)
+#endif
+{
+
+}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+bool MappedFile::open(const std::string &path) {
+	close();
+
+#if defined(_WIN32)
+	m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0) {
+		close();
+		return false;
+	}
+
+	m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+	if (!m_mapping) {
+		close();
+		return false;
+	}
+
+	m_data = static_cast<uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_COPY, 0, 0, 0));
+	m_size = static_cast<size_t>(size.QuadPart);
+#else
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+
+	//	The mapping stays valid after the descriptor is closed
+	void *data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	::close(fd);
+
+	if (data == MAP_FAILED) {
+		return false;
+	}
+
+	m_data = static_cast<uint8_t*>(data);
+	m_size = static_cast<size_t>(info.st_size);
+#endif
+
+	if (!m_data) {
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::close() {
+#if defined(_WIN32)
+	if (m_data) {
+		UnmapViewOfFile(m_data);
+	}
+
+	if (m_mapping) {
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+	}
+
+	if (m_file != INVALID_HANDLE_VALUE) {
+		CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (m_data) {
+		munmap(m_data, m_size);
+	}
+#endif
+
+	m_data = nullptr;
+	m_size = 0;
+}
+
+bool MappedFile::isOpen() const {
+	return m_data != nullptr;
+}
+
+size_t MappedFile::size() const {
+	return m_size;
+}
+
+uint8_t* MappedFile::data() {
+	return m_data;
+}
+
+const uint8_t* MappedFile::data() const {
+	return m_data;
+}
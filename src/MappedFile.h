@@ -0,0 +1,38 @@
+#pragma once
+#ifndef MAPPED_FILE_CLASS_HEADER
+#define MAPPED_FILE_CLASS_HEADER
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//	Private(copy-on-write) memory mapping of a whole file.
+//	Writes to the mapped memory are never written back to the file
+class MappedFile {
+public:
+	MappedFile();
+	MappedFile(const MappedFile &r) = delete;
+	MappedFile& operator=(const MappedFile &rhs) = delete;
+	~MappedFile();
+
+public:
+	bool open(const std::string &path);
+	void close();
+
+	bool isOpen() const;
+	size_t size() const;
+
+	uint8_t* data();
+	const uint8_t* data() const;
+
+private:
+	uint8_t *m_data;
+	size_t m_size;
+
+#if defined(_WIN32)
+	void *m_file;
+	void *m_mapping;
+#endif
+};
+
+#endif // !MAPPED_FILE_CLASS_HEADER
@@ -0,0 +1,441 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "MazeCache.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "Trace.h"
+
+//	2: the header has the size and the modification time of the source
+const uint32_t MazeCache::VERSION = 2;
+const char *MazeCache::EXTENSION = ".mzc";
+
+namespace {
+
+const char MAGIC[8] = { 'M', 'A', 'Z', 'E', 'C', 'A', 'C', 'H' };
+const uint32_t FLAG_RLE = 1;
+const uint64_t SECTION_ALIGNMENT = 64;
+
+struct Header {
+	char magic[8];
+	uint32_t version;
+	uint32_t pixelSize;		//	sizeof(Pixel::pxl_t) of the writer
+	uint64_t sourceHash;
+	uint64_t sourceSize;
+	int64_t sourceTime;
+	int32_t width;
+	int32_t height;
+	uint32_t layout;
+	uint32_t flags;
+	int32_t startX;
+	int32_t startY;
+	uint64_t keyCount;
+	uint64_t endCount;
+	uint64_t pixelsOffset;
+	uint64_t pixelsBytes;
+	uint64_t cellsOffset;
+	uint64_t cellsBytes;
+	uint64_t passableOffset;
+	uint64_t passableBytes;
+	uint64_t keysOffset;
+	uint64_t endsOffset;
+};
+
+struct KeyRecord {
+	uint64_t color;
+	uint32_t id;
+	int32_t x;
+	int32_t y;
+	uint32_t reserved;
+};
+
+struct EndRecord {
+	int32_t x;
+	int32_t y;
+};
+
+struct Run {
+	uint32_t length;
+	uint32_t value;
+};
+
+uint64_t align(uint64_t offset) {
+	return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+}
+
+//	Writes *bytes* bytes at *offset*, filling the gap after the current end with zeros
+bool writeAt(std::ofstream &ofile, uint64_t offset, const void *data, size_t bytes) {
+	const uint64_t current = static_cast<uint64_t>(ofile.tellp());
+	const std::vector<char> zeros(static_cast<size_t>(offset - current), 0);
+
+	ofile.write(zeros.data(), zeros.size());
+	ofile.write(static_cast<const char*>(data), bytes);
+
+	return ofile.good();
+}
+
+} // namespace
+
+bool MazeCache::hashFile(const std::string &path, uint64_t &hash) {
+	TRACE_SCOPE("cache hash");
+
+	std::ifstream ifile(path, std::ios::binary);
+	if (!ifile) {
+		return false;
+	}
+
+	//	The file is mixed in 8 byte words
+	std::vector<char> block(1 << 20);
+	uint64_t h = Hash::SEED;
+	uint64_t length = 0;
+
+	while (ifile) {
+		ifile.read(block.data(), block.size());
+		const size_t count = static_cast<size_t>(ifile.gcount());
+
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8) {
+			uint64_t word = 0;
+			std::memcpy(&word, &block[i], 8);
+
+			h = Hash::mix(h, word);
+		}
+
+		//	Only the last block may have a tail
+		if (i < count) {
+			uint64_t word = 0;
+			std::memcpy(&word, &block[i], count - i);
+
+			h = Hash::mix(h, word);
+		}
+
+		length += count;
+	}
+
+	if (ifile.bad()) {
+		return false;
+	}
+
+	hash = Hash::finalize(h ^ length);
+	return true;
+}
+
+bool MazeCache::source(const std::string &path, Source &source) {
+	std::error_code error;
+
+	const auto size = std::filesystem::file_size(path, error);
+	if (error) {
+		return false;
+	}
+
+	const auto time = std::filesystem::last_write_time(path, error);
+	if (error) {
+		return false;
+	}
+
+	source = Source();
+	source.path = path;
+	source.size = static_cast<uint64_t>(size);
+	source.time = static_cast<int64_t>(time.time_since_epoch().count());
+
+	return true;
+}
+
+bool MazeCache::hashSource(Source &source) {
+	if (!source.hashed) {
+		source.hashed = hashFile(source.path, source.hash);
+	}
+
+	return source.hashed;
+}
+
+std::string MazeCache::cachePath(const std::string &imagePath) {
+	std::string output = imagePath;
+
+	const size_t dot = output.find_last_of('.');
+	const size_t slash = output.find_last_of("/\\");
+
+	if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+		output.erase(dot);
+	}
+
+	output.append(EXTENSION);
+	return output;
+}
+
+bool MazeCache::save(const std::string &cachePath, const ImageInfo &info, Source &source, bool rle) {
+	TRACE_SCOPE("cache save");
+
+	const Image &image = info.m_image;
+
+	//	A paged grid is larger than the memory, it is never loaded whole
+	if (image.m_layout == Image::Layout::PAGED || !hashSource(source)) {
+		return false;
+	}
+
+	std::ofstream ofile(cachePath, std::ios::binary | std::ios::trunc);
+	if (!ofile) {
+		return false;
+	}
+
+	//	Keys sorted by color, the index of a color is the id of the key
+	std::vector<Pixel::pxl_t> colors;
+	for (const auto &key : info.m_keys) {
+		colors.push_back(key.first);
+	}
+
+	std::sort(colors.begin(), colors.end());
+
+	std::vector<KeyRecord> keys;
+	for (size_t id = 0; id < colors.size(); ++id) {
+		for (const auto &position : info.m_keys.at(colors[id])) {
+			keys.push_back(KeyRecord{ colors[id], static_cast<uint32_t>(id), position.x(), position.y(), 0 });
+		}
+	}
+
+	std::vector<EndRecord> ends;
+	for (const auto &end : info.m_ends) {
+		ends.push_back(EndRecord{ end.x(), end.y() });
+	}
+
+	//	Run-length encoded rows are always stored as runs, one row after another
+	rle = rle || image.m_layout == Image::Layout::RLE;
+
+	std::vector<Run> runs;
+	if (image.m_layout == Image::Layout::RLE) {
+		for (const auto &row : image.m_rows) {
+			for (size_t i = 0; i < row.size(); ++i) {
+				const Point::dim_t end = i + 1 < row.size() ? row[i + 1].start : image.m_width;
+				runs.push_back(Run{ static_cast<uint32_t>(end - row[i].start), static_cast<uint32_t>(row[i].value) });
+			}
+		}
+	}
+	else if (rle) {
+		for (size_t i = 0; i < image.m_data.size(); ++i) {
+			const uint32_t value = static_cast<uint32_t>(image.m_data[i]);
+
+			if (!runs.empty() && runs.back().value == value && runs.back().length < UINT32_MAX) {
+				++runs.back().length;
+			}
+			else {
+				runs.push_back(Run{ 1, value });
+			}
+		}
+	}
+
+	Header header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+
+	header.version = VERSION;
+	header.pixelSize = sizeof(Pixel::pxl_t);
+	header.sourceHash = source.hash;
+	header.sourceSize = source.size;
+	header.sourceTime = source.time;
+	header.width = image.m_width;
+	header.height = image.m_height;
+	header.layout = static_cast<uint32_t>(image.m_layout);
+	header.flags = rle ? FLAG_RLE : 0;
+	header.startX = info.m_start.x();
+	header.startY = info.m_start.y();
+	header.keyCount = keys.size();
+	header.endCount = ends.size();
+
+	header.pixelsOffset = align(sizeof(Header));
+	header.pixelsBytes = rle ? runs.size() * sizeof(Run) : image.m_data.size() * sizeof(Pixel::pxl_t);
+	header.cellsOffset = align(header.pixelsOffset + header.pixelsBytes);
+	header.cellsBytes = rle ? 0 : image.m_cells.size() * sizeof(CellClassifier::Cell);
+	header.passableOffset = align(header.cellsOffset + header.cellsBytes);
+	header.passableBytes = rle ? 0 : image.m_passable.size() * sizeof(uint64_t);
+	header.keysOffset = align(header.passableOffset + header.passableBytes);
+	header.endsOffset = align(header.keysOffset + keys.size() * sizeof(KeyRecord));
+
+	bool written = writeAt(ofile, 0, &header, sizeof(header));
+
+	if (rle) {
+		written = written && writeAt(ofile, header.pixelsOffset, runs.data(), header.pixelsBytes);
+	}
+	else {
+		written = written && writeAt(ofile, header.pixelsOffset, image.m_data.data(), header.pixelsBytes);
+		written = written && writeAt(ofile, header.cellsOffset, image.m_cells.data(), header.cellsBytes);
+		written = written && writeAt(ofile, header.passableOffset, image.m_passable.data(), header.passableBytes);
+	}
+
+	written = written && writeAt(ofile, header.keysOffset, keys.data(), keys.size() * sizeof(KeyRecord));
+	written = written && writeAt(ofile, header.endsOffset, ends.data(), ends.size() * sizeof(EndRecord));
+
+	ofile.close();
+	return written && !ofile.fail();
+}
+
+bool MazeCache::load(const std::string &cachePath, Source &source, ImageInfo &info) {
+	TRACE_SCOPE("cache load");
+
+	if (info.m_image.m_layout == Image::Layout::PAGED) {
+		return false;
+	}
+
+	auto mapping = std::make_shared<MappedFile>();
+	if (!mapping->open(cachePath) || mapping->size() < sizeof(Header)) {
+		return false;
+	}
+
+	Header header;
+	std::memcpy(&header, mapping->data(), sizeof(header));
+
+	if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+		header.version != VERSION ||
+		header.pixelSize != sizeof(Pixel::pxl_t) ||
+		header.width <= 0 || header.height <= 0 ||
+		header.layout > static_cast<uint32_t>(Image::Layout::RLE)) {
+
+		return false;
+	}
+
+	//	A copied or touched .bmp file may still have the same content
+	if (header.sourceSize != source.size || header.sourceTime != source.time) {
+		if (!hashSource(source) || header.sourceHash != source.hash) {
+			return false;
+		}
+
+		std::fstream file(cachePath, std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(offsetof(Header, sourceSize));
+		file.write(reinterpret_cast<const char*>(&source.size), sizeof(source.size));
+		file.write(reinterpret_cast<const char*>(&source.time), sizeof(source.time));
+	}
+
+	const uint64_t endsEnd = header.endsOffset + header.endCount * sizeof(EndRecord);
+	if (endsEnd > mapping->size() ||
+		header.pixelsOffset + header.pixelsBytes > mapping->size() ||
+		header.cellsOffset + header.cellsBytes > mapping->size() ||
+		header.passableOffset + header.passableBytes > mapping->size() ||
+		header.keysOffset + header.keyCount * sizeof(KeyRecord) > mapping->size()) {
+
+		return false;
+	}
+
+	//	Set the dimensions, so the sizes of the sections can be checked. A rejected cache puts the
+	//	old ones back, so Image::loadImage() decodes the .bmp file in the layout the image was given
+	Image &image = info.m_image;
+
+	const Point::dim_t oldWidth = image.m_width;
+	const Point::dim_t oldHeight = image.m_height;
+	const Point::dim_t oldTilesPerRow = image.m_tilesPerRow;
+	const size_t oldPassableStride = image.m_passableStride;
+	const Image::Layout oldLayout = image.m_layout;
+
+	const auto reject = [&]() {
+		image.m_width = oldWidth;
+		image.m_height = oldHeight;
+		image.m_tilesPerRow = oldTilesPerRow;
+		image.m_passableStride = oldPassableStride;
+		image.m_layout = oldLayout;
+
+		return false;
+	};
+
+	image.m_width = header.width;
+	image.m_height = header.height;
+	image.m_tilesPerRow = (image.m_width + Image::TILE_SIZE - 1) / Image::TILE_SIZE;
+	image.m_passableStride = (static_cast<size_t>(image.m_width) + 63) / 64;
+	image.m_layout = static_cast<Image::Layout>(header.layout);
+
+	const size_t cells = image.storageSize(image.m_layout);
+	const size_t words = image.m_passableStride * image.m_height;
+
+	uint8_t *base = mapping->data();
+
+	if (image.m_layout == Image::Layout::RLE) {
+		if (!(header.flags & FLAG_RLE)) {
+			return reject();
+		}
+
+		//	Runs never continue on the next row
+		const Run *runs = reinterpret_cast<const Run*>(base + header.pixelsOffset);
+		const size_t runCount = static_cast<size_t>(header.pixelsBytes / sizeof(Run));
+
+		std::vector<std::vector<Image::Run>> rows(image.m_height);
+
+		size_t i = 0;
+		for (Point::dim_t x = 0; x < image.m_height; ++x) {
+			auto &row = rows[x];
+
+			for (Point::dim_t y = 0; y < image.m_width; y += runs[i++].length) {
+				if (i >= runCount || runs[i].length == 0 || y + runs[i].length > static_cast<uint64_t>(image.m_width)) {
+					return reject();
+				}
+
+				row.push_back(Image::Run{ y, CellClassifier::classify(runs[i].value), runs[i].value });
+			}
+		}
+
+		image.allocate();
+		image.m_rows = std::move(rows);
+	}
+	else if (header.flags & FLAG_RLE) {
+		//	Expand the runs and classify the pixels again
+		const Run *runs = reinterpret_cast<const Run*>(base + header.pixelsOffset);
+		const size_t runCount = static_cast<size_t>(header.pixelsBytes / sizeof(Run));
+
+		std::vector<Pixel::pxl_t> data;
+		data.reserve(cells);
+
+		for (size_t i = 0; i < runCount && data.size() + runs[i].length <= cells; ++i) {
+			data.insert(data.end(), runs[i].length, runs[i].value);
+		}
+
+		if (data.size() != cells) {
+			return reject();
+		}
+
+		image.m_data.adopt(std::move(data));
+		image.m_cells.assign(cells, CellClassifier::Cell::WALL);
+		image.m_passable.assign(words, 0);
+
+		for (Point::dim_t x = 0; x < image.m_height; ++x) {
+			for (Point::dim_t y = 0; y < image.m_width; ++y) {
+				const size_t pos = image.index(x, y, image.m_layout);
+				image.m_cells[pos] = CellClassifier::classify(image.m_data[pos]);
+
+				if (image.m_cells[pos] != CellClassifier::Cell::WALL) {
+					image.m_passable[x * image.m_passableStride + y / 64] |= uint64_t(1) << (y % 64);
+				}
+			}
+		}
+	}
+	else {
+		if (header.pixelsBytes != cells * sizeof(Pixel::pxl_t) ||
+			header.cellsBytes != cells * sizeof(CellClassifier::Cell) ||
+			header.passableBytes != words * sizeof(uint64_t)) {
+
+			return reject();
+		}
+
+		//	The grid is used straight from the mapping
+		image.m_data.attach(mapping, reinterpret_cast<Pixel::pxl_t*>(base + header.pixelsOffset), cells);
+		image.m_cells.attach(mapping, reinterpret_cast<CellClassifier::Cell*>(base + header.cellsOffset), cells);
+		image.m_passable.attach(mapping, reinterpret_cast<uint64_t*>(base + header.passableOffset), words);
+	}
+
+	//	Restore the results of analyzeImage()
+	info.m_start = Point{ header.startX, header.startY };
+	info.m_keys.clear();
+	info.m_ends.clear();
+
+	const KeyRecord *keys = reinterpret_cast<const KeyRecord*>(base + header.keysOffset);
+	for (uint64_t i = 0; i < header.keyCount; ++i) {
+		info.m_keys[keys[i].color].push_back(Point{ keys[i].x, keys[i].y });
+	}
+
+	const EndRecord *ends = reinterpret_cast<const EndRecord*>(base + header.endsOffset);
+	for (uint64_t i = 0; i < header.endCount; ++i) {
+		info.m_ends.push_back(Point{ ends[i].x, ends[i].y });
+	}
+
+	return true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#ifndef MAZE_CACHE_CLASS_HEADER
+#define MAZE_CACHE_CLASS_HEADER
+
+#include <cstdint>
+#include <string>
+
+#include "ImageInfo.h"
+
+//	Binary file with everything loadImage() and analyzeImage() compute for a maze.
+//	Uncompressed cache files are memory mapped and used directly as the grid of the image,
+//	so a cached maze is loaded without parsing the .bmp file or analyzing it again.
+//
+//	The file starts with a header, followed by sections aligned at 64 bytes:
+//		pixels		- Pixel::pxl_t values in the layout of the image,
+//					  or (length, value) runs of 32 bit numbers when run-length encoded
+//		cells		- CellClassifier::Cell values in the layout of the image(not run-length encoded only)
+//		passable	- passability bit mask(not run-length encoded only)
+//		keys		- (color, id, x, y) records sorted by color, the id of a key is the index of its color
+//		ends		- (x, y) records of the ending zones
+class MazeCache {
+public:
+	static const uint32_t VERSION;
+
+	//	Extension of the cache files, which are kept next to the .bmp files
+	static const char *EXTENSION;
+
+	//	The .bmp file a cache file is made from. A cache file is valid if the size and the
+	//	modification time of the .bmp file are the recorded ones, the content is hashed and compared
+	//	only when they are not, so a warm start does not read the .bmp file at all
+	struct Source {
+		std::string path;
+		uint64_t size = 0;
+		int64_t time = 0;		//	Modification time in the ticks of the file system clock
+		uint64_t hash = 0;
+		bool hashed = false;
+	};
+
+public:
+	//	Fast 64 bit hash of the content of a file. Returns *false* if the file cannot be read
+	static bool hashFile(const std::string &path, uint64_t &hash);
+
+	//	Reads the size and the modification time of *path*. Returns *false* if they cannot be read
+	static bool source(const std::string &path, Source &source);
+
+	//	Path of the cache file for a .bmp file
+	static std::string cachePath(const std::string &imagePath);
+
+	//	Writes an analyzed maze. The pixels are run-length encoded if *rle* is set,
+	//	which makes the file smaller but it has to be decoded when loaded. The source is hashed
+	//	if it was not hashed yet
+	static bool save(const std::string &cachePath, const ImageInfo &info, Source &source, bool rle);
+
+	//	Fills *info* from the cache file. Returns *false* if the file is missing, broken,
+	//	written by another version or made from another .bmp file. The source is hashed only if its
+	//	size or modification time changed, and if the content is the same the cache file records
+	//	the new ones
+	static bool load(const std::string &cachePath, Source &source, ImageInfo &info);
+
+private:
+	//	Hashes the source if it was not hashed yet
+	static bool hashSource(Source &source);
+};
+
+#endif // !MAZE_CACHE_CLASS_HEADER
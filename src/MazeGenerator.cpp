@@ -0,0 +1,483 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include "MazeGenerator.h"
+#include "ImageInfo.h"
+#include "ThreadPool.h"
+
+namespace {
+
+//	Salts of the random choices, so different choices for the same cell are independent
+const uint64_t RUN_SALT = 1;
+const uint64_t NORTH_SALT = 2;
+const uint64_t DOOR_SALT = 3;
+const uint64_t BAND_SALT = 4;
+
+//	Approximate number of bytes every thread generates before the rows are written
+const size_t BATCH_BYTES = 1 << 22;
+
+//	Finalizer of splitmix64
+uint64_t mix(uint64_t value) {
+	value += 0x9e3779b97f4a7c15ull;
+	value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+	value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+	return value ^ (value >> 31);
+}
+
+} // namespace
+
+MazeGenerator::MazeGenerator(const Params &params)
+	: m_params(params)
+	, m_cellSize(params.corridor + params.wall)
+	, m_rows(0)
+	, m_cols(0) {
+
+	const uint32_t key = static_cast<uint32_t>(ImageInfo::KEY_WIDTH);
+
+	if (params.corridor == 0 || params.wall == 0) {
+		throw std::invalid_argument("The corridors and the walls must be at least 1 pixel wide!");
+	}
+
+	//	A door of exactly the size of a key would be taken for a key
+	if (params.corridor == key && params.wall == key) {
+		throw std::invalid_argument("The corridors and the walls cannot both be as wide as a key!");
+	}
+
+	if (params.width > params.wall && params.height > params.wall) {
+		m_cols = (params.width - params.wall) / m_cellSize;
+		m_rows = (params.height - params.wall) / m_cellSize;
+	}
+
+	const uint32_t bands = params.depth + 1;
+	if (m_rows == 0 || m_cols < bands) {
+		throw std::invalid_argument("The maze is too small!");
+	}
+
+	for (uint32_t b = 0; b < bands; ++b) {
+		m_bands.push_back(b * (m_cols / bands));
+	}
+	m_bands.push_back(m_cols);
+
+	for (uint32_t b = 0; b < params.depth; ++b) {
+		m_doorRows.push_back(static_cast<uint32_t>(random(DOOR_SALT, b, 0) % m_rows));
+	}
+
+	m_palette = { Pixel::BLACK, Pixel::WHITE, Pixel::START, Pixel::END };
+	for (uint32_t k = 0; k <= params.depth + params.decoys; ++k) {
+		//	The key and its door have the same color, key 0 is not used
+		m_palette.push_back(keyColor(k));
+		m_palette.push_back(keyColor(k));
+	}
+
+	placeFeatures();
+}
+
+uint32_t MazeGenerator::width() const {
+	return m_cols * m_cellSize + m_params.wall;
+}
+
+uint32_t MazeGenerator::height() const {
+	return m_rows * m_cellSize + m_params.wall;
+}
+
+bool MazeGenerator::saveImage(const std::string &path, unsigned threads) const {
+	std::ofstream ofile(path, std::ios::binary | std::ios::trunc);
+	if (!ofile) {
+		std::cout << "Could not create the output file!\n";
+		return false;
+	}
+
+	if (threads == 0) {
+		threads = ThreadPool::shared().size();
+	}
+
+	const uint32_t w = width();
+	const uint32_t h = height();
+	const size_t padding = (4 - (w * 3) % 4) % 4;
+	const size_t rowBytes = static_cast<size_t>(w) * 3 + padding;
+
+	//	The sizes do not fit in the header of huge images, 0 is allowed for uncompressed ones
+	const uint64_t dataSize = static_cast<uint64_t>(rowBytes) * h;
+	const uint32_t headerSize = dataSize + 54 <= std::numeric_limits<uint32_t>::max() ? static_cast<uint32_t>(dataSize) : 0;
+
+	const uint16_t magic = 0x4D42;
+	const uint32_t fileHeader[] = { headerSize ? headerSize + 54 : 0, 0, 54 };
+	const uint32_t infoHeader[] = { 40, w, h, 0x00180001, 0, headerSize, 0, 0, 0, 0 };
+
+	ofile.write((const char *)&magic, sizeof(magic));
+	ofile.write((const char *)fileHeader, sizeof(fileHeader));
+	ofile.write((const char *)infoHeader, sizeof(infoHeader));
+
+	const uint32_t batch = static_cast<uint32_t>(std::max<size_t>(1, BATCH_BYTES * threads / rowBytes));
+	std::vector<uint32_t> codes;
+	std::vector<char> bytes;
+
+	//	Rows are stored bottom-up, so the file rows [r, r + count) are the image rows [h - r - count, h - r)
+	for (uint32_t r = 0; r < h; r += batch) {
+		const uint32_t count = std::min(batch, h - r);
+		const uint32_t first = h - r - count;
+
+		codes.resize(static_cast<size_t>(count) * w);
+		bytes.assign(rowBytes * count, 0);
+		codeRows(first, first + count, codes.data(), threads);
+
+		ThreadPool::shared().parallelFor(count, [&](size_t row) {
+			const uint32_t *src = codes.data() + (count - 1 - row) * static_cast<size_t>(w);
+			char *dst = bytes.data() + row * rowBytes;
+
+			for (uint32_t y = 0; y < w; ++y) {
+				const Pixel::pxl_t color = m_palette[src[y]];
+				dst[y * 3] = static_cast<char>(color);
+				dst[y * 3 + 1] = static_cast<char>(color >> 8);
+				dst[y * 3 + 2] = static_cast<char>(color >> 16);
+			}
+		});
+
+		ofile.write(bytes.data(), bytes.size());
+	}
+
+	if (!ofile) {
+		std::cout << "The maze was not saved correctly!\n";
+		return false;
+	}
+
+	return true;
+}
+
+void MazeGenerator::generateRow(uint32_t x, Pixel::pxl_t *pixels) const {
+	std::vector<uint8_t> openings;
+	std::vector<uint32_t> codes(width());
+
+	if (x / m_cellSize < m_rows) {
+		cellRow(x / m_cellSize, openings);
+	}
+
+	codeRow(x, openings, codes.data());
+
+	for (size_t y = 0; y < codes.size(); ++y) {
+		pixels[y] = m_palette[codes[y]];
+	}
+}
+
+MazeGenerator::Answer MazeGenerator::solve(unsigned threads) const {
+	Answer answer;
+
+	const uint32_t w = width();
+	const uint32_t h = height();
+	const size_t size = static_cast<size_t>(w) * h;
+	const uint64_t unreached = std::numeric_limits<uint64_t>::max();
+
+	std::vector<uint32_t> codes(size);
+	codeRows(0, h, codes.data(), threads > 0 ? threads : ThreadPool::shared().size());
+
+	//	The solver starts from the first pixel of the starting zone
+	const size_t start = std::find(codes.begin(), codes.end(), static_cast<uint32_t>(START_CODE)) - codes.begin();
+
+	std::vector<uint64_t> dist(size);
+	std::vector<size_t> queue;
+	std::vector<std::pair<uint64_t, size_t>> seeds = { { 0, start } };
+
+	//	Stage s has the doors of the keys [1, s] open and ends on key s + 1, the last one on an ending zone
+	for (uint32_t s = 0; s <= m_params.depth; ++s) {
+		const uint32_t target = s < m_params.depth ? KEY_CODE + 2 * (s + 1) : END_CODE;
+
+		const auto passable = [&](uint32_t code) {
+			if (code < KEY_CODE) {
+				return code != WALL_CODE;
+			}
+
+			//	Keys are collected when touched, doors need their key
+			return (code - KEY_CODE) % 2 == 0 || (code - KEY_CODE) / 2 <= s;
+		};
+
+		std::fill(dist.begin(), dist.end(), unreached);
+		std::sort(seeds.begin(), seeds.end());
+		queue.clear();
+
+		std::vector<std::pair<uint64_t, size_t>> reached;
+		size_t head = 0;
+		size_t nextSeed = 0;
+
+		//	Breadth first search with sources at different distances: the seeds join the queue
+		//	when the search reaches their distance
+		while (head < queue.size() || nextSeed < seeds.size()) {
+			size_t curr = 0;
+
+			if (nextSeed < seeds.size() && (head == queue.size() || seeds[nextSeed].first <= dist[queue[head]])) {
+				curr = seeds[nextSeed].second;
+				if (seeds[nextSeed++].first >= dist[curr]) {
+					continue;
+				}
+
+				dist[curr] = seeds[nextSeed - 1].first;
+			}
+			else {
+				curr = queue[head++];
+			}
+
+			if (codes[curr] == target) {
+				reached.push_back(std::make_pair(dist[curr], curr));
+			}
+
+			const size_t x = curr / w;
+			const size_t y = curr % w;
+			const size_t next[4] = { x > 0 ? curr - w : curr, x + 1 < h ? curr + w : curr, y > 0 ? curr - 1 : curr, y + 1 < w ? curr + 1 : curr };
+
+			for (const auto n : next) {
+				if (dist[n] == unreached && passable(codes[n])) {
+					dist[n] = dist[curr] + 1;
+					queue.push_back(n);
+				}
+			}
+		}
+
+		if (reached.empty()) {
+			return answer;
+		}
+
+		seeds.swap(reached);
+	}
+
+	answer.solvable = true;
+	answer.length = std::min_element(seeds.begin(), seeds.end())->first;
+
+	for (uint32_t k = 1; k <= m_params.depth; ++k) {
+		answer.keys.push_back(keyColor(k));
+	}
+
+	return answer;
+}
+
+bool MazeGenerator::saveAnswer(const std::string &path, const Answer &answer) {
+	std::ofstream ofile(path);
+	if (!ofile) {
+		std::cout << "The file with the answer cannot be generated!\n";
+		return false;
+	}
+
+	ofile << "Solvable: " << (answer.solvable ? "yes" : "no") << "\n";
+
+	if (answer.solvable) {
+		ofile << "Length: " << answer.length << "\n";
+		ofile << "Keys:";
+
+		for (const auto &key : answer.keys) {
+			char color[16];
+			std::snprintf(color, sizeof(color), " %06zx", static_cast<size_t>(key));
+			ofile << color;
+		}
+
+		ofile << "\n";
+	}
+
+	return ofile.good();
+}
+
+Pixel::pxl_t MazeGenerator::keyColor(uint32_t key) {
+	//	An odd multiplier is a bijection modulo 2^24, so different keys get different colors
+	Pixel::pxl_t color = (key * 0x9e3779b1u) & 0x00ffffffu;
+
+	if (color == Pixel::BLACK || color == Pixel::WHITE || color == Pixel::START || color == Pixel::END || color == Pixel::DRAW) {
+		color ^= 0x00010101u;
+	}
+
+	return color;
+}
+
+uint64_t MazeGenerator::random(uint64_t salt, uint64_t a, uint64_t b) const {
+	return mix(m_params.seed ^ mix(salt ^ mix(a ^ mix(b))));
+}
+
+void MazeGenerator::placeFeatures() {
+	const uint32_t key = static_cast<uint32_t>(ImageInfo::KEY_WIDTH);
+	const uint32_t bands = m_params.depth + 1;
+
+	//	A room fits a key with a white frame. Rooms are a cell apart and keep a key width
+	//	away from the doors, so a door is never taken for a part of a key
+	const uint32_t room = (key + 2 + m_params.wall + m_cellSize - 1) / m_cellSize;
+	const uint32_t pad = (key + m_cellSize - 1) / m_cellSize;
+	const uint32_t slotRows = (m_rows + 1) / (room + 1);
+
+	//	Codes of the keys and the ending zones of every band
+	std::vector<std::vector<uint32_t>> items(bands);
+
+	for (uint32_t k = 1; k <= m_params.depth; ++k) {
+		if (m_params.solvable || k < m_params.depth) {
+			items[k - 1].push_back(KEY_CODE + 2 * k);
+		}
+	}
+
+	for (uint32_t d = 0; d < m_params.decoys; ++d) {
+		const uint32_t k = m_params.depth + 1 + d;
+		items[random(BAND_SALT, k, 0) % bands].push_back(KEY_CODE + 2 * k);
+	}
+
+	for (uint32_t e = 0; e < m_params.ends; ++e) {
+		items[bands - 1].push_back(END_CODE);
+	}
+
+	//	The starting zone fills the first cell, which is never in a slot
+	m_features.push_back(Feature{ m_params.wall, m_params.wall, m_params.corridor, START_CODE });
+
+	for (uint32_t b = 0; b < bands; ++b) {
+		const uint32_t first = m_bands[b] + pad;
+		const uint32_t usable = m_bands[b + 1] >= first + pad ? m_bands[b + 1] - first - pad : 0;
+		const uint32_t slotCols = (usable + 1) / (room + 1);
+		const size_t slots = static_cast<size_t>(slotRows) * slotCols;
+
+		if (items[b].size() > slots) {
+			throw std::invalid_argument("The maze is too small for its keys and ending zones!");
+		}
+
+		//	Random distinct slots(partial Fisher-Yates shuffle)
+		std::vector<size_t> order(slots);
+		for (size_t i = 0; i < slots; ++i) {
+			order[i] = i;
+		}
+
+		std::mt19937_64 rng(random(BAND_SALT, b, 1));
+		for (size_t i = 0; i < items[b].size(); ++i) {
+			std::swap(order[i], order[i + rng() % (slots - i)]);
+
+			const uint32_t row = static_cast<uint32_t>(order[i] / slotCols) * (room + 1);
+			const uint32_t col = first + static_cast<uint32_t>(order[i] % slotCols) * (room + 1);
+			const uint32_t x = row * m_cellSize + m_params.wall;
+			const uint32_t y = col * m_cellSize + m_params.wall;
+
+			if (items[b][i] == END_CODE) {
+				m_features.push_back(Feature{ x, y, m_params.corridor, END_CODE });
+				continue;
+			}
+
+			//	The key is in the middle of the inside of the room
+			const uint32_t inside = room * m_cellSize - m_params.wall;
+			m_rooms.push_back(Room{ row, col, room });
+			m_features.push_back(Feature{ x + (inside - key) / 2, y + (inside - key) / 2, key, items[b][i] });
+		}
+	}
+}
+
+void MazeGenerator::cellRow(uint32_t i, std::vector<uint8_t> &openings) const {
+	openings.assign(m_cols, 0);
+
+	for (size_t b = 0; b + 1 < m_bands.size(); ++b) {
+		const uint32_t first = m_bands[b];
+		const uint32_t last = m_bands[b + 1];
+
+		//	Sidewinder: the first row is a single corridor, the other rows are runs of cells
+		//	and every run has a passage to the row above from one of its cells
+		if (i == 0) {
+			for (uint32_t j = first + 1; j < last; ++j) {
+				openings[j] |= WEST;
+			}
+		}
+		else {
+			uint32_t run = first;
+
+			for (uint32_t j = first; j < last; ++j) {
+				if (j + 1 < last && (random(RUN_SALT, i, j) & 1)) {
+					openings[j + 1] |= WEST;
+				}
+				else {
+					openings[run + random(NORTH_SALT, i, run) % (j - run + 1)] |= NORTH;
+					run = j + 1;
+				}
+			}
+		}
+
+		if (b > 0 && i == m_doorRows[b - 1]) {
+			openings[first] |= WEST | DOOR;
+		}
+	}
+
+	for (const auto &room : m_rooms) {
+		if (i < room.row || i >= room.row + room.size) {
+			continue;
+		}
+
+		for (uint32_t j = room.col; j < room.col + room.size; ++j) {
+			if (j > room.col) {
+				openings[j] |= WEST;
+			}
+
+			if (i > room.row) {
+				openings[j] |= NORTH;
+			}
+
+			if (i > room.row && j > room.col) {
+				openings[j] |= CORNER;
+			}
+		}
+	}
+}
+
+void MazeGenerator::codeRow(uint32_t x, const std::vector<uint8_t> &openings, uint32_t *codes) const {
+	const uint32_t w = width();
+	const uint32_t wall = m_params.wall;
+	const uint32_t i = x / m_cellSize;
+	const uint32_t ox = x % m_cellSize;
+
+	std::fill(codes, codes + w, static_cast<uint32_t>(WALL_CODE));
+
+	if (i >= m_rows) {
+		return;
+	}
+
+	for (uint32_t j = 0; j < m_cols; ++j) {
+		uint32_t *cell = codes + static_cast<size_t>(j) * m_cellSize;
+		const uint8_t o = openings[j];
+
+		uint32_t wallCode = WALL_CODE;
+		uint32_t restCode = FREE_CODE;
+
+		//	North wall
+		if (ox < wall) {
+			wallCode = (o & CORNER) ? FREE_CODE : WALL_CODE;
+			restCode = (o & NORTH) ? FREE_CODE : WALL_CODE;
+		}
+		//	West wall, doors are only at the start of a band
+		else if (o & DOOR) {
+			const uint32_t band = static_cast<uint32_t>(std::upper_bound(m_bands.begin(), m_bands.end(), j) - m_bands.begin()) - 1;
+			wallCode = KEY_CODE + 2 * band + 1;
+		}
+		else if (o & WEST) {
+			wallCode = FREE_CODE;
+		}
+
+		std::fill(cell, cell + wall, wallCode);
+		std::fill(cell + wall, cell + m_cellSize, restCode);
+	}
+
+	for (const auto &feature : m_features) {
+		if (x >= feature.x && x < feature.x + feature.size) {
+			std::fill(codes + feature.y, codes + feature.y + feature.size, feature.code);
+		}
+	}
+}
+
+void MazeGenerator::codeRows(uint32_t first, uint32_t last, uint32_t *codes, unsigned threads) const {
+	const size_t w = width();
+	const size_t count = last - first;
+	const size_t chunks = std::min<size_t>(std::max(1u, threads), count);
+
+	ThreadPool::shared().parallelFor(chunks, [&](size_t chunk) {
+		std::vector<uint8_t> openings;
+		uint32_t cached = std::numeric_limits<uint32_t>::max();
+
+		for (uint32_t x = first + static_cast<uint32_t>(count * chunk / chunks); x < first + count * (chunk + 1) / chunks; ++x) {
+			//	The openings are the same for all pixel rows of a cell row
+			const uint32_t i = x / m_cellSize;
+			if (i != cached && i < m_rows) {
+				cellRow(i, openings);
+				cached = i;
+			}
+
+			codeRow(x, openings, codes + (x - first) * w);
+		}
+	});
+}
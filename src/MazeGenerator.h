@@ -0,0 +1,129 @@
+#pragma once
+#ifndef MAZE_GENERATOR_CLASS_HEADER
+#define MAZE_GENERATOR_CLASS_HEADER
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Pixel.h"
+
+//	Generates mazes in the color conventions of the solver.
+//
+//	The maze is a grid of square cells(corridor pixels wide) separated by walls. It is split
+//	in depth + 1 vertical bands and every band is a perfect maze built with the sidewinder
+//	algorithm, whose random choices are hashes of the seed and the position of the cell.
+//	Every row of pixels is therefore computed on its own, so rows are generated in parallel
+//	and streamed to the file without keeping the maze in memory.
+//
+//	Band b is connected to band b + 1 by a single door, whose key lies in band b, so the keys
+//	have to be collected in order. The starting zone is in the first band and the ending zones
+//	are in the last one. Keys(20x20) are placed in rooms of cells without inner walls
+class MazeGenerator {
+public:
+	struct Params {
+		uint32_t width = 1024;		//	The maze is cropped to a whole number of cells
+		uint32_t height = 1024;
+		uint32_t corridor = 8;		//	Width of the corridors in pixels
+		uint32_t wall = 4;			//	Thickness of the walls in pixels
+		uint32_t depth = 2;			//	Number of doors between the start and the ending zones
+		uint32_t decoys = 0;		//	Keys without doors
+		uint32_t ends = 1;			//	Number of ending zones
+		bool solvable = true;		//	The key of the last door is left out if not set
+		uint64_t seed = 1;
+	};
+
+	//	Shortest solution, computed with a breadth first search for every collected key
+	struct Answer {
+		bool solvable = false;
+		uint64_t length = 0;					//	Number of horizontal and vertical steps
+		std::vector<Pixel::pxl_t> keys;			//	Keys in the order they are collected
+	};
+
+public:
+	//	Throws std::invalid_argument if the maze cannot be built with these parameters
+	explicit MazeGenerator(const Params &params);
+	MazeGenerator(const MazeGenerator &r) = default;
+	MazeGenerator& operator=(const MazeGenerator &rhs) = default;
+	~MazeGenerator() = default;
+
+public:
+	uint32_t width() const;
+	uint32_t height() const;
+
+	//	Writes the maze as a 24 bits per pixel .bmp file, 0 threads means one for every core
+	bool saveImage(const std::string &path, unsigned threads = 0) const;
+
+	//	Pixels of row x(top-down), *pixels* must hold width() values
+	void generateRow(uint32_t x, Pixel::pxl_t *pixels) const;
+
+	//	Solves the maze. Needs about 20 bytes for every pixel
+	Answer solve(unsigned threads = 0) const;
+
+	//	Writes the answer as text: solvability, length and the colors of the keys in order
+	static bool saveAnswer(const std::string &path, const Answer &answer);
+
+	//	Color of key *key*(from 1), different for every key and never a reserved color
+	static Pixel::pxl_t keyColor(uint32_t key);
+
+private:
+	//	Openings of a cell
+	enum Opening : uint8_t {
+		NORTH = 1,		//	Passage to the cell above
+		WEST = 2,		//	Passage to the cell on the left
+		DOOR = 4,		//	The west passage is a door
+		CORNER = 8		//	The north-west corner is open(inside rooms)
+	};
+
+	//	Codes of the generated pixels, keys and doors are KEY_CODE + 2 * key(+ 1 for doors)
+	enum Code : uint32_t {
+		WALL_CODE,
+		FREE_CODE,
+		START_CODE,
+		END_CODE,
+		KEY_CODE
+	};
+
+	//	Rectangle of pixels with the same code(keys, starting and ending zones)
+	struct Feature {
+		uint32_t x;
+		uint32_t y;
+		uint32_t size;
+		uint32_t code;
+	};
+
+	//	Cells [col, col + size) of the rows [row, row + size) without inner walls
+	struct Room {
+		uint32_t row;
+		uint32_t col;
+		uint32_t size;
+	};
+
+private:
+	uint64_t random(uint64_t salt, uint64_t a, uint64_t b) const;
+
+	//	Places the rooms, keys, doors and zones of every band
+	void placeFeatures();
+
+	//	Computes the openings of every cell of cell row i
+	void cellRow(uint32_t i, std::vector<uint8_t> &openings) const;
+
+	//	Codes of pixel row x, *openings* must be the ones of its cell row
+	void codeRow(uint32_t x, const std::vector<uint8_t> &openings, uint32_t *codes) const;
+
+	//	Codes of the rows [first, last), every thread generates a contiguous range
+	void codeRows(uint32_t first, uint32_t last, uint32_t *codes, unsigned threads) const;
+
+private:
+	Params m_params;
+	uint32_t m_cellSize;					//	corridor + wall
+	uint32_t m_rows;						//	Number of cell rows
+	uint32_t m_cols;						//	Number of cell columns
+	std::vector<uint32_t> m_bands;			//	First cell column of every band and m_cols
+	std::vector<uint32_t> m_doorRows;		//	Cell row of the door at the start of band b + 1
+	std::vector<Room> m_rooms;
+	std::vector<Feature> m_features;
+	std::vector<Pixel::pxl_t> m_palette;	//	Color of every code
+};
+
+#endif // !MAZE_GENERATOR_CLASS_HEADER
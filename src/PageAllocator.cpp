@@ -0,0 +1,64 @@
+#include <atomic>
+#include <cstdlib>
+#include "PageAllocator.h"
+
+#if defined(_WIN32)
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+const size_t PageMemory::HUGE_PAGE = 2u << 20;
+
+namespace {
+	std::atomic<bool> hugePagesEnabled(false);
+}
+
+void* PageMemory::allocate(size_t bytes) {
+	if (bytes < HUGE_PAGE) {
+		return ::operator new(bytes);
+	}
+
+	//	Whole huge pages, so the end of the block does not share a page with other data
+	const size_t rounded = (bytes + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+
+#if defined(_WIN32)
+	void *block = _aligned_malloc(rounded, HUGE_PAGE);
+#else
+	void *block = std::aligned_alloc(HUGE_PAGE, rounded);
+#endif
+
+	if (!block) {
+		throw std::bad_alloc();
+	}
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+	//	Only a hint, the kernel may ignore it
+	if (hugePagesEnabled.load(std::memory_order_relaxed)) {
+		madvise(block, rounded, MADV_HUGEPAGE);
+	}
+#endif
+
+	return block;
+}
+
+void PageMemory::deallocate(void *block, size_t bytes) {
+	if (bytes < HUGE_PAGE) {
+		::operator delete(block);
+		return;
+	}
+
+#if defined(_WIN32)
+	_aligned_free(block);
+#else
+	std::free(block);
+#endif
+}
+
+void PageMemory::setHugePages(bool enabled) {
+	hugePagesEnabled = enabled;
+}
+
+bool PageMemory::hugePages() {
+	return hugePagesEnabled;
+}
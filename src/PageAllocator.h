@@ -0,0 +1,53 @@
+#pragma once
+#ifndef PAGE_ALLOCATOR_CLASS_HEADER
+#define PAGE_ALLOCATOR_CLASS_HEADER
+
+#include <cstddef>
+#include <new>
+
+//	Memory of the arrays as large as the image. Blocks of at least HUGE_PAGE bytes are aligned to it,
+//	and if huge pages are enabled they are backed by transparent huge pages(Linux only), which saves
+//	most of the TLB misses of the random accesses of the search
+class PageMemory {
+public:
+	static const size_t HUGE_PAGE;
+
+public:
+	static void* allocate(size_t bytes);
+	static void deallocate(void *block, size_t bytes);
+
+	static void setHugePages(bool enabled);
+	static bool hugePages();
+};
+
+//	Allocator of the standard containers that takes its memory from PageMemory
+template <typename T>
+class PageAllocator {
+public:
+	using value_type = T;
+
+public:
+	PageAllocator() = default;
+
+	template <typename U>
+	PageAllocator(const PageAllocator<U> &) {
+
+	}
+
+public:
+	T* allocate(size_t count) {
+		return static_cast<T*>(PageMemory::allocate(count * sizeof(T)));
+	}
+
+	void deallocate(T *block, size_t count) {
+		PageMemory::deallocate(block, count * sizeof(T));
+	}
+
+	template <typename U>
+	bool operator==(const PageAllocator<U> &) const { return true; }
+
+	template <typename U>
+	bool operator!=(const PageAllocator<U> &) const { return false; }
+};
+
+#endif // !PAGE_ALLOCATOR_CLASS_HEADER
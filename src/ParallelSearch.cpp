@@ -0,0 +1,355 @@
+#include <algorithm>
+#include <thread>
+#include "ParallelSearch.h"
+
+namespace {
+	//	Binary heap with the lowest priority on top
+	template <typename Entry>
+	struct Greater {
+		bool operator()(const Entry &lhs, const Entry &rhs) const { return lhs.priority > rhs.priority; }
+	};
+}
+
+ParallelSearch::ParallelSearch(unsigned threads)
+	: m_pool(std::max(threads, 1u))
+	, m_sparse(false)
+	, m_finder(nullptr)
+	, m_stop(false)
+	, m_pending(0)
+	, m_idle(0)
+	, m_wakeups(0)
+	, m_expanded(0)
+	, m_bound(SearchState::NO_COST)
+	, m_stopStatus(-1)
+	, m_hasBest(false) {
+
+	//	Every worker blocks until the search ends, so there is a thread for each of them
+	for (unsigned i = 0; i < m_pool.size(); ++i) {
+		m_workers.emplace_back(new Worker());
+		m_workers.back()->inbox = nullptr;
+		m_workers.back()->outbox.resize(m_pool.size());
+		m_workers.back()->expanded = 0;
+	}
+}
+
+ParallelSearch::~ParallelSearch() {
+	for (auto &worker : m_workers) {
+		release(worker->inbox.exchange(nullptr));
+	}
+}
+
+ParallelSearch::Result ParallelSearch::run(PathFinder &finder, const Point &start, double weight) {
+	const auto &image = finder.m_imgData->getImage();
+
+	m_finder = &finder;
+	m_sparse = image.compact();
+
+	if (!m_sparse) {
+		m_dense.reset(SearchState::Mode::DENSE, image.width(), image.size());
+	}
+
+	for (auto &worker : m_workers) {
+		//	Only the image and the keys of the stage are needed to jump
+		worker->finder.m_imgData = finder.m_imgData;
+		worker->finder.m_inventory = finder.m_inventory;
+		worker->finder.m_movement = finder.m_movement;
+		worker->finder.m_engine = finder.m_engine;
+		worker->finder.m_readBounds = finder.m_readBounds;
+		worker->finder.m_stats = SearchStats();
+
+		if (m_sparse) {
+			worker->state.reset(SearchState::Mode::SPARSE, image.width(), image.size());
+		}
+
+		release(worker->inbox.exchange(nullptr));
+		worker->open.clear();
+		worker->expanded = 0;
+
+		for (auto &messages : worker->outbox) {
+			messages.clear();
+		}
+	}
+
+	m_stop = false;
+	m_pending = 0;
+	m_idle = 0;
+	m_wakeups = 0;
+	m_expanded = finder.m_expanded;
+	m_bound = SearchState::NO_COST;
+	m_stopStatus = -1;
+	m_hasBest = false;
+
+	//	The start is the only point in the open lists
+	Worker &first = *m_workers[owner(start)];
+	state(start).set(start, start, 0);
+	first.open.push_back(Entry{ 0, 0, start });
+
+	m_pool.parallelFor(m_workers.size(), [&](size_t index) {
+		work(static_cast<unsigned>(index), weight);
+	});
+
+	Result result;
+
+	for (auto &worker : m_workers) {
+		const auto &bounds = worker->finder.m_readBounds;
+		finder.m_readBounds.include(bounds.minX, bounds.minY);
+		finder.m_readBounds.include(bounds.maxX, bounds.maxY);
+
+		finder.m_expanded += worker->expanded;
+		finder.m_stats.addCounters(worker->finder.m_stats);
+
+		release(worker->inbox.exchange(nullptr));
+	}
+
+	if (m_stopStatus >= 0) {
+		result.interrupted = true;
+		result.status = static_cast<PathFinder::Status>(m_stopStatus.load());
+		finder.m_status = result.status;
+	}
+	else if (m_hasBest) {
+		result.found = true;
+		result.status = PathFinder::Status::FOUND;
+		result.target = m_best.target;
+		result.source = m_best.source;
+	}
+
+	return result;
+}
+
+Point ParallelSearch::parent(const Point &point) const {
+	//	The source was reached from the expanded point, unless it already had a cheaper parent
+	//	(the message with the source was not sent when the stage ended)
+	if (m_hasBest && point == m_best.source) {
+		const size_t cost = state(m_best.expanded).cost(m_best.expanded) + m_finder->stepCost(m_best.expanded, point);
+
+		if (cost < state(point).cost(point)) {
+			return m_best.expanded;
+		}
+	}
+
+	return state(point).parent(point);
+}
+
+unsigned ParallelSearch::threads() const {
+	return static_cast<unsigned>(m_workers.size());
+}
+
+unsigned ParallelSearch::owner(const Point &point) const {
+	uint64_t hash = (static_cast<uint64_t>(static_cast<uint32_t>(point.x())) << 32) | static_cast<uint32_t>(point.y());
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+
+	return static_cast<unsigned>(hash % m_workers.size());
+}
+
+SearchState& ParallelSearch::state(const Point &point) {
+	return m_sparse ? m_workers[owner(point)]->state : m_dense;
+}
+
+const SearchState& ParallelSearch::state(const Point &point) const {
+	return m_sparse ? m_workers[owner(point)]->state : m_dense;
+}
+
+void ParallelSearch::work(unsigned index, double weight) {
+	Worker &worker = *m_workers[index];
+	PathFinder &finder = worker.finder;
+
+	while (!m_stop) {
+		receive(index, weight);
+
+		//	Points from the priority of the best candidate on cannot lead to a better one
+		if (!worker.open.empty() && worker.open.front().priority >= m_bound) {
+			worker.open.clear();
+		}
+
+		if (worker.open.empty()) {
+			++m_idle;
+
+			while (!m_stop && worker.inbox.load() == nullptr) {
+				if (finished()) {
+					m_stop = true;
+					break;
+				}
+
+				std::this_thread::yield();
+			}
+
+			//	Counted before the worker stops being idle, see finished()
+			++m_wakeups;
+			--m_idle;
+			continue;
+		}
+
+		const Entry entry = worker.open.front();
+		std::pop_heap(worker.open.begin(), worker.open.end(), Greater<Entry>());
+		worker.open.pop_back();
+
+		SEARCH_STAT(++finder.m_stats.heapPops;)
+
+		//	The cost of the point was lowered after it was pushed
+		if (entry.cost > state(entry.point).cost(entry.point)) {
+			SEARCH_STAT(++finder.m_stats.stalePops;)
+			continue;
+		}
+
+		++worker.expanded;
+		++m_expanded;
+
+		if (outOfBudget(worker)) {
+			break;
+		}
+
+		const Point &curr = entry.point;
+		Point target{ -1,-1 };
+
+		const auto &frontier = finder.successors(curr, state(curr).parent(curr), target);
+
+		//	The stage ends with the expanded point of the lowest priority that reaches a target
+		if (target != Point{ -1,-1 }) {
+			offer(Candidate{ entry.priority, curr, frontier.back(), target });
+			continue;
+		}
+
+		for (const auto &point : frontier) {
+			const Message message{ point, curr, entry.cost + finder.stepCost(curr, point) };
+			const unsigned to = owner(point);
+
+			if (to == index) {
+				relax(worker, message, weight);
+			}
+			else {
+				worker.outbox[to].push_back(message);
+			}
+		}
+
+		flush(index);
+	}
+}
+
+void ParallelSearch::relax(Worker &worker, const Message &message, double weight) {
+	SearchState &pointState = state(message.point);
+
+	if (message.cost >= pointState.cost(message.point)) {
+		return;
+	}
+
+	pointState.set(message.point, message.parent, message.cost);
+
+	const size_t priority = message.cost + static_cast<size_t>(weight * worker.finder.closestKeyCost(message.point));
+	SEARCH_STAT(++worker.finder.m_stats.keyCostEvaluations;)
+
+	if (priority >= m_bound) {
+		return;
+	}
+
+	SEARCH_STAT(++worker.finder.m_stats.heapPushes;)
+	SEARCH_STAT(worker.finder.m_stats.allocations += worker.open.size() == worker.open.capacity();)
+
+	worker.open.push_back(Entry{ priority, message.cost, message.point });
+	std::push_heap(worker.open.begin(), worker.open.end(), Greater<Entry>());
+}
+
+void ParallelSearch::receive(unsigned index, double weight) {
+	Worker &worker = *m_workers[index];
+	Batch *batch = worker.inbox.exchange(nullptr);
+	size_t received = 0;
+
+	for (Batch *curr = batch; curr; curr = curr->next) {
+		for (const auto &message : curr->messages) {
+			relax(worker, message, weight);
+		}
+
+		received += curr->messages.size();
+	}
+
+	release(batch);
+
+	//	The points are in the open list now, so the messages are not in flight anymore
+	m_pending -= received;
+}
+
+void ParallelSearch::flush(unsigned index) {
+	Worker &worker = *m_workers[index];
+
+	for (size_t to = 0; to < worker.outbox.size(); ++to) {
+		auto &messages = worker.outbox[to];
+
+		if (messages.empty()) {
+			continue;
+		}
+
+		Batch *batch = new Batch{ std::move(messages), nullptr };
+		messages.clear();
+
+		//	Counted before they can be received
+		m_pending += batch->messages.size();
+		push(m_workers[to]->inbox, batch);
+	}
+}
+
+bool ParallelSearch::finished() const {
+	//	A worker that took messages after the idle workers were counted changed the wake ups,
+	//	even if it already processed them(and sent none, or they were processed too)
+	const uint64_t wakeups = m_wakeups.load();
+
+	return m_idle.load() == m_workers.size() && m_pending.load() == 0 && m_wakeups.load() == wakeups;
+}
+
+bool ParallelSearch::outOfBudget(Worker &worker) {
+	const auto &budget = m_finder->m_budget;
+	int status = -1;
+
+	if (budget.maxExpansions > 0 && m_expanded.load(std::memory_order_relaxed) > budget.maxExpansions) {
+		status = static_cast<int>(PathFinder::Status::BUDGET_EXHAUSTED);
+	}
+	//	The flag and the clock are polled every 256 expansions of every worker
+	else if ((worker.expanded & 0xFF) != 0) {
+		return false;
+	}
+	else if (budget.cancel && budget.cancel->load(std::memory_order_relaxed)) {
+		status = static_cast<int>(PathFinder::Status::CANCELLED);
+	}
+	else if (budget.deadline != std::chrono::steady_clock::time_point::max() && std::chrono::steady_clock::now() >= budget.deadline) {
+		status = static_cast<int>(PathFinder::Status::BUDGET_EXHAUSTED);
+	}
+
+	if (status < 0) {
+		return false;
+	}
+
+	int none = -1;
+	m_stopStatus.compare_exchange_strong(none, status);
+	m_stop = true;
+
+	return true;
+}
+
+void ParallelSearch::offer(const Candidate &candidate) {
+	std::lock_guard<std::mutex> lock(m_candidateMutex);
+
+	const bool better = !m_hasBest || candidate.priority < m_best.priority ||
+		(candidate.priority == m_best.priority && (candidate.expanded.x() < m_best.expanded.x() ||
+			(candidate.expanded.x() == m_best.expanded.x() && candidate.expanded.y() < m_best.expanded.y())));
+
+	if (better) {
+		m_best = candidate;
+		m_hasBest = true;
+		m_bound = candidate.priority;
+	}
+}
+
+void ParallelSearch::push(std::atomic<Batch*> &inbox, Batch *batch) {
+	batch->next = inbox.load();
+
+	while (!inbox.compare_exchange_weak(batch->next, batch)) {
+	}
+}
+
+void ParallelSearch::release(Batch *batch) {
+	while (batch) {
+		Batch *next = batch->next;
+		delete batch;
+		batch = next;
+	}
+}
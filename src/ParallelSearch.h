@@ -0,0 +1,141 @@
+#pragma once
+#ifndef PARALLEL_SEARCH_CLASS_HEADER
+#define PARALLEL_SEARCH_CLASS_HEADER
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "PathFinder.h"
+#include "SearchState.h"
+#include "ThreadPool.h"
+
+//	Hash distributed A*(HDA*) for a single stage of PathFinder::findPath().
+//
+//	Every point is owned by one worker(a hash of its coordinates). A worker keeps the open list
+//	and the parents and costs of its points, expands them with the jumps of the finder and sends
+//	every successor to its owner through a lock-free queue(many producers, one consumer). The
+//	first key or ending zone is reached from the point with the lowest priority that meets one,
+//	so the workers go on until no point with a lower priority is left in an open list or a queue.
+//	Termination is detected with the number of messages in flight, the number of idle workers
+//	and a counter of wake ups that tells if a worker was woken while the others were counted.
+//
+//	The result is the same as the one of the single threaded search, except that points with the
+//	same priority may be expanded in another order, so among equal paths another one can be found
+class ParallelSearch {
+public:
+	//	Outcome of a stage
+	struct Result {
+		bool found = false;			//	A key or an ending zone was reached
+		bool interrupted = false;	//	The budget of the finder ended or the search was cancelled
+		PathFinder::Status status = PathFinder::Status::NO_PATH;
+		Point target{ -1, -1 };		//	The key or ending zone
+		Point source{ -1, -1 };		//	The successor whose jump reached the target, the path goes on with its parents
+	};
+
+public:
+	explicit ParallelSearch(unsigned threads);
+	ParallelSearch(const ParallelSearch &r) = delete;
+	ParallelSearch& operator=(const ParallelSearch &rhs) = delete;
+	~ParallelSearch();
+
+public:
+	//	Searches the stage of *finder* that starts at *start*, with the inventory of the finder.
+	//	Adds the expanded points, the read pixels and the counters to the finder
+	Result run(PathFinder &finder, const Point &start, double weight);
+
+	//	Parent of a point reached by the last run(), the start is its own parent
+	Point parent(const Point &point) const;
+
+	unsigned threads() const;
+
+private:
+	//	Successor sent to the owner of *point*
+	struct Message {
+		Point point;
+		Point parent;
+		size_t cost;
+	};
+
+	//	Messages of one expansion for one worker, pushed on the queue of the worker at once
+	struct Batch {
+		std::vector<Message> messages;
+		Batch *next;
+	};
+
+	struct Entry {
+		size_t priority;
+		size_t cost;
+		Point point;
+	};
+
+	struct Worker {
+		PathFinder finder;				//	Copy of the finder, with its own counters and read pixels
+		SearchState state;				//	Parents and costs of the owned points(SPARSE mode only)
+		std::vector<Entry> open;		//	Binary heap with the lowest priority on top
+		std::atomic<Batch*> inbox;		//	Lock-free stack, taken whole by the owner
+		std::vector<std::vector<Message>> outbox;	//	Messages of the current expansion for every worker
+		size_t expanded;
+	};
+
+	//	Point reached by a jump and the point that was expanded
+	struct Candidate {
+		size_t priority;
+		Point expanded;
+		Point source;
+		Point target;
+	};
+
+private:
+	unsigned owner(const Point &point) const;
+	SearchState& state(const Point &point);
+	const SearchState& state(const Point &point) const;
+
+	//	Expands the points of worker *index* until the search ends
+	void work(unsigned index, double weight);
+
+	//	Lowers the cost of a point owned by *worker* and adds it to its open list
+	void relax(Worker &worker, const Message &message, double weight);
+
+	//	Relaxes the messages sent to worker *index*
+	void receive(unsigned index, double weight);
+
+	//	Sends the messages of the current expansion of worker *index*
+	void flush(unsigned index);
+
+	//	Returns *true* if every worker is idle and no message is in flight
+	bool finished() const;
+
+	//	Stops the workers if the budget of the finder ended or the search was cancelled
+	bool outOfBudget(Worker &worker);
+
+	//	Keeps the candidate with the lowest priority(and the lowest expanded point on ties)
+	void offer(const Candidate &candidate);
+
+	static void push(std::atomic<Batch*> &inbox, Batch *batch);
+	static void release(Batch *batch);
+
+private:
+	ThreadPool m_pool;
+	std::vector<std::unique_ptr<Worker>> m_workers;
+	SearchState m_dense;		//	Shared by the workers in DENSE mode, every one writes only its points
+	bool m_sparse;
+
+	PathFinder *m_finder;
+
+	std::atomic<bool> m_stop;
+	std::atomic<size_t> m_pending;		//	Messages sent and not processed yet
+	std::atomic<unsigned> m_idle;		//	Workers without points to expand
+	std::atomic<uint64_t> m_wakeups;
+	std::atomic<size_t> m_expanded;		//	Expansions of all workers, for the budget
+	std::atomic<size_t> m_bound;		//	Priority of the best candidate, points from it on are not expanded
+	std::atomic<int> m_stopStatus;		//	PathFinder::Status that stopped the search, -1 if none
+
+	std::mutex m_candidateMutex;
+	Candidate m_best;
+	bool m_hasBest;
+};
+
+#endif // !PARALLEL_SEARCH_CLASS_HEADER
@@ -2,10 +2,20 @@
 #include <limits>
 #include <cmath>
 #include <queue>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
 #include "PathFinder.h"
+#include "BidirectionalSearch.h"
+#include "CoarseGrid.h"
+#include "LineRasterizer.h"
+#include "ParallelSearch.h"
+#include "Trace.h"
+#include "Workspace.h"
 
 PathFinder::PathFinder()
-	: m_imgData(nullptr) {
+	: m_imgData(nullptr), m_expanded(0), m_status(Status::NO_PATH), m_readBounds{ 0, 0, 0, 0 }, m_cache(nullptr), m_gridHash(0), m_gridHashed(false), m_searchThreads(1), m_bidirectional(false), m_engine(SearchPolicy::Engine::JPS), m_workspace(nullptr), m_passEnds(false) {
 
 }
 
@@ -15,6 +25,10 @@ PathFinder::PathFinder(ImageInfo &imageInfo)
 }
 
 bool PathFinder::findPath() {
+	TRACE_SCOPE("findPath");
+
+	m_status = Status::NO_PATH;
+
 	//	Check for null pointer(possible problems if the pointer is dangling)
 	if (!m_imgData) {
 		std::cout << "There is no image to process!\n";
@@ -25,82 +39,373 @@ bool PathFinder::findPath() {
 		return false;
 	}
 
-	//	Clear all accumulated information
-	m_inventory.clear();
-	m_paths.clear();
+	//	Regular mazes are searched on their cells
+	if (CoarseGrid *grid = m_imgData->coarseGrid()) {
+		return findCoarsePath(*grid);
+	}
+
+	m_expanded = 0;
+	m_stats = SearchStats();
+
+	//	Best complete path of the passes so far
+	std::vector<std::vector<Point>> bestPaths;
+	std::vector<Pixel::pxl_t> bestInventory;
+	std::vector<Bounds> bestBounds;
+	size_t bestCost = 0;
+	bool hasBest = false;
+
+	//	Anytime search: the first pass finds a path quickly with an inflated heuristic,
+	//	every next pass halves the inflation until the last one searches with weight 1
+	for (double weight = m_engine == SearchPolicy::Engine::FLOOD ? 1.0 : std::max(m_budget.weight, 1.0); ; weight = weight - 1.0 < 0.25 ? 1.0 : 1.0 + (weight - 1.0) / 2) {
+		//	Clear all accumulated information
+		m_inventory.clear();
+		m_paths.clear();
+		m_stageBounds.clear();
+
+		if (search(weight)) {
+			const size_t cost = pathCost();
+
+			if (!hasBest || cost <= bestCost) {
+				bestPaths.swap(m_paths);
+				bestInventory.swap(m_inventory);
+				bestBounds.swap(m_stageBounds);
+
+				//	Only the stages of weight 1 can be repaired by resolve()
+				if (weight != 1.0) {
+					bestBounds.clear();
+				}
+
+				bestCost = cost;
+				hasBest = true;
+			}
+		}
+
+		if (m_status == Status::BUDGET_EXHAUSTED || m_status == Status::CANCELLED || weight == 1.0) {
+			break;
+		}
+	}
+
+	if (hasBest) {
+		m_paths.swap(bestPaths);
+		m_inventory.swap(bestInventory);
+		m_stageBounds.swap(bestBounds);
+
+		if (m_status == Status::BUDGET_EXHAUSTED) {
+			m_status = Status::APPROXIMATE;
+		}
+		else if (m_status == Status::NO_PATH) {
+			m_status = Status::FOUND;
+		}
+	}
+
+	m_stats.status = statusName(m_status);
+	return hasBest;
+}
+
+bool PathFinder::findCoarsePath(CoarseGrid &grid) {
+	ImageInfo &pixels = *m_imgData;
+
+	//	The finder is back on the pixels even if the search throws
+	struct Restore {
+		PathFinder &finder;
+		ImageInfo &pixels;
+		SearchPolicy::Movement movement;
+		~Restore() { finder.m_imgData = &pixels; finder.m_gridHashed = false; finder.m_movement = movement; }
+	} restore{ *this, pixels, m_movement };
+
+	setImageData(grid.info());
+	m_movement = CoarseGrid::movement(m_movement);
+	const bool found = findPath();
+
+	//	Every stage goes on from the pixel where the stage before it ended
+	Point previous = pixels.startPoint();
+
+	for (auto &path : m_paths) {
+		grid.mapStage(pixels.getImage(), previous, path);
+		previous = path.front();
+	}
+
+	//	What the stages read is known in cells, resolve() searches the pixels again
+	m_stageBounds.clear();
+
+	return found;
+}
 
-	//	Used for the priority queue
-	using qType = std::pair<Point, size_t>;
-	struct Comp { bool operator()(const qType &lhs, const qType &rhs) const { return lhs.second > rhs.second; } };
+bool PathFinder::resolve(const std::vector<ImageInfo::PixelEdit> &edits) {
+	TRACE_SCOPE("resolve");
 
-	const size_t imgWidth = m_imgData->getImage().width();
-	const size_t imgSize = m_imgData->getImage().size();
+	if (!m_imgData) {
+		std::cout << "There is no image to process!\n";
+		return false;
+	}
+
+	std::vector<Point> changed;
+	const bool analysisChanged = m_imgData->applyEdits(edits, changed);
+
+	m_expanded = 0;
+	m_stats = SearchStats();
 
-	//	The algorithm uses several starting points for its inner search
+	if (!changed.empty()) {
+		m_gridHashed = false;
+	}
+
+	//	There is nothing to repair
+	if (m_stageBounds.empty()) {
+		return findPath();
+	}
+
+	//	The heuristic depends on every key and ending zone, so every stage may change with them
+	size_t first = analysisChanged ? 0 : m_stageBounds.size();
+
+	for (size_t stage = 0; stage < first; ++stage) {
+		for (const auto &point : changed) {
+			if (m_stageBounds[stage].contains(point)) {
+				first = stage;
+				break;
+			}
+		}
+	}
+
+	//	No stage read a changed pixel, so the search would do exactly the same
+	if (first == m_stageBounds.size()) {
+		m_status = m_paths.empty() ? Status::NO_PATH : Status::FOUND;
+		m_stats.status = statusName(m_status);
+		return !m_paths.empty();
+	}
+
+	//	Keys and ending zones are looked up by the search, so they have to be valid
+	if (first == 0 || m_paths.size() != m_stageBounds.size() ||
+		m_imgData->getEnds().empty() || m_imgData->startPoint() == Point{ -1,-1 }) {
+
+		if (!findPath()) {
+			m_inventory.clear();
+			m_paths.clear();
+			return false;
+		}
+
+		return true;
+	}
+
+	//	Keep the stages before the first changed one, the search goes on from the key that ends them
+	m_paths.resize(first);
+	m_inventory.resize(first);
+	m_stageBounds.resize(first);
+
+	const bool found = search(1.0);
+	m_stats.status = statusName(m_status);
+
+	return found;
+}
+
+bool PathFinder::search(double weight) {
+	const auto searchBegin = std::chrono::steady_clock::now();
+
+	const auto &image = m_imgData->getImage();
+
+	//	The algorithm uses several starting points for its inner search,
+	//	a repaired search goes on from the last kept key
 	std::queue<Point> startingPoints;
-	startingPoints.push(m_imgData->startPoint());
+	startingPoints.push(m_paths.empty() ? m_imgData->startPoint() : m_paths.back().front());
 
 	bool endFound = false;
 
-	//	Vector of parents for every pixel
-	std::vector<Point> came_from(imgSize);
+	//	The arrays, the queue and the searches of a solve are kept in the workspace of the
+	//	batch, if there is one, so the next solve does not allocate them again
+	std::unique_ptr<Workspace> local;
+	if (!m_workspace) {
+		local.reset(new Workspace());
+	}
+
+	Workspace &workspace = m_workspace ? *m_workspace : *local;
+
+	//	Parent and cost/distance for every reached pixel. Run-length encoded images
+	//	are used for maps too large for dense arrays, so only the reached pixels are kept
+	SearchState &state = workspace.m_state;
+	const auto mode = image.compact() ? SearchState::Mode::SPARSE : SearchState::Mode::DENSE;
+
+	//	The storage of the queue is reused by all inner searches
+	std::vector<QueueEntry> &currQueue = workspace.m_queue;
 
-	//	Cost/distance for every pixel
-	std::vector<size_t> cost(imgSize);
+	//	The cached stages were searched with weight 1
+	ResultCache *cache = weight == 1.0 ? m_cache : nullptr;
+
+	//	The flood expands the pixels in the order of their cost
+	if (m_engine == SearchPolicy::Engine::FLOOD) {
+		weight = 0.0;
+	}
+	bool interrupted = false;
+
+	//	Single stages of huge images are searched by several threads
+	ParallelSearch *parallel = nullptr;
+	if (m_searchThreads > 1) {
+		if (!workspace.m_parallel || workspace.m_parallel->threads() != m_searchThreads) {
+			workspace.m_parallel.reset(new ParallelSearch(m_searchThreads));
+		}
+
+		parallel = workspace.m_parallel.get();
+	}
+
+	//	The last stage has known targets, so it can be searched from both ends
+	BidirectionalSearch *bidirectional = nullptr;
+	if (m_bidirectional) {
+		if (!workspace.m_bidirectional) {
+			workspace.m_bidirectional.reset(new BidirectionalSearch());
+		}
+
+		bidirectional = workspace.m_bidirectional.get();
+	}
+
+	const auto reachTarget = [&](const Point &target) {
+		m_paths.push_back(std::vector<Point>());
+		m_paths.back().push_back(target);
+
+		//	Update the startingPoint
+		if (image.cell(target) != CellClassifier::Cell::END) {
+			m_inventory.push_back(image.pixel(target));
+			startingPoints.push(target);
+		}
+		else {
+			endFound = true;
+		}
+	};
+
+	//	Cached stages are keyed by the content of the grid
+	if (cache && !m_gridHashed) {
+		m_gridHash = image.contentHash();
+		m_gridHashed = true;
+	}
+
+	//	The stages depend on the movement rules too, the default ones keep the hash of the grid. The
+	//	landmarks and the engine may change which key a stage collects first and the bidirectional
+	//	search may find another last stage, so they are a part of the key as well
+	const Landmarks *landmarks = m_imgData->landmarks();
+	const uint64_t landmarkCount = landmarks && landmarks->movement() == m_movement ? landmarks->points().size() : 0;
+	const uint64_t gridKey = m_gridHash ^ (landmarkCount << 48) ^ (static_cast<uint64_t>(m_movement.connectivity) << 56) ^
+		(static_cast<uint64_t>(m_engine) << 58) ^ (static_cast<uint64_t>(m_movement.cost) << 60) ^ (static_cast<uint64_t>(m_bidirectional) << 62);
 
 	//	Iterate over the starting points
-	while (!endFound && !startingPoints.empty()) {
-		//	Clear the information for the parents from the previous search
-		came_from.assign(imgSize, Point{ -1,-1 });
-		came_from[startingPoints.front().x() * imgWidth + startingPoints.front().y()] = startingPoints.front();
+	for (int64_t stage = static_cast<int64_t>(m_paths.size()); !endFound && !interrupted && !startingPoints.empty(); ++stage) {
+		TRACE_SCOPE("stage", stage);
+		SEARCH_STAT(++m_stats.stages; ++m_stats.stateResets;)
+		SEARCH_STAT(const auto stageBegin = std::chrono::steady_clock::now();)
+
+		//	The same stage was already searched, with the same keys
+		const Point stageStart = startingPoints.front();
+		ResultCache::Leg leg;
+
+		if (cache && cache->find(gridKey, stageStart, m_inventory, leg)) {
+			SEARCH_STAT(++m_stats.cachedStages;)
+			startingPoints.pop();
+
+			//	What the cached search read is not known
+			m_stageBounds.push_back(Bounds{ 0, 0, image.height() - 1, image.width() - 1 });
+
+			if (leg.found) {
+				m_paths.push_back(leg.points);
+
+				if (leg.end) {
+					endFound = true;
+				}
+				else {
+					m_inventory.push_back(leg.key);
+					startingPoints.push(leg.points.front());
+				}
+			}
+
+			SEARCH_STAT(m_stats.stageMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - stageBegin).count());)
+			continue;
+		}
 
-		//	Reset the distances
-		cost.assign(imgSize, std::numeric_limits<size_t>::max());
-		cost[startingPoints.front().x() * imgWidth + startingPoints.front().y()] = 0;
+		//	The inventory the stage starts with is the key of its leg
+		const std::vector<Pixel::pxl_t> stageInventory = cache ? m_inventory : std::vector<Pixel::pxl_t>();
 
-		std::priority_queue<qType, std::vector<qType>, Comp> currQueue;
-		currQueue.push(std::make_pair(startingPoints.front(), 0));
-		startingPoints.pop();
+		//	Pixels read by the stage, from the start
+		m_readBounds = Bounds{ stageStart.x(), stageStart.y(), stageStart.x(), stageStart.y() };
 
 		//	Used for Jump Point Search(JPS) Algorithm
 		Point importantJumpPoint{ -1,-1 };
 
-		//	Inner search loop
-		while (!currQueue.empty()) {
-			const auto currPoint = currQueue.top().first;
-			currQueue.pop();
-
-			//	Returns a vector of points to be explored
-			const auto &frontier = successors(currPoint, came_from[currPoint.x() * imgWidth + currPoint.y()], importantJumpPoint);
-			for (const auto &point : frontier) {
+		if (parallel) {
+			const auto result = parallel->run(*this, stageStart, weight);
 
-				size_t newCost = cost[currPoint.x() * imgWidth + currPoint.y()] + manhattanDist(currPoint, point);
+			if (result.interrupted) {
+				m_status = result.status;
+				interrupted = true;
+			}
+			else if (result.found) {
+				importantJumpPoint = result.target;
+				reachTarget(importantJumpPoint);
+				addNewPath(result.source, *parallel);
+			}
 
-				if (newCost < cost[point.x() * imgWidth + point.y()]) {
-					came_from[point.x() * imgWidth + point.y()] = currPoint;
-					cost[point.x() * imgWidth + point.y()] = newCost;
+			startingPoints.pop();
+		}
+		else if (bidirectional && BidirectionalSearch::applies(*this)) {
+			const auto result = bidirectional->run(*this, stageStart, weight);
 
-					size_t priority = newCost + closestKeyCost(point);
-					currQueue.push(std::make_pair(point, priority));
-				}
+			if (result.interrupted) {
+				interrupted = true;
+			}
+			else if (result.found) {
+				importantJumpPoint = result.target;
+				reachTarget(importantJumpPoint);
+				addNewPath(result.source, *bidirectional);
 			}
 
+			startingPoints.pop();
+		}
+		else {
+			//	Clear the information for the parents and the distances from the previous search
+			state.reset(mode, image.width(), image.size());
+			state.set(startingPoints.front(), startingPoints.front(), 0);
+
+			currQueue.clear();
+			currQueue.push_back(std::make_pair(startingPoints.front(), 0));
+			startingPoints.pop();
+
+			Point source{ -1,-1 };
+
+			if (!searchStage(state, currQueue, weight, importantJumpPoint, source)) {
+				interrupted = true;
+			}
 			//	Found a new key or an ending zone
 			//	We stop and 'jump' from that point
-			if (importantJumpPoint != Point{ -1,-1 }) {
+			else if (importantJumpPoint != Point{ -1,-1 }) {
+				reachTarget(importantJumpPoint);
+				addNewPath(source, state);
+			}
+		}
 
-				//	Update the startingPoint
-				if (m_imgData->getImage().pixel(importantJumpPoint) != Pixel::END) {
-					startingPoints.push(importantJumpPoint);
-				}
-				else {
-					endFound = true;
-				}
+		if (interrupted) {
+			break;
+		}
 
-				addNewPath(frontier.back(), came_from);
-				break;
+		//	The neighbours of the read pixels are read too
+		m_stageBounds.push_back(Bounds{ m_readBounds.minX - 1, m_readBounds.minY - 1, m_readBounds.maxX + 1, m_readBounds.maxY + 1 });
+
+		if (cache) {
+			leg.found = importantJumpPoint != Point{ -1,-1 };
+			leg.end = leg.found && endFound;
+
+			if (leg.found) {
+				leg.key = leg.end ? 0 : m_inventory.back();
+				leg.points = m_paths.back();
 			}
+
+			cache->insert(gridKey, stageStart, stageInventory, leg);
 		}
+
+		SEARCH_STAT(m_stats.stageMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - stageBegin).count());)
+	}
+
+	m_stats.findPathMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - searchBegin).count();
+
+	//	An interrupted search cannot be repaired
+	if (interrupted) {
+		m_stageBounds.clear();
+	}
+	else {
+		m_status = endFound ? Status::FOUND : Status::NO_PATH;
 	}
 
 	//	Clear any saved data if there is no solution
@@ -112,7 +417,94 @@ bool PathFinder::findPath() {
 	return endFound;
 }
 
-void PathFinder::drawPath() {
+bool PathFinder::searchStage(SearchState &state, std::vector<QueueEntry> &queue, double weight, Point &importantJumpPoint, Point &source) {
+	using SearchPolicy::Connectivity;
+	using SearchPolicy::StepCost;
+
+	//	The rules are chosen once per stage, the stage runs with all of them known at compile time
+	switch (m_movement.connectivity) {
+	case Connectivity::EIGHT_STRICT:
+		switch (m_movement.cost) {
+		case StepCost::OCTILE:
+			return searchStage<Connectivity::EIGHT_STRICT, StepCost::OCTILE>(state, queue, weight, importantJumpPoint, source);
+		case StepCost::UNIT:
+			return searchStage<Connectivity::EIGHT_STRICT, StepCost::UNIT>(state, queue, weight, importantJumpPoint, source);
+		default:
+			return searchStage<Connectivity::EIGHT_STRICT, StepCost::MANHATTAN>(state, queue, weight, importantJumpPoint, source);
+		}
+	case Connectivity::FOUR:
+		switch (m_movement.cost) {
+		case StepCost::OCTILE:
+			return searchStage<Connectivity::FOUR, StepCost::OCTILE>(state, queue, weight, importantJumpPoint, source);
+		case StepCost::UNIT:
+			return searchStage<Connectivity::FOUR, StepCost::UNIT>(state, queue, weight, importantJumpPoint, source);
+		default:
+			return searchStage<Connectivity::FOUR, StepCost::MANHATTAN>(state, queue, weight, importantJumpPoint, source);
+		}
+	default:
+		switch (m_movement.cost) {
+		case StepCost::OCTILE:
+			return searchStage<Connectivity::EIGHT, StepCost::OCTILE>(state, queue, weight, importantJumpPoint, source);
+		case StepCost::UNIT:
+			return searchStage<Connectivity::EIGHT, StepCost::UNIT>(state, queue, weight, importantJumpPoint, source);
+		default:
+			return searchStage<Connectivity::EIGHT, StepCost::MANHATTAN>(state, queue, weight, importantJumpPoint, source);
+		}
+	}
+}
+
+template <SearchPolicy::Connectivity C, SearchPolicy::StepCost S>
+bool PathFinder::searchStage(SearchState &state, std::vector<QueueEntry> &queue, double weight, Point &importantJumpPoint, Point &source) {
+	//	The priority queue is a binary heap kept with std::push_heap and std::pop_heap
+	const auto comp = [](const QueueEntry &lhs, const QueueEntry &rhs) { return lhs.second > rhs.second; };
+
+	//	Inner search loop
+	while (!queue.empty()) {
+		if (outOfBudget()) {
+			return false;
+		}
+
+		const auto currPoint = queue.front().first;
+		SEARCH_STAT(const size_t currPriority = queue.front().second;)
+
+		std::pop_heap(queue.begin(), queue.end(), comp);
+		queue.pop_back();
+		++m_expanded;
+
+		SEARCH_STAT(++m_stats.heapPops;)
+		SEARCH_STAT(if (currPriority > state.cost(currPoint) + static_cast<size_t>(weight * closestKeyCost<S>(currPoint))) { ++m_stats.stalePops; })
+
+		//	Returns a vector of points to be explored
+		const auto &frontier = successors<C>(currPoint, state.parent(currPoint), importantJumpPoint);
+		for (const auto &point : frontier) {
+
+			size_t newCost = state.cost(currPoint) + SearchPolicy::distance<S>(currPoint, point);
+
+			if (newCost < state.cost(point)) {
+				state.set(point, currPoint, newCost);
+
+				size_t priority = newCost + (weight > 0.0 ? static_cast<size_t>(weight * closestKeyCost<S>(point)) : 0);
+				SEARCH_STAT(++m_stats.keyCostEvaluations; ++m_stats.heapPushes;)
+				SEARCH_STAT(m_stats.allocations += queue.size() == queue.capacity();)
+
+				queue.push_back(std::make_pair(point, priority));
+				std::push_heap(queue.begin(), queue.end(), comp);
+			}
+		}
+
+		//	The stage ends at the first key or ending zone
+		if (importantJumpPoint != Point{ -1,-1 }) {
+			source = frontier.back();
+			return true;
+		}
+	}
+
+	return true;
+}
+
+void PathFinder::drawPath(Point::dim_t thickness) {
+	TRACE_SCOPE("draw");
+
 	if (m_paths.empty() || !m_imgData) {
 		std::cout << "There are no paths to draw!\n";
 		return;
@@ -120,18 +512,73 @@ void PathFinder::drawPath() {
 
 	auto &image = m_imgData->getImage();
 
+	//	The path is drawn on the grid, so its content changes
+	m_gridHashed = false;
+
+	plotPath(thickness, [&](Point::dim_t x, Point::dim_t y) {
+		image.setPixelUnchecked(x, y, Pixel::DRAW);
+	});
+}
+
+void PathFinder::drawPath(PathOverlay &overlay, Point::dim_t thickness) {
+	TRACE_SCOPE("draw");
+
+	if (m_paths.empty() || !m_imgData) {
+		std::cout << "There are no paths to draw!\n";
+		return;
+	}
+
+	plotPath(thickness, [&](Point::dim_t x, Point::dim_t y) {
+		overlay.add(x, y);
+	});
+
+	overlay.finish();
+}
+
+template <typename Plot>
+void PathFinder::plotPath(Point::dim_t thickness, Plot &&plot) const {
+	const auto &image = m_imgData->getImage();
+
+	//	Offsets of the brush around every pixel of the line
+	const Point::dim_t before = (std::max<Point::dim_t>(thickness, 1) - 1) / 2;
+	const Point::dim_t after = std::max<Point::dim_t>(thickness, 1) / 2;
+
+	const auto drawClipped = [&](Point::dim_t x, Point::dim_t y) {
+		for (Point::dim_t i = std::max(x - before, 0); i <= std::min(x + after, image.height() - 1); ++i) {
+			for (Point::dim_t j = std::max(y - before, 0); j <= std::min(y + after, image.width() - 1); ++j) {
+				plot(i, j);
+			}
+		}
+	};
+
+	const auto drawInside = [&](Point::dim_t x, Point::dim_t y) {
+		for (Point::dim_t i = x - before; i <= x + after; ++i) {
+			for (Point::dim_t j = y - before; j <= y + after; ++j) {
+				plot(i, j);
+			}
+		}
+	};
+
 	for (const auto &currPath : m_paths) {
 		for (size_t i = 0; i + 1 < currPath.size(); ++i) {
-			const auto &linePoints = line(currPath[i], currPath[i + 1]);
+			const auto &from = currPath[i];
+			const auto &to = currPath[i + 1];
+
+			//	Fast path: the segment and its brush are inside the image, so nothing has to be clipped
+			const bool inside = std::min(from.x(), to.x()) - before >= 0 && std::max(from.x(), to.x()) + after < image.height() &&
+				std::min(from.y(), to.y()) - before >= 0 && std::max(from.y(), to.y()) + after < image.width();
 
-			for (const auto &point : linePoints) {
-				image.setPixel(point, Pixel::DRAW);
+			if (inside) {
+				LineRasterizer::rasterize(from, to, drawInside);
+			}
+			else {
+				LineRasterizer::rasterize(from, to, drawClipped);
 			}
 		}
 	}
 }
 
-void PathFinder::savePathPoints() {
+void PathFinder::savePathPoints(PathWriter::Format format) {
 	if (!m_imgData) {
 		std::cout << "There is no data from processed image!\n";
 		return;
@@ -143,43 +590,168 @@ void PathFinder::savePathPoints() {
 	}
 
 	ouputFileName.pop_back();
-	ouputFileName.append("_outputPoints.txt");
+	ouputFileName.append("_outputPoints").append(PathWriter::extension(format));
 
-	std::ofstream ofile(ouputFileName);
-	if (!ofile) {
-		std::cout << "The file with path points cannot be generated!\n";
-		return;
-	}
+	PathWriter writer(format);
+	appendPathPoints(writer);
 
-	if (m_paths.empty()) {
-		ofile << "No solution!\n";
+	if (!writer.save(ouputFileName)) {
+		std::cout << "The file with path points cannot be generated!\n";
 	}
-	else {
-		for (const auto &currPath : m_paths) {
-			for (size_t i = currPath.size() - 1; i > 0; --i) {
-				ofile << currPath[i] << "\n";
-			}
-		}
+}
 
-		ofile << m_paths.back().front() << "\n";
+void PathFinder::appendPathPoints(PathWriter &writer) const {
+	if (!m_imgData) {
+		std::cout << "There is no data from processed image!\n";
+		return;
 	}
 
-	ofile.clear();
-	ofile.close();
+	writer.append(m_imgData->getImage().path(), m_paths, m_inventory);
 }
 
 void PathFinder::setImageData(ImageInfo &imageInfo) {
 	m_imgData = &imageInfo;
+	m_gridHashed = false;
+	m_stageBounds.clear();
 
 	m_inventory.clear();
 	m_paths.clear();
 }
 
+void PathFinder::setBudget(const Budget &budget) {
+	m_budget = budget;
+}
+
+PathFinder::Status PathFinder::status() const {
+	return m_status;
+}
+
+const char* PathFinder::statusName(Status status) {
+	switch (status) {
+	case Status::FOUND:
+		return "found";
+	case Status::APPROXIMATE:
+		return "approximate";
+	case Status::BUDGET_EXHAUSTED:
+		return "budget exhausted";
+	case Status::CANCELLED:
+		return "cancelled";
+	default:
+		return "no path";
+	}
+}
+
+void PathFinder::setResultCache(ResultCache *cache) {
+	m_cache = cache;
+}
+
+void PathFinder::setSearchThreads(unsigned threads) {
+	m_searchThreads = threads > 0 ? threads : std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+void PathFinder::setMovement(const SearchPolicy::Movement &movement) {
+	//	The stages of the last path are not valid with other rules, resolve() searches them again
+	if (movement != m_movement) {
+		m_stageBounds.clear();
+	}
+
+	m_movement = movement;
+}
+
+void PathFinder::setBidirectional(bool bidirectional) {
+	m_bidirectional = bidirectional;
+}
+
+void PathFinder::setEngine(SearchPolicy::Engine engine) {
+	m_engine = engine;
+}
+
+void PathFinder::setWorkspace(Workspace *workspace) {
+	m_workspace = workspace;
+}
+
+size_t PathFinder::expandedNodes() const {
+	return m_expanded;
+}
+
+const SearchStats& PathFinder::stats() const {
+	return m_stats;
+}
+
+void PathFinder::Bounds::include(Point::dim_t x, Point::dim_t y) {
+	minX = std::min(minX, x);
+	minY = std::min(minY, y);
+	maxX = std::max(maxX, x);
+	maxY = std::max(maxY, y);
+}
+
+bool PathFinder::Bounds::contains(const Point &point) const {
+	return point.x() >= minX && point.x() <= maxX && point.y() >= minY && point.y() <= maxY;
+}
+
+bool PathFinder::outOfBudget() {
+	if (m_budget.maxExpansions > 0 && m_expanded >= m_budget.maxExpansions) {
+		m_status = Status::BUDGET_EXHAUSTED;
+		return true;
+	}
+
+	//	The flag and the clock are polled every 256 expansions
+	if ((m_expanded & 0xFF) != 0) {
+		return false;
+	}
+
+	if (m_budget.cancel && m_budget.cancel->load(std::memory_order_relaxed)) {
+		m_status = Status::CANCELLED;
+		return true;
+	}
+
+	if (m_budget.deadline != std::chrono::steady_clock::time_point::max() && std::chrono::steady_clock::now() >= m_budget.deadline) {
+		m_status = Status::BUDGET_EXHAUSTED;
+		return true;
+	}
+
+	return false;
+}
+
+size_t PathFinder::pathCost() const {
+	size_t cost = 0;
+
+	for (const auto &currPath : m_paths) {
+		for (size_t i = 0; i + 1 < currPath.size(); ++i) {
+			cost += stepCost(currPath[i], currPath[i + 1]);
+		}
+	}
+
+	return cost;
+}
+
+size_t PathFinder::stepCost(const Point &from, const Point &to) const {
+	return SearchPolicy::distance(m_movement.cost, from, to);
+}
+
+size_t PathFinder::closestKeyCost(const Point &to) const {
+	switch (m_movement.cost) {
+	case SearchPolicy::StepCost::OCTILE:
+		return closestKeyCost<SearchPolicy::StepCost::OCTILE>(to);
+	case SearchPolicy::StepCost::UNIT:
+		return closestKeyCost<SearchPolicy::StepCost::UNIT>(to);
+	default:
+		return closestKeyCost<SearchPolicy::StepCost::MANHATTAN>(to);
+	}
+}
+
+template <SearchPolicy::StepCost S>
 size_t PathFinder::closestKeyCost(const Point &to) const {
 	const auto &keys = m_imgData->getKeys();
 	const auto &ends = m_imgData->getEnds();
 	size_t minDist = UINT32_MAX;
 
+	//	The tighter of the two bounds, the landmarks know the walls
+	const Landmarks *landmarks = m_imgData->landmarks();
+	if (landmarks && landmarks->movement() != m_movement) {
+		landmarks = nullptr;
+	}
+
 	//	Iterate over the keys
 	for (const auto &key : keys) {
 		//	If the key is already in the inventory we do not need it
@@ -188,20 +760,37 @@ size_t PathFinder::closestKeyCost(const Point &to) const {
 		}
 
 		for (const auto &point : key.second) {
-			size_t currDist = manhattanDist(point, to);
+			size_t currDist = SearchPolicy::distance<S>(point, to);
+			if (landmarks) {
+				currDist = std::max(currDist, landmarks->bound(point, to));
+			}
+
 			minDist = std::min(minDist, currDist);
 		}
 	}
 
 	//	Iterate over the ending zones
 	for (const auto &end : ends) {
-		size_t currDist = manhattanDist(end, to);
+		size_t currDist = SearchPolicy::distance<S>(end, to);
+		if (landmarks) {
+			currDist = std::max(currDist, landmarks->bound(end, to));
+		}
+
 		minDist = std::min(minDist, currDist);
 	}
 
 	return minDist;
 }
 
+size_t PathFinder::landmarkCost(const Point &from, const Point &to) const {
+	const Landmarks *landmarks = m_imgData->landmarks();
+	if (!landmarks || landmarks->movement() != m_movement) {
+		return 0;
+	}
+
+	return landmarks->bound(from, to);
+}
+
 bool PathFinder::intersectKey(const Point &point) const {
 	const auto &keys = m_imgData->getKeys();
 	const auto &pxl = m_imgData->getImage().pixel(point);
@@ -212,7 +801,7 @@ bool PathFinder::intersectKey(const Point &point) const {
 	}
 
 	for (const auto &position : iterPxlVal->second) {
-		if (manhattanDist(point, position) <= static_cast<size_t>(ImageInfo::KEY_WIDTH)) {
+		if (manhattanDist(point, position) <= static_cast<size_t>(m_imgData->keyWidth())) {
 			return true;
 		}
 	}
@@ -231,11 +820,11 @@ bool PathFinder::hasKey(const Pixel::pxl_t &pixel) const {
 }
 
 bool PathFinder::walkable(Point::dim_t x, Point::dim_t y) const {
-	return x >= 0 && x < m_imgData->getImage().height() && y >= 0 && y < m_imgData->getImage().width() && m_imgData->getImage().pixel(Point{ x, y }) != Pixel::BLACK;
+	return m_imgData->getImage().passable(x, y);
 }
 
-void PathFinder::addNewPath(const Point &src, const std::vector<Point> &came_from) {
-	size_t width = m_imgData->getImage().width();
+template <typename State>
+void PathFinder::addNewPath(const Point &src, const State &state) {
 	Point tmp{ src };
 
 	if (tmp != m_paths.back().back()) {
@@ -248,8 +837,23 @@ void PathFinder::addNewPath(const Point &src, const std::vector<Point> &came_fro
 	Point::dim_t dx = 0;
 	Point::dim_t dy = 0;
 
-	while (tmp != came_from[tmp.x() * width + tmp.y()]) {
-		tmp = came_from[tmp.x() * width + tmp.y()];
+	//	Direction of the last jump
+	Point::dim_t stepX = 0;
+	Point::dim_t stepY = 0;
+
+	while (tmp != state.parent(tmp)) {
+		const Point parent = state.parent(tmp);
+		const Point::dim_t nextX = (parent.x() > tmp.x()) - (parent.x() < tmp.x());
+		const Point::dim_t nextY = (parent.y() > tmp.y()) - (parent.y() < tmp.y());
+
+		//	A turn is always kept, jumps of equal length would leave it out and the segment would cut the corner
+		if ((nextX != stepX || nextY != stepY) && tmp != m_paths.back().back()) {
+			m_paths.back().push_back(tmp);
+		}
+
+		stepX = nextX;
+		stepY = nextY;
+		tmp = parent;
 
 		dx = tmp.x() - m_paths.back().back().x();
 		dy = tmp.y() - m_paths.back().back().y();
@@ -261,32 +865,58 @@ void PathFinder::addNewPath(const Point &src, const std::vector<Point> &came_fro
 		last_dx = dx;
 		last_dy = dy;
 	}
+
+	//	The start of the stage
+	if (tmp != m_paths.back().back()) {
+		m_paths.back().push_back(tmp);
+	}
 }
 
-const std::vector<Point> PathFinder::neighbours(const Point &point) const {
-	const size_t nSize = 8;
-	const Point::dim_t dir[nSize][2] = { {-1,0}, {-1,-1}, {0,-1}, {1,-1}, {1,0},{1,1}, {0,1},{-1,1} };
+bool PathFinder::blocked(Point::dim_t x, Point::dim_t y) const {
+	if (!walkable(x, y)) {
+		return true;
+	}
 
-	std::vector<Point> result;
+	const auto &image = m_imgData->getImage();
+	const auto cell = image.cell(Point{ x, y });
 
-	for (size_t i = 0; i < nSize; ++i) {
-		Point::dim_t nextX = point.x() + dir[i][0];
-		Point::dim_t nextY = point.y() + dir[i][1];
+	return cell == CellClassifier::Cell::WALL || (cell == CellClassifier::Cell::COLOR && !hasKey(image.pixel(Point{ x, y })));
+}
 
-		if (walkable(nextX, nextY)) {
-			result.push_back(Point{ nextX, nextY });
-		}
+const std::vector<Point>& PathFinder::successors(const Point &curr, const Point &parent, Point &impJumpPoint) {
+	switch (m_movement.connectivity) {
+	case SearchPolicy::Connectivity::EIGHT_STRICT:
+		return successors<SearchPolicy::Connectivity::EIGHT_STRICT>(curr, parent, impJumpPoint);
+	case SearchPolicy::Connectivity::FOUR:
+		return successors<SearchPolicy::Connectivity::FOUR>(curr, parent, impJumpPoint);
+	default:
+		return successors<SearchPolicy::Connectivity::EIGHT>(curr, parent, impJumpPoint);
 	}
-
-	return result;
 }
 
-const std::vector<Point> PathFinder::successors(const Point &curr, const Point &parent, Point &impJumpPoint) {
-	std::vector<Point> successors;
-	std::vector<Point> neigh;
+template <SearchPolicy::Connectivity C>
+const std::vector<Point>& PathFinder::successors(const Point &curr, const Point &parent, Point &impJumpPoint) {
+	using SearchPolicy::Connectivity;
+
+	//	Plain A* and the flood step to the next pixels only
+	if (m_engine != SearchPolicy::Engine::JPS) {
+		return neighbours<C>(curr, impJumpPoint);
+	}
+
+	//	The vectors are kept for the next expansion
+	std::vector<Point> &successors = m_successors;
+	std::vector<Point> &neigh = m_neighbours;
+
+	SEARCH_STAT(const size_t successorsCapacity = successors.capacity(); const size_t neighCapacity = neigh.capacity();)
 
-	Point::dim_t dx = curr.x() - parent.x();
-	Point::dim_t dy = curr.y() - parent.y();
+	successors.clear();
+	neigh.clear();
+
+	const Point::dim_t x = curr.x();
+	const Point::dim_t y = curr.y();
+
+	Point::dim_t dx = x - parent.x();
+	Point::dim_t dy = y - parent.y();
 
 	if (dx != 0) {
 		dx = dx > 0 ? 1 : -1;
@@ -297,97 +927,242 @@ const std::vector<Point> PathFinder::successors(const Point &curr, const Point &
 
 	/* Prune neighbours */
 
-	//	Starting point, there is no direction -> jump in all 8 possible directions
+	//	Starting point, there is no direction -> jump in all possible directions
 	if (dx == 0 && dy == 0) {
-		neigh = neighbours(curr);
+		const Point::dim_t dir[8][2] = { {-1,0}, {-1,-1}, {0,-1}, {1,-1}, {1,0},{1,1}, {0,1},{-1,1} };
+
+		for (const auto &d : dir) {
+			const bool diagonal = d[0] != 0 && d[1] != 0;
+
+			if (C == Connectivity::FOUR && diagonal) {
+				continue;
+			}
+
+			//	A strict diagonal step needs both pixels beside it
+			if (C == Connectivity::EIGHT_STRICT && diagonal && (blocked(x + d[0], y) || blocked(x, y + d[1]))) {
+				continue;
+			}
+
+			if (walkable(x + d[0], y + d[1])) {
+				neigh.push_back(Point{ x + d[0], y + d[1] });
+			}
+		}
 	}
 	//	Diagonal movement
 	else if (dx != 0 && dy != 0) {
-		neigh.push_back(Point{ curr.x() + dx, curr.y() });
-		neigh.push_back(Point{ curr.x(), curr.y() + dy });
-		neigh.push_back(Point{ curr.x() + dx, curr.y() + dy });
+		neigh.push_back(Point{ x + dx, y });
+		neigh.push_back(Point{ x, y + dy });
 
-		//	Check for forced neighbours
-		if (forcedNeigbour(Point{ curr.x() - dx, curr.y() + dy }, Point{ curr.x() - dx, curr.y() })) {
-			neigh.push_back(Point{ curr.x() - dx, curr.y() + dy });
-		}
+		if (C == Connectivity::EIGHT) {
+			neigh.push_back(Point{ x + dx, y + dy });
+
+			//	Check for forced neighbours
+			if (forcedNeigbour(Point{ x - dx, y + dy }, Point{ x - dx, y })) {
+				neigh.push_back(Point{ x - dx, y + dy });
+			}
 
-		if (forcedNeigbour(Point{ curr.x() + dx, curr.y() - dy }, Point{ curr.x(), curr.y() - dy })) {
-			neigh.push_back(Point{ curr.x() + dx, curr.y() - dy });
+			if (forcedNeigbour(Point{ x + dx, y - dy }, Point{ x, y - dy })) {
+				neigh.push_back(Point{ x + dx, y - dy });
+			}
+		}
+		//	The corners cannot be cut, so there are no forced neighbours
+		else if (!blocked(x + dx, y) && !blocked(x, y + dy)) {
+			neigh.push_back(Point{ x + dx, y + dy });
 		}
 	}
 	//	Vertical or horizontal movement
-	else {
-		neigh.push_back(Point{ curr.x() + dx, curr.y() + dy });
+	else if (C == Connectivity::EIGHT) {
+		neigh.push_back(Point{ x + dx, y + dy });
 
 		//	Check for forced neighbours
 		if (dx != 0) {
 			//	Vertical movement
-			if (forcedNeigbour(Point{ curr.x() + dx, curr.y() + 1 }, Point{ curr.x(), curr.y() + 1 })) {
-				neigh.push_back(Point{ curr.x() + dx, curr.y() + 1 });
+			if (forcedNeigbour(Point{ x + dx, y + 1 }, Point{ x, y + 1 })) {
+				neigh.push_back(Point{ x + dx, y + 1 });
 			}
 
-			if (forcedNeigbour(Point{ curr.x() + dx, curr.y() - 1 }, Point{ curr.x(), curr.y() - 1 })) {
-				neigh.push_back(Point{ curr.x() + dx, curr.y() - 1 });
+			if (forcedNeigbour(Point{ x + dx, y - 1 }, Point{ x, y - 1 })) {
+				neigh.push_back(Point{ x + dx, y - 1 });
 			}
 		}
 		else {
 			//	Horizontal movement
-			if (forcedNeigbour(Point{ curr.x() + 1, curr.y() + dy }, Point{ curr.x() + 1, curr.y() })) {
-				neigh.push_back(Point{ curr.x() + 1, curr.y() + dy });
+			if (forcedNeigbour(Point{ x + 1, y + dy }, Point{ x + 1, y })) {
+				neigh.push_back(Point{ x + 1, y + dy });
+			}
+
+			if (forcedNeigbour(Point{ x - 1, y + dy }, Point{ x - 1, y })) {
+				neigh.push_back(Point{ x - 1, y + dy });
+			}
+		}
+	}
+	//	Without cut corners the pixels beside the line are always explored
+	else {
+		//	Unit vector across the movement
+		const Point::dim_t sx = dy != 0 ? 1 : 0;
+		const Point::dim_t sy = dx != 0 ? 1 : 0;
+
+		neigh.push_back(Point{ x + dx, y + dy });
+
+		if (C == Connectivity::EIGHT_STRICT && !blocked(x + dx, y + dy)) {
+			if (!blocked(x + sx, y + sy)) {
+				neigh.push_back(Point{ x + dx + sx, y + dy + sy });
 			}
 
-			if (forcedNeigbour(Point{ curr.x() - 1, curr.y() + dy }, Point{ curr.x() - 1, curr.y() })) {
-				neigh.push_back(Point{ curr.x() - 1, curr.y() + dy });
+			if (!blocked(x - sx, y - sy)) {
+				neigh.push_back(Point{ x + dx - sx, y + dy - sy });
 			}
 		}
+
+		neigh.push_back(Point{ x + sx, y + sy });
+		neigh.push_back(Point{ x - sx, y - sy });
 	}
 
 	//	Iterate over all directions in which we have to 'jump'
 	for (size_t i = 0; i < neigh.size() && impJumpPoint.x() == -1 && impJumpPoint.y() == -1; ++i) {
-		const auto &jumpPoint = jump(curr, neigh[i], impJumpPoint);
+		const auto &jumpPoint = jump<C>(curr, neigh[i], impJumpPoint);
 
 		if (jumpPoint.x() != -1 && jumpPoint.y() != -1) {
 			successors.push_back(jumpPoint);
 		}
 	}
 
+	SEARCH_STAT(m_stats.allocations += (successors.capacity() != successorsCapacity) + (neigh.capacity() != neighCapacity);)
+
+	return successors;
+}
+
+template <SearchPolicy::Connectivity C>
+const std::vector<Point>& PathFinder::neighbours(const Point &curr, Point &impJumpPoint) {
+	using SearchPolicy::Connectivity;
+
+	std::vector<Point> &successors = m_successors;
+	SEARCH_STAT(const size_t successorsCapacity = successors.capacity();)
+
+	successors.clear();
+
+	const auto &image = m_imgData->getImage();
+	const Point::dim_t x = curr.x();
+	const Point::dim_t y = curr.y();
+	const auto currPixel = image.pixel(curr);
+
+	const Point::dim_t dir[8][2] = { {-1,0}, {-1,-1}, {0,-1}, {1,-1}, {1,0},{1,1}, {0,1},{-1,1} };
+
+	for (const auto &d : dir) {
+		const bool diagonal = d[0] != 0 && d[1] != 0;
+
+		if (C == Connectivity::FOUR && diagonal) {
+			continue;
+		}
+
+		const Point::dim_t nx = x + d[0];
+		const Point::dim_t ny = y + d[1];
+
+		m_readBounds.include(nx, ny);
+		SEARCH_STAT(++m_stats.pixelsScanned;)
+
+		if (!walkable(nx, ny)) {
+			continue;
+		}
+
+		//	A strict diagonal step needs both pixels beside it
+		if (C == Connectivity::EIGHT_STRICT && diagonal && (blocked(nx, y) || blocked(x, ny))) {
+			continue;
+		}
+
+		const auto pixel = image.pixel(Point{ nx, ny });
+		const auto cell = image.cell(Point{ nx, ny });
+
+		//	Keys, locked doors and ending zones as in jump(), a target is the last successor
+		if (cell == CellClassifier::Cell::COLOR && pixel != currPixel && !hasKey(pixel)) {
+			if (intersectKey(Point{ nx, ny })) {
+				impJumpPoint = Point{ nx, ny };
+				successors.push_back(impJumpPoint);
+				break;
+			}
+
+			continue;
+		}
+		else if (cell == CellClassifier::Cell::END && !m_passEnds) {
+			impJumpPoint = Point{ nx, ny };
+			successors.push_back(impJumpPoint);
+			break;
+		}
+
+		successors.push_back(Point{ nx, ny });
+	}
+
+	SEARCH_STAT(m_stats.allocations += successors.capacity() != successorsCapacity;)
+
 	return successors;
 }
 
+template <SearchPolicy::Connectivity C>
 const Point PathFinder::jump(const Point &curr, const Point &next, Point &impJumpPoint) {
-	Point::dim_t currX = curr.x();
-	Point::dim_t currY = curr.y();
+	//	Every direction has its own scan, without branches on the direction
+	switch ((next.x() - curr.x() + 1) * 3 + next.y() - curr.y() + 1) {
+	case 0:
+		return jump<C, -1, -1>(curr.x(), curr.y(), impJumpPoint);
+	case 1:
+		return jump<C, -1, 0>(curr.x(), curr.y(), impJumpPoint);
+	case 2:
+		return jump<C, -1, 1>(curr.x(), curr.y(), impJumpPoint);
+	case 3:
+		return jump<C, 0, -1>(curr.x(), curr.y(), impJumpPoint);
+	case 5:
+		return jump<C, 0, 1>(curr.x(), curr.y(), impJumpPoint);
+	case 6:
+		return jump<C, 1, -1>(curr.x(), curr.y(), impJumpPoint);
+	case 7:
+		return jump<C, 1, 0>(curr.x(), curr.y(), impJumpPoint);
+	case 8:
+		return jump<C, 1, 1>(curr.x(), curr.y(), impJumpPoint);
+	default:
+		return Point{ -1,-1 };
+	}
+}
+
+template <SearchPolicy::Connectivity C, Point::dim_t DX, Point::dim_t DY>
+const Point PathFinder::jump(Point::dim_t currX, Point::dim_t currY, Point &impJumpPoint) {
+	using SearchPolicy::Connectivity;
 
-	Point::dim_t x = next.x();
-	Point::dim_t y = next.y();
+	Point::dim_t x = currX + DX;
+	Point::dim_t y = currY + DY;
 
 	//Keep the value of the last pixel
 	auto lastPixel = m_imgData->getImage().pixel(Point{ currX, currY });
 
+	//	The scan reads a line from *curr* to the pixel checked last, and the neighbours of
+	//	its pixels(they are covered by the bounds of the stage)
+	struct ReadScan {
+		Bounds &bounds;
+		const Point::dim_t &x;
+		const Point::dim_t &y;
+		~ReadScan() { bounds.include(x, y); }
+	} readScan{ m_readBounds, x, y };
+
+	m_readBounds.include(currX, currY);
+
+	SEARCH_STAT(++m_stats.jumpCalls;)
+
 	while (true) {
-		Point::dim_t dx = x - currX;
-		Point::dim_t dy = y - currY;
+		SEARCH_STAT(++m_stats.pixelsScanned;)
 
 		if (!walkable(x, y)) {
 			return Point{ -1,-1 };
 		}
 
 		auto currPixel = m_imgData->getImage().pixel(Point{ x, y });
+		auto currCell = m_imgData->getImage().cell(Point{ x, y });
 
 		//	Colored zone
-		if (ImageInfo::color(currPixel) && currPixel != lastPixel) {
+		if (currCell == CellClassifier::Cell::COLOR && currPixel != lastPixel) {
 			bool canUnlock = hasKey(currPixel);
 			bool key = !canUnlock && intersectKey(Point{ x, y });
 
-			//	Collect the key
+			//	Collect the key(the search adds it to the inventory)
 			if (key) {
-				m_inventory.push_back(currPixel);
 				impJumpPoint = Point{ x, y };
-
-				m_paths.push_back(std::vector<Point>());
-				m_paths.back().push_back(impJumpPoint);
-
 				return Point{ x, y };
 			}
 			//	Not walkable because there is no such key in the inventory
@@ -396,68 +1171,109 @@ const Point PathFinder::jump(const Point &curr, const Point &next, Point &impJum
 			}
 		}
 		//	Check for ending zone
-		else if (currPixel == Pixel::END) {
+		else if (currCell == CellClassifier::Cell::END) {
 			impJumpPoint = Point{ x, y };
-
-			m_paths.push_back(std::vector<Point>());
-			m_paths.back().push_back(Point{ x, y });
-
 			return Point{ x, y };
 		}
 
 		//	Diagonal movement
-		if (dx != 0 && dy != 0) {
+		if (DX != 0 && DY != 0) {
 			//	Forced neighbours
-			if (forcedNeigbour(Point{ x - dx, y + dy }, Point{ x - dx, y }) ||
-				forcedNeigbour(Point{ x + dx, y - dy }, Point{ x, y - dy })) {
+			if (C == Connectivity::EIGHT &&
+				(forcedNeigbour(Point{ x - DX, y + DY }, Point{ x - DX, y }) ||
+				forcedNeigbour(Point{ x + DX, y - DY }, Point{ x, y - DY }))) {
 
 				return Point{ x, y };
 			}
 
 			//	Vertical and horizontal jumps
-			if (jump(Point{ x, y }, Point(x + dx, y), impJumpPoint) != Point{ -1,-1 } ||
-				jump(Point{ x, y }, Point(x, y + dy), impJumpPoint) != Point{ -1,-1 }) {
+			if (jump<C, DX, 0>(x, y, impJumpPoint) != Point{ -1,-1 } ||
+				jump<C, 0, DY>(x, y, impJumpPoint) != Point{ -1,-1 }) {
 
 				return Point{ x, y };
 			}
+
+			//	The next diagonal step would cut a corner
+			if (C == Connectivity::EIGHT_STRICT && (blocked(x + DX, y) || blocked(x, y + DY))) {
+				return Point{ -1,-1 };
+			}
 		}
-		//	Vertical and horizontal movement
-		else {
-			//	Forced neighbours check
-			if (dx != 0) {
-				//	Vertical movement
-				if (forcedNeigbour(Point{ x + dx, y + 1 }, Point{ x, y + 1 }) ||
-					forcedNeigbour(Point{ x + dx, y - 1 }, Point{ x, y - 1 })) {
+		//	Vertical movement
+		else if (DX != 0) {
+			if (C == Connectivity::EIGHT) {
+				if (forcedNeigbour(Point{ x + DX, y + 1 }, Point{ x, y + 1 }) ||
+					forcedNeigbour(Point{ x + DX, y - 1 }, Point{ x, y - 1 })) {
 
 					return Point{ x, y };
 				}
 			}
-			else {
-				//	Horizontal movement
-				if (forcedNeigbour(Point{ x + 1, y + dy }, Point{ x + 1, y }) ||
-					forcedNeigbour(Point{ x - 1, y + dy }, Point{ x - 1, y })) {
+			//	A free pixel beside the line after a blocked one
+			else if (forcedNeigbour(Point{ x, y + 1 }, Point{ x - DX, y + 1 }) ||
+				forcedNeigbour(Point{ x, y - 1 }, Point{ x - DX, y - 1 })) {
+
+				return Point{ x, y };
+			}
+
+			//	Without diagonal steps the horizontal jumps are checked from every pixel
+			if (C == Connectivity::FOUR &&
+				(jump<C, 0, 1>(x, y, impJumpPoint) != Point{ -1,-1 } ||
+				jump<C, 0, -1>(x, y, impJumpPoint) != Point{ -1,-1 })) {
+
+				return Point{ x, y };
+			}
+		}
+		//	Horizontal movement
+		else {
+			if (C == Connectivity::EIGHT) {
+				if (forcedNeigbour(Point{ x + 1, y + DY }, Point{ x + 1, y }) ||
+					forcedNeigbour(Point{ x - 1, y + DY }, Point{ x - 1, y })) {
 
 					return Point{ x, y };
 				}
 			}
+			else if (forcedNeigbour(Point{ x + 1, y }, Point{ x + 1, y - DY }) ||
+				forcedNeigbour(Point{ x - 1, y }, Point{ x - 1, y - DY })) {
+
+				return Point{ x, y };
+			}
+		}
+
+		//	Horizontal movement over run-length encoded rows: while the pixel stays in the same run
+		//	of row x and the pixels y and y + dy stay in the same runs of rows x - 1 and x + 1,
+		//	every check above gives the same result as for the current pixel, so skip them
+		if (DX == 0 && m_imgData->getImage().layout() == Image::Layout::RLE) {
+			const auto &image = m_imgData->getImage();
+			Point::dim_t skip = image.runLength(x, y, DY);
+
+			if (x > 0) {
+				skip = std::min(skip, image.runLength(x - 1, y, DY) - 1);
+			}
+
+			if (x + 1 < image.height()) {
+				skip = std::min(skip, image.runLength(x + 1, y, DY) - 1);
+			}
+
+			if (skip > 0) {
+				y += skip * DY;
+				SEARCH_STAT(m_stats.pixelsScanned += skip;)
+			}
 		}
 
 		//	Update the value of the previous pixel
 		lastPixel = currPixel;
 
-		currX = x;
-		currY = y;
-
-		x += dx;
-		y += dy;
+		x += DX;
+		y += DY;
 	}
 }
 
 bool PathFinder::forcedNeigbour(const Point &walk, const Point &neighbour) const {
 	if (walkable(walk.x(), walk.y())) {
-		const auto &neighbourPixel = m_imgData->getImage().pixel(neighbour);
+		const auto neighbourCell = m_imgData->getImage().cell(neighbour);
 
-		if (neighbourPixel == Pixel::BLACK || ImageInfo::color(neighbourPixel) && !hasKey(neighbourPixel)) {
+		if (neighbourCell == CellClassifier::Cell::WALL ||
+			(neighbourCell == CellClassifier::Cell::COLOR && !hasKey(m_imgData->getImage().pixel(neighbour)))) {
+			SEARCH_STAT(++m_stats.forcedNeighbours;)
 			return true;
 		}
 	}
@@ -468,37 +1284,3 @@ bool PathFinder::forcedNeigbour(const Point &walk, const Point &neighbour) const
 size_t PathFinder::manhattanDist(const Point &a, const Point &b) {
 	return std::abs(a.x() - b.x()) + std::abs(a.y() - b.y());
 }
-
-float PathFinder::linearInterpolation(Point::dim_t start, Point::dim_t end, float t) {
-	return static_cast<float>(start) + t * (end - start);
-}
-
-const Point PathFinder::linInterpPoint(const Point &from, const Point &to, float t) {
-	return roundPoint(linearInterpolation(from.x(), to.x(), t), linearInterpolation(from.y(), to.y(), t));
-}
-
-Point::dim_t PathFinder::diagonalDistance(const Point &a, const Point &b) {
-	return std::max(std::abs(a.x() - b.x()), std::abs(a.y() - b.y()));
-}
-
-const Point PathFinder::roundPoint(float x, float y) {
-	return Point{ static_cast<Point::dim_t>(std::round(x)), static_cast<Point::dim_t>(std::round(y)) };
-}
-
-const std::vector<Point> PathFinder::line(const Point &from, const Point &to) {
-	Point::dim_t diagDistance = diagonalDistance(from, to);
-	
-	std::vector<Point> points;
-	points.reserve(diagDistance + 1);
-
-	for (Point::dim_t step = 0; step <= diagDistance; ++step) {
-		float t = 0.0f;
-		if (diagDistance > 0) {
-			t = step / static_cast<float>(diagDistance);
-		}
-
-		points.push_back(linInterpPoint(from, to, t));
-	}
-
-	return points;
-}
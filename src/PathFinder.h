@@ -2,10 +2,48 @@
 #ifndef PATH_FINDER_CLASS_HEADER
 #define PATH_FINDER_CLASS_HEADER
 
+#include <atomic>
+#include <chrono>
 #include <vector>
 #include "ImageInfo.h"
+#include "PathOverlay.h"
+#include "PathWriter.h"
+#include "ResultCache.h"
+#include "SearchPolicy.h"
+#include "SearchState.h"
+#include "SearchStats.h"
+
+class BidirectionalSearch;
+class CoarseGrid;
+class ParallelSearch;
+class Workspace;
 
 class PathFinder {
+	//	Expand the points of a stage with the jumps of the finder
+	friend class BidirectionalSearch;
+	friend class ParallelSearch;
+
+public:
+	//	Outcome of the last findPath() or resolve()
+	enum class Status {
+		FOUND,				//	The search finished and found a path
+		APPROXIMATE,		//	The budget ended during the refinement, the path is the best one found before
+		NO_PATH,			//	The search finished without a path
+		BUDGET_EXHAUSTED,	//	The budget ended before any path was found
+		CANCELLED			//	The cancel flag was set, the best path found before is kept(if any)
+	};
+
+	//	Limits of findPath() and resolve(), the default one has no limits
+	struct Budget {
+		std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+		size_t maxExpansions = 0;					//	Points taken from the priority queues, 0 means no limit
+		const std::atomic<bool> *cancel = nullptr;	//	Set by another thread to stop the search
+		//	Weight of the heuristic of the first pass of findPath(). Above 1 the first path is found
+		//	sooner(weighted A*) and the next passes lower the weight until a pass with weight 1,
+		//	keeping the cheapest path. resolve() always searches with weight 1
+		double weight = 1.0;
+	};
+
 public:
 	PathFinder();
 	PathFinder(ImageInfo &imageInfo);
@@ -14,38 +52,167 @@ public:
 	~PathFinder() = default;
 
 public:
+	//	Returns *true* if there is a path, see status() for its quality
 	bool findPath();
-	void drawPath();
-	void savePathPoints();
+
+	//	Applies *edits* to the maze(see ImageInfo::applyEdits()) and repairs the path of the last
+	//	findPath() or resolve(). Every stage remembers the rectangle of pixels its search read, so the
+	//	stages before the first one that read a changed pixel are kept and the search goes on from
+	//	there. Changes of the keys, the ending zones or the start change the heuristic, so the whole
+	//	path is searched again. Returns *true* if there is a path, like findPath()
+	bool resolve(const std::vector<ImageInfo::PixelEdit> &edits);
+	//	Draws every segment of the path with a square brush of side *thickness*,
+	//	the pixels outside the image are clipped
+	void drawPath(Point::dim_t thickness = 1);
+	//	Same as drawPath() but the pixels are collected in *overlay* and the image is not modified
+	void drawPath(PathOverlay &overlay, Point::dim_t thickness = 1);
+	//	Writes the path next to the image, to image_outputPoints with the extension of the format
+	void savePathPoints(PathWriter::Format format = PathWriter::Format::TEXT);
+	//	Appends the path to *writer*, for files that keep the paths of several mazes
+	void appendPathPoints(PathWriter &writer) const;
 
 	// Updates the pointer to the object of type 'ImageInfo'
 	void setImageData(ImageInfo &imageInfo);
 
+	//	The deadline, the expansions and the cancel flag are checked while the stages are searched,
+	//	the flag and the clock every 256 expansions
+	void setBudget(const Budget &budget);
+	Status status() const;
+	static const char* statusName(Status status);
+
+	//	Stages of findPath() are taken from and added to *cache*, nullptr disables caching.
+	//	The cache is not owned and may be shared by several finders
+	void setResultCache(ResultCache *cache);
+
+	//	Every stage is searched by *threads* threads(hash distributed A*), 0 uses every hardware
+	//	thread and 1 keeps the single threaded search. Equal paths may be found instead of the
+	//	ones of the single threaded search
+	void setSearchThreads(unsigned threads);
+
+	//	Connectivity and cost of the steps, the default is 8 directions with the Manhattan cost
+	void setMovement(const SearchPolicy::Movement &movement);
+
+	//	The last stage(every key is collected) is searched from both ends, see BidirectionalSearch.
+	//	It keeps two more arrays as large as the image for every side
+	void setBidirectional(bool bidirectional);
+
+	//	How the successors of a pixel are found, the default is jump point search. Every stage ends at
+	//	the first key or ending zone reached, which may differ between the engines, so the cost of the
+	//	path may differ a little too. The flood has no
+	//	heuristic, so the anytime weight and the landmarks are not used
+	void setEngine(SearchPolicy::Engine engine);
+
+	//	The searches keep their arrays, queue and threads in *workspace* instead of allocating
+	//	them for every search, nullptr allocates them. The workspace is not owned
+	void setWorkspace(Workspace *workspace);
+
+	//	Number of points taken from the priority queues by the last findPath()
+	size_t expandedNodes() const;
+
+	//	Counters and times of the last findPath()
+	const SearchStats& stats() const;
+
+private:
+	//	Rectangle of pixels, inclusive
+	struct Bounds {
+		Point::dim_t minX;
+		Point::dim_t minY;
+		Point::dim_t maxX;
+		Point::dim_t maxY;
+
+		void include(Point::dim_t x, Point::dim_t y);
+		bool contains(const Point &point) const;
+	};
+
 private:
+	//	Searches the stages after the ones kept in m_paths with the heuristic multiplied by *weight*.
+	//	Sets m_status, unless the search finished and found a path
+	bool search(double weight);
+
+	//	Searches the maze of the cells of *grid* and maps the path to the pixels of the image
+	bool findCoarsePath(CoarseGrid &grid);
+
+	//	Returns *true* and sets m_status if the budget ended or the search was cancelled
+	bool outOfBudget();
+
+	//	Length of the path in m_paths, as counted by the search
+	size_t pathCost() const;
+
+	//	Point and priority in the priority queue of a stage
+	using QueueEntry = std::pair<Point, size_t>;
+
+	//	Searches a stage from the points in *queue* until a key or an ending zone is reached, with
+	//	the rules of m_movement. *source* gets the successor whose jump reached it. Returns *false*
+	//	if the budget ended
+	bool searchStage(SearchState &state, std::vector<QueueEntry> &queue, double weight, Point &importantJumpPoint, Point &source);
+	template <SearchPolicy::Connectivity C, SearchPolicy::StepCost S>
+	bool searchStage(SearchState &state, std::vector<QueueEntry> &queue, double weight, Point &importantJumpPoint, Point &source);
+
+	//	Cost of a straight or diagonal segment with the rules of m_movement
+	size_t stepCost(const Point &from, const Point &to) const;
+
+	size_t closestKeyCost(const Point &to) const;
+	template <SearchPolicy::StepCost S>
 	size_t closestKeyCost(const Point &to) const;
+
+	//	Lower bound of the landmarks of the maze, 0 if there are none for m_movement
+	size_t landmarkCost(const Point &from, const Point &to) const;
+
 	bool intersectKey(const Point &point) const;
 	bool hasKey(const Pixel::pxl_t &pixel) const;
 	bool walkable(Point::dim_t x, Point::dim_t y) const;
-	void addNewPath(const Point &src, const std::vector<Point> &came_from);
+	//	Returns *true* for walls, locked doors and pixels outside the image
+	bool blocked(Point::dim_t x, Point::dim_t y) const;
+
+	//	Adds the path from *src* to the start of the stage, with the parents of *state*
+	template <typename State>
+	void addNewPath(const Point &src, const State &state);
+
+	//	The result is valid until the next call
+	const std::vector<Point>& successors(const Point &curr, const Point &parent, Point &impJumpPoint);
+	template <SearchPolicy::Connectivity C>
+	const std::vector<Point>& successors(const Point &curr, const Point &parent, Point &impJumpPoint);
 
-	const std::vector<Point> neighbours(const Point &point) const;
-	const std::vector<Point> successors(const Point &curr, const Point &parent, Point &impJumpPoint);
+	//	The pixels next to *curr* for the engines without jumps, with the same rules as jump()
+	template <SearchPolicy::Connectivity C>
+	const std::vector<Point>& neighbours(const Point &curr, Point &impJumpPoint);
+
+	//	Scans from *curr* through *next*, with the scan of its direction
+	template <SearchPolicy::Connectivity C>
 	const Point jump(const Point &curr, const Point &next, Point &impJumpPoint);
+	//	Scans from (currX, currY) in the direction (DX, DY) until a jump point
+	template <SearchPolicy::Connectivity C, Point::dim_t DX, Point::dim_t DY>
+	const Point jump(Point::dim_t currX, Point::dim_t currY, Point &impJumpPoint);
+
+	//	Calls plot(x, y) for every pixel drawPath() covers, a pixel may be visited more than once
+	template <typename Plot>
+	void plotPath(Point::dim_t thickness, Plot &&plot) const;
 
 	bool forcedNeigbour(const Point &walk, const Point &neighbour) const;
 	static size_t manhattanDist(const Point &a, const Point &b);
 
-	//	Methods related to line drawing
-	static float linearInterpolation(Point::dim_t start, Point::dim_t end, float t);
-	static const Point linInterpPoint(const Point &from, const Point &to, float t);
-	static Point::dim_t diagonalDistance(const Point &a, const Point &b);
-	static const Point roundPoint(float x, float y);
-	static const std::vector<Point> line(const Point &from, const Point &to);
-
 private:
 	ImageInfo *m_imgData;
 	std::vector<Pixel::pxl_t> m_inventory;		//	Inventory of collected keys
 	std::vector<std::vector<Point>> m_paths;	//	Collection of path segments
+	size_t m_expanded;							//	Points expanded by the last search
+	Budget m_budget;
+	Status m_status;
+	std::vector<Bounds> m_stageBounds;			//	Pixels read by every stage of the last search
+	Bounds m_readBounds;						//	Pixels read by the current stage
+	mutable SearchStats m_stats;				//	Also counted by the const helpers
+	ResultCache *m_cache;						//	Cached stages, not owned
+	uint64_t m_gridHash;						//	Content hash of the grid, computed once
+	bool m_gridHashed;
+	unsigned m_searchThreads;					//	Threads of every stage
+	bool m_bidirectional;						//	Search the last stage from both ends
+	SearchPolicy::Movement m_movement;
+	SearchPolicy::Engine m_engine;
+	Workspace *m_workspace;						//	Memory reused by the searches, not owned
+	std::vector<Point> m_successors;			//	Result of successors()
+	std::vector<Point> m_neighbours;			//	Directions of the jumps of successors()
+
+	bool m_passEnds;							//	Steps go through the ending zones instead of stopping
 };
 
 #endif // !PATH_FINDER_CLASS_HEADER
@@ -0,0 +1,35 @@
+#include "PathOverlay.h"
+
+PathOverlay::PathOverlay(Pixel::pxl_t color)
+	: m_color(color) {
+
+}
+
+void PathOverlay::add(Point::dim_t x, Point::dim_t y) {
+	m_keys.push_back(key(x, y));
+}
+
+void PathOverlay::finish() {
+	std::sort(m_keys.begin(), m_keys.end());
+	m_keys.erase(std::unique(m_keys.begin(), m_keys.end()), m_keys.end());
+}
+
+void PathOverlay::clear() {
+	m_keys.clear();
+}
+
+size_t PathOverlay::size() const {
+	return m_keys.size();
+}
+
+bool PathOverlay::empty() const {
+	return m_keys.empty();
+}
+
+Pixel::pxl_t PathOverlay::color() const {
+	return m_color;
+}
+
+uint64_t PathOverlay::key(Point::dim_t x, Point::dim_t y) {
+	return static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32 | static_cast<uint32_t>(y);
+}
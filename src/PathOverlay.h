@@ -0,0 +1,59 @@
+#pragma once
+#ifndef PATH_OVERLAY_CLASS_HEADER
+#define PATH_OVERLAY_CLASS_HEADER
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "Pixel.h"
+#include "Point.h"
+
+//	Sparse set of pixels drawn over an image, grouped by row.
+//
+//	Lets the path be written to the output file while the original rows are streamed from
+//	the source, so the solved image is never modified or copied. Every pixel costs 8 bytes
+class PathOverlay {
+public:
+	explicit PathOverlay(Pixel::pxl_t color = Pixel::DRAW);
+	PathOverlay(const PathOverlay &r) = default;
+	PathOverlay(PathOverlay &&r) = default;
+	PathOverlay& operator=(const PathOverlay &rhs) = default;
+	PathOverlay& operator=(PathOverlay &&rhs) = default;
+	~PathOverlay() = default;
+
+public:
+	//	Adds pixel (x, y), duplicates are removed by finish()
+	void add(Point::dim_t x, Point::dim_t y);
+
+	//	Sorts the pixels by row and column, must be called before they are visited
+	void finish();
+
+	void clear();
+
+	//	Number of pixels, without duplicates after finish()
+	size_t size() const;
+	bool empty() const;
+
+	Pixel::pxl_t color() const;
+
+	//	Calls visit(y) for every pixel of row x, in ascending order of the columns
+	template <typename Visit>
+	void visitRow(Point::dim_t x, Visit &&visit) const {
+		auto it = std::lower_bound(m_keys.begin(), m_keys.end(), key(x, 0));
+
+		for (; it != m_keys.end() && static_cast<Point::dim_t>(*it >> 32) == x; ++it) {
+			visit(static_cast<Point::dim_t>(*it & 0xFFFFFFFFu));
+		}
+	}
+
+private:
+	//	Coordinates are never negative, so the keys sort by row first
+	static uint64_t key(Point::dim_t x, Point::dim_t y);
+
+private:
+	std::vector<uint64_t> m_keys;
+	Pixel::pxl_t m_color;
+};
+
+#endif // !PATH_OVERLAY_CLASS_HEADER
@@ -0,0 +1,253 @@
+#include <fstream>
+#include "PathWriter.h"
+
+PathWriter::PathWriter(Format format, bool batch)
+	: m_count(0)
+	, m_format(format)
+	, m_batch(batch) {
+
+	//	Header of the binary format, the other formats get theirs in save()
+	if (m_format == Format::BINARY) {
+		m_buffer.append("MZP\x01", 4);
+	}
+}
+
+void PathWriter::append(const std::string &image, const std::vector<std::vector<Point>> &paths, const std::vector<Pixel::pxl_t> &keys) {
+	switch (m_format) {
+	case Format::TEXT:
+		appendText(image, paths);
+		break;
+	case Format::BINARY:
+		appendBinary(image, paths, keys);
+		break;
+	case Format::JSON:
+		appendJson(image, paths, keys);
+		break;
+	}
+
+	++m_count;
+}
+
+void PathWriter::append(const PathWriter &other) {
+	switch (m_format) {
+	case Format::BINARY:
+		//	Without the header of *other*
+		m_buffer.append(other.m_buffer, 4, std::string::npos);
+		break;
+	case Format::JSON:
+		//	The first maze of *other* has no separator
+		if (m_count > 0 && other.m_count > 0) {
+			m_buffer.push_back(',');
+		}
+
+		m_buffer.append(other.m_buffer);
+		break;
+	default:
+		m_buffer.append(other.m_buffer);
+		break;
+	}
+
+	m_count += other.m_count;
+}
+
+bool PathWriter::save(const std::string &path) const {
+	std::ofstream ofile(path, std::ios::binary | std::ios::trunc);
+	if (!ofile) {
+		return false;
+	}
+
+	if (m_format == Format::JSON && m_batch) {
+		ofile << "{\"solutions\": [";
+		ofile.write(m_buffer.data(), m_buffer.size());
+		ofile << "\n]}\n";
+	}
+	else {
+		ofile.write(m_buffer.data(), m_buffer.size());
+	}
+
+	return ofile.good();
+}
+
+void PathWriter::clear() {
+	m_buffer.clear();
+	m_count = 0;
+
+	if (m_format == Format::BINARY) {
+		m_buffer.append("MZP\x01", 4);
+	}
+}
+
+PathWriter::Format PathWriter::format() const {
+	return m_format;
+}
+
+size_t PathWriter::count() const {
+	return m_count;
+}
+
+const char* PathWriter::extension(Format format) {
+	switch (format) {
+	case Format::BINARY:
+		return ".bin";
+	case Format::JSON:
+		return ".json";
+	default:
+		return ".txt";
+	}
+}
+
+void PathWriter::appendText(const std::string &image, const std::vector<std::vector<Point>> &paths) {
+	if (m_batch) {
+		m_buffer.append("# ").append(image).push_back('\n');
+	}
+
+	if (paths.empty()) {
+		m_buffer.append("No solution!\n");
+		return;
+	}
+
+	//	The first point of every segment is the last point of the previous one
+	const auto appendPoint = [this](const Point &point) {
+		appendNumber(point.x());
+		m_buffer.push_back(' ');
+		appendNumber(point.y());
+		m_buffer.push_back('\n');
+	};
+
+	for (const auto &currPath : paths) {
+		for (size_t i = currPath.size() - 1; i > 0; --i) {
+			appendPoint(currPath[i]);
+		}
+	}
+
+	appendPoint(paths.back().front());
+}
+
+void PathWriter::appendBinary(const std::string &image, const std::vector<std::vector<Point>> &paths, const std::vector<Pixel::pxl_t> &keys) {
+	appendVarint(image.size());
+	m_buffer.append(image);
+	appendVarint(paths.size());
+
+	//	Maps small signed deltas to small unsigned numbers
+	const auto zigzag = [](int64_t value) {
+		return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+	};
+
+	Point::dim_t lastX = 0;
+	Point::dim_t lastY = 0;
+
+	for (size_t segment = 0; segment < paths.size(); ++segment) {
+		const auto &currPath = paths[segment];
+
+		appendVarint(currPath.size());
+		appendVarint(segment < keys.size() && segment + 1 < paths.size() ? static_cast<uint64_t>(keys[segment]) + 1 : 0);
+
+		for (size_t i = currPath.size(); i > 0; --i) {
+			const Point &point = currPath[i - 1];
+
+			appendVarint(zigzag(static_cast<int64_t>(point.x()) - lastX));
+			appendVarint(zigzag(static_cast<int64_t>(point.y()) - lastY));
+
+			lastX = point.x();
+			lastY = point.y();
+		}
+	}
+}
+
+void PathWriter::appendJson(const std::string &image, const std::vector<std::vector<Point>> &paths, const std::vector<Pixel::pxl_t> &keys) {
+	if (m_batch) {
+		m_buffer.append(m_count > 0 ? ",\n" : "\n");
+	}
+
+	m_buffer.append("{\"image\": ");
+	appendJsonString(image);
+	m_buffer.append(", \"solved\": ").append(paths.empty() ? "false" : "true");
+	m_buffer.append(", \"segments\": [");
+
+	for (size_t segment = 0; segment < paths.size(); ++segment) {
+		const auto &currPath = paths[segment];
+		m_buffer.append(segment > 0 ? ",\n\t{\"target\": " : "\n\t{\"target\": ");
+
+		//	Every segment but the last one ends at a key
+		if (segment < keys.size() && segment + 1 < paths.size()) {
+			static const char digits[] = "0123456789abcdef";
+			char color[] = "\"#000000\"";
+
+			for (int i = 0; i < 6; ++i) {
+				color[7 - i] = digits[(keys[segment] >> (4 * i)) & 0xF];
+			}
+
+			m_buffer.append(color);
+		}
+		else {
+			m_buffer.append("\"end\"");
+		}
+
+		m_buffer.append(", \"points\": [");
+
+		for (size_t i = currPath.size(); i > 0; --i) {
+			m_buffer.append(i < currPath.size() ? ", [" : "[");
+			appendNumber(currPath[i - 1].x());
+			m_buffer.append(", ");
+			appendNumber(currPath[i - 1].y());
+			m_buffer.push_back(']');
+		}
+
+		m_buffer.append("]}");
+	}
+
+	m_buffer.append(paths.empty() ? "]}" : "\n]}");
+
+	if (!m_batch) {
+		m_buffer.push_back('\n');
+	}
+}
+
+void PathWriter::appendNumber(int64_t value) {
+	char digits[24];
+	char *end = digits + sizeof(digits);
+	char *begin = end;
+
+	uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+	do {
+		*--begin = static_cast<char>('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude > 0);
+
+	if (value < 0) {
+		*--begin = '-';
+	}
+
+	m_buffer.append(begin, end);
+}
+
+void PathWriter::appendVarint(uint64_t value) {
+	while (value >= 0x80) {
+		m_buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+		value >>= 7;
+	}
+
+	m_buffer.push_back(static_cast<char>(value));
+}
+
+void PathWriter::appendJsonString(const std::string &value) {
+	m_buffer.push_back('"');
+
+	for (const char c : value) {
+		if (c == '"' || c == '\\') {
+			m_buffer.push_back('\\');
+			m_buffer.push_back(c);
+		}
+		else if (static_cast<unsigned char>(c) < 0x20) {
+			static const char digits[] = "0123456789abcdef";
+			m_buffer.append("\\u00");
+			m_buffer.push_back(digits[(c >> 4) & 0xF]);
+			m_buffer.push_back(digits[c & 0xF]);
+		}
+		else {
+			m_buffer.push_back(c);
+		}
+	}
+
+	m_buffer.push_back('"');
+}
@@ -0,0 +1,79 @@
+#pragma once
+#ifndef PATH_WRITER_CLASS_HEADER
+#define PATH_WRITER_CLASS_HEADER
+
+#include <string>
+#include <vector>
+
+#include "Pixel.h"
+#include "Point.h"
+
+//	Encodes solved paths into a single buffer, which is written with one call.
+//
+//	Formats:
+//	*	TEXT - "x y" per line from the start to the end, "No solution!" if there is no path.
+//		Files with several mazes have a "# image" line before every maze;
+//	*	BINARY - "MZP" and a version byte, then for every maze: varint length of the image path,
+//		the path, varint number of segments(0 if there is no solution) and for every segment:
+//		varint number of points, varint target(0 for the end zone, key color + 1 for a key) and
+//		the points as zigzag varint deltas of x and y from the previous point(0, 0 at the start
+//		of every maze). Varints are little endian base 128;
+//	*	JSON - an object per maze with the image path and the segments, every segment has its
+//		target(the key color or "end") and its points. Files with several mazes keep them in
+//		"solutions".
+//
+//	A segment goes from the start(or the previous key) to the next key or the end zone, so the
+//	first point of a segment is the last point of the previous one
+class PathWriter {
+public:
+	enum class Format {
+		TEXT,
+		BINARY,
+		JSON
+	};
+
+public:
+	//	*batch* writers can hold any number of mazes and name every one of them
+	explicit PathWriter(Format format = Format::TEXT, bool batch = false);
+	PathWriter(const PathWriter &r) = default;
+	PathWriter& operator=(const PathWriter &rhs) = default;
+	~PathWriter() = default;
+
+public:
+	//	Appends the path of a maze. *paths* are the segments as kept by the PathFinder(from the
+	//	target back to the start, in the order they are walked) and *keys* the color of every key
+	//	in the same order. Empty *paths* mean there is no solution
+	void append(const std::string &image, const std::vector<std::vector<Point>> &paths, const std::vector<Pixel::pxl_t> &keys);
+	//	Appends the mazes of *other*, a batch writer of the same format
+	void append(const PathWriter &other);
+
+	//	Writes everything appended so far. Returns *false* if the file cannot be written
+	bool save(const std::string &path) const;
+
+	void clear();
+
+	Format format() const;
+
+	//	Number of appended mazes
+	size_t count() const;
+
+	//	Extension of the files in the given format, with the dot
+	static const char* extension(Format format);
+
+private:
+	void appendText(const std::string &image, const std::vector<std::vector<Point>> &paths);
+	void appendBinary(const std::string &image, const std::vector<std::vector<Point>> &paths, const std::vector<Pixel::pxl_t> &keys);
+	void appendJson(const std::string &image, const std::vector<std::vector<Point>> &paths, const std::vector<Pixel::pxl_t> &keys);
+
+	void appendNumber(int64_t value);
+	void appendVarint(uint64_t value);
+	void appendJsonString(const std::string &value);
+
+private:
+	std::string m_buffer;
+	size_t m_count;
+	Format m_format;
+	bool m_batch;
+};
+
+#endif // !PATH_WRITER_CLASS_HEADER
@@ -0,0 +1,160 @@
+#pragma once
+#ifndef PIPELINE_CLASS_HEADER
+#define PIPELINE_CLASS_HEADER
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//	Queue of at most *capacity* items. push() waits while it is full, which holds back the stage
+//	before it(backpressure), and pop() waits while it is empty and not closed
+template <typename T>
+class BoundedQueue {
+public:
+	explicit BoundedQueue(size_t capacity)
+		: m_capacity(capacity > 0 ? capacity : 1)
+		, m_closed(false) {
+
+	}
+
+	BoundedQueue(const BoundedQueue &r) = delete;
+	BoundedQueue& operator=(const BoundedQueue &rhs) = delete;
+	~BoundedQueue() = default;
+
+public:
+	void push(T item) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_notFull.wait(lock, [this]() { return m_items.size() < m_capacity; });
+
+		m_items.push_back(std::move(item));
+		m_notEmpty.notify_one();
+	}
+
+	//	Returns *false* if the queue is closed and there are no more items
+	bool pop(T &item) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_notEmpty.wait(lock, [this]() { return !m_items.empty() || m_closed; });
+
+		if (m_items.empty()) {
+			return false;
+		}
+
+		item = std::move(m_items.front());
+		m_items.pop_front();
+		m_notFull.notify_one();
+
+		return true;
+	}
+
+	//	No more items will be pushed
+	void close() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_closed = true;
+		m_notEmpty.notify_all();
+	}
+
+private:
+	const size_t m_capacity;
+	std::deque<T> m_items;
+	bool m_closed;
+
+	std::mutex m_mutex;
+	std::condition_variable m_notEmpty;
+	std::condition_variable m_notFull;
+};
+
+//	Runs jobs through a sequence of stages, every stage with its own threads. The stages are
+//	connected by bounded queues, so the jobs in flight are limited and a slow stage holds back
+//	the ones before it, while the stages of different jobs overlap(the disk reads the next image
+//	while the processor searches the current one). Every job goes through every stage, in the
+//	order of the stages, the jobs of a stage may finish in any order
+template <typename Job>
+class Pipeline {
+public:
+	using Stage = std::function<void(Job&)>;
+
+public:
+	//	*depth* is the capacity of every queue
+	explicit Pipeline(size_t depth)
+		: m_depth(depth) {
+
+	}
+
+	Pipeline(const Pipeline &r) = delete;
+	Pipeline& operator=(const Pipeline &rhs) = delete;
+	~Pipeline() = default;
+
+public:
+	void addStage(unsigned threads, Stage stage) {
+		m_stages.push_back(StageInfo{ threads > 0 ? threads : 1, std::move(stage) });
+	}
+
+	//	Takes the jobs from *next* on the calling thread, until it returns nullptr, and waits
+	//	until all of them went through the last stage
+	void run(const std::function<std::unique_ptr<Job>()> &next) {
+		if (m_stages.empty()) {
+			return;
+		}
+
+		//	The queue before every stage
+		std::vector<std::unique_ptr<BoundedQueue<std::unique_ptr<Job>>>> queues;
+		std::vector<std::unique_ptr<std::atomic<unsigned>>> running;
+
+		for (const auto &stage : m_stages) {
+			queues.emplace_back(new BoundedQueue<std::unique_ptr<Job>>(m_depth));
+			running.emplace_back(new std::atomic<unsigned>(stage.threads));
+		}
+
+		std::vector<std::thread> threads;
+
+		for (size_t index = 0; index < m_stages.size(); ++index) {
+			for (unsigned thread = 0; thread < m_stages[index].threads; ++thread) {
+				threads.emplace_back([&, index]() {
+					std::unique_ptr<Job> job;
+
+					while (queues[index]->pop(job)) {
+						m_stages[index].stage(*job);
+
+						if (index + 1 < m_stages.size()) {
+							queues[index + 1]->push(std::move(job));
+						}
+
+						job.reset();
+					}
+
+					//	The last thread of the stage ends the input of the next one
+					if (--*running[index] == 0 && index + 1 < m_stages.size()) {
+						queues[index + 1]->close();
+					}
+				});
+			}
+		}
+
+		for (std::unique_ptr<Job> job = next(); job; job = next()) {
+			queues.front()->push(std::move(job));
+		}
+
+		queues.front()->close();
+
+		for (auto &thread : threads) {
+			thread.join();
+		}
+	}
+
+private:
+	struct StageInfo {
+		unsigned threads;
+		Stage stage;
+	};
+
+	size_t m_depth;
+	std::vector<StageInfo> m_stages;
+};
+
+#endif // !PIPELINE_CLASS_HEADER
@@ -0,0 +1,305 @@
+#include <cstdio>
+#include <fstream>
+#include <algorithm>
+#include "ResultCache.h"
+#include "Hash.h"
+
+//	2: the key of the grid has the number of landmarks, 3: and the engine, 4: and the bidirectional search
+const uint32_t ResultCache::VERSION = 4;
+const char *ResultCache::EXTENSION = ".leg";
+
+namespace {
+
+const char MAGIC[4] = { 'M', 'Z', 'L', 'G' };
+
+void appendVarint(std::string &data, uint64_t value) {
+	while (value >= 0x80) {
+		data.push_back(static_cast<char>((value & 0x7F) | 0x80));
+		value >>= 7;
+	}
+
+	data.push_back(static_cast<char>(value));
+}
+
+bool readVarint(const std::string &data, size_t &pos, uint64_t &value) {
+	value = 0;
+
+	for (int shift = 0; shift < 64 && pos < data.size(); shift += 7) {
+		const uint8_t byte = static_cast<uint8_t>(data[pos++]);
+		value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+
+		if (byte < 0x80) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+uint64_t zigzag(int64_t value) {
+	return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+	return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+} // namespace
+
+ResultCache::ResultCache(size_t capacity, const std::string &directory)
+	: m_directory(directory)
+	, m_capacity(capacity)
+	, m_memory(0)
+	, m_hits(0)
+	, m_misses(0) {
+
+}
+
+bool ResultCache::find(uint64_t grid, const Point &from, const std::vector<Pixel::pxl_t> &inventory, Leg &leg) {
+	const Key key = makeKey(grid, from, inventory);
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto it = m_index.find(key);
+	if (it != m_index.end()) {
+		//	Becomes the most recently used leg
+		m_entries.splice(m_entries.begin(), m_entries, it->second);
+
+		if (decode(it->second->data, leg)) {
+			++m_hits;
+			return true;
+		}
+	}
+
+	std::string data;
+	if (!m_directory.empty() && loadFile(key, data) && decode(data, leg)) {
+		store(key, std::move(data));
+		++m_hits;
+		return true;
+	}
+
+	++m_misses;
+	return false;
+}
+
+void ResultCache::insert(uint64_t grid, const Point &from, const std::vector<Pixel::pxl_t> &inventory, const Leg &leg) {
+	const Key key = makeKey(grid, from, inventory);
+	std::string data = encode(leg);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (!m_directory.empty()) {
+		saveFile(key, data);
+	}
+
+	store(key, std::move(data));
+}
+
+void ResultCache::clear() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_entries.clear();
+	m_index.clear();
+	m_memory = 0;
+}
+
+size_t ResultCache::memory() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_memory;
+}
+
+size_t ResultCache::size() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_entries.size();
+}
+
+size_t ResultCache::hits() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_hits;
+}
+
+size_t ResultCache::misses() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_misses;
+}
+
+bool ResultCache::Key::operator==(const Key &rhs) const {
+	return grid == rhs.grid && x == rhs.x && y == rhs.y && inventory == rhs.inventory;
+}
+
+size_t ResultCache::KeyHash::operator()(const Key &key) const {
+	uint64_t h = Hash::mix(key.grid, static_cast<uint32_t>(key.x));
+	h = Hash::mix(h, static_cast<uint32_t>(key.y));
+
+	for (const auto &color : key.inventory) {
+		h = Hash::mix(h, color);
+	}
+
+	return static_cast<size_t>(h ^ (h >> 29));
+}
+
+ResultCache::Key ResultCache::makeKey(uint64_t grid, const Point &from, const std::vector<Pixel::pxl_t> &inventory) {
+	Key key{ grid, from.x(), from.y(), inventory };
+
+	//	Only the set of collected keys matters
+	std::sort(key.inventory.begin(), key.inventory.end());
+	return key;
+}
+
+std::string ResultCache::encode(const Leg &leg) {
+	std::string data;
+	data.reserve(8 + 2 * leg.points.size());
+
+	appendVarint(data, (leg.found ? 1 : 0) | (leg.end ? 2 : 0));
+	appendVarint(data, leg.key);
+	appendVarint(data, leg.points.size());
+
+	//	Every point is a delta from the previous one, the first one from (0, 0)
+	Point::dim_t lastX = 0;
+	Point::dim_t lastY = 0;
+
+	for (const auto &point : leg.points) {
+		appendVarint(data, zigzag(static_cast<int64_t>(point.x()) - lastX));
+		appendVarint(data, zigzag(static_cast<int64_t>(point.y()) - lastY));
+
+		lastX = point.x();
+		lastY = point.y();
+	}
+
+	return data;
+}
+
+bool ResultCache::decode(const std::string &data, Leg &leg) {
+	size_t pos = 0;
+	uint64_t flags = 0, key = 0, count = 0;
+
+	if (!readVarint(data, pos, flags) || !readVarint(data, pos, key) || !readVarint(data, pos, count) || count > data.size()) {
+		return false;
+	}
+
+	leg.found = (flags & 1) != 0;
+	leg.end = (flags & 2) != 0;
+	leg.key = static_cast<Pixel::pxl_t>(key);
+	leg.points.clear();
+	leg.points.reserve(static_cast<size_t>(count));
+
+	int64_t x = 0, y = 0;
+	for (uint64_t i = 0; i < count; ++i) {
+		uint64_t dx = 0, dy = 0;
+		if (!readVarint(data, pos, dx) || !readVarint(data, pos, dy)) {
+			return false;
+		}
+
+		x += unzigzag(dx);
+		y += unzigzag(dy);
+		leg.points.push_back(Point{ static_cast<Point::dim_t>(x), static_cast<Point::dim_t>(y) });
+	}
+
+	return pos == data.size();
+}
+
+size_t ResultCache::cost(const Entry &entry) {
+	//	The node of the list, the node of the map(with its copy of the key) and their pointers
+	return 2 * sizeof(Entry) + 64 + entry.data.capacity() + 2 * entry.key.inventory.capacity() * sizeof(Pixel::pxl_t);
+}
+
+std::string ResultCache::filePath(const Key &key) const {
+	char name[24];
+	std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(KeyHash()(key)));
+
+	return m_directory + "/" + name + EXTENSION;
+}
+
+bool ResultCache::loadFile(const Key &key, std::string &data) const {
+	std::ifstream ifile(filePath(key), std::ios::binary);
+	if (!ifile) {
+		return false;
+	}
+
+	char magic[4] = {};
+	uint32_t version = 0;
+	uint64_t grid = 0, inventorySize = 0, dataSize = 0;
+	int32_t x = 0, y = 0;
+
+	ifile.read(magic, sizeof(magic));
+	ifile.read((char*)&version, sizeof(version));
+	ifile.read((char*)&grid, sizeof(grid));
+	ifile.read((char*)&x, sizeof(x));
+	ifile.read((char*)&y, sizeof(y));
+	ifile.read((char*)&inventorySize, sizeof(inventorySize));
+
+	//	Different legs may share a file name, the whole key is compared
+	if (!ifile || !std::equal(magic, magic + 4, MAGIC) || version != VERSION || grid != key.grid ||
+		x != key.x || y != key.y || inventorySize != key.inventory.size()) {
+		return false;
+	}
+
+	for (const auto &color : key.inventory) {
+		uint64_t stored = 0;
+		ifile.read((char*)&stored, sizeof(stored));
+
+		if (stored != color) {
+			return false;
+		}
+	}
+
+	ifile.read((char*)&dataSize, sizeof(dataSize));
+	if (!ifile || dataSize > (1ull << 32)) {
+		return false;
+	}
+
+	data.resize(static_cast<size_t>(dataSize));
+	ifile.read(&data[0], data.size());
+
+	return static_cast<bool>(ifile);
+}
+
+void ResultCache::saveFile(const Key &key, const std::string &data) const {
+	std::string record(MAGIC, sizeof(MAGIC));
+
+	const auto appendValue = [&record](const void *value, size_t bytes) {
+		record.append(static_cast<const char*>(value), bytes);
+	};
+
+	const int32_t x = key.x;
+	const int32_t y = key.y;
+	const uint64_t inventorySize = key.inventory.size();
+	const uint64_t dataSize = data.size();
+
+	appendValue(&VERSION, sizeof(VERSION));
+	appendValue(&key.grid, sizeof(key.grid));
+	appendValue(&x, sizeof(x));
+	appendValue(&y, sizeof(y));
+	appendValue(&inventorySize, sizeof(inventorySize));
+
+	for (const auto &color : key.inventory) {
+		const uint64_t stored = color;
+		appendValue(&stored, sizeof(stored));
+	}
+
+	appendValue(&dataSize, sizeof(dataSize));
+	record.append(data);
+
+	//	The cache works without the files, so a failed write is not an error
+	std::ofstream ofile(filePath(key), std::ios::binary | std::ios::trunc);
+	ofile.write(record.data(), record.size());
+}
+
+void ResultCache::store(const Key &key, std::string &&data) {
+	auto it = m_index.find(key);
+	if (it != m_index.end()) {
+		m_memory -= cost(*it->second);
+		m_entries.erase(it->second);
+		m_index.erase(it);
+	}
+
+	m_entries.push_front(Entry{ key, std::move(data) });
+	m_index.emplace(key, m_entries.begin());
+	m_memory += cost(m_entries.front());
+
+	//	The newest leg is kept even if it is larger than the cap on its own
+	while (m_memory > m_capacity && m_entries.size() > 1) {
+		m_memory -= cost(m_entries.back());
+		m_index.erase(m_entries.back().key);
+		m_entries.pop_back();
+	}
+}
@@ -0,0 +1,112 @@
+#pragma once
+#ifndef RESULT_CACHE_CLASS_HEADER
+#define RESULT_CACHE_CLASS_HEADER
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Pixel.h"
+#include "Point.h"
+
+//	LRU cache of the stages(legs) of solved mazes.
+//
+//	A leg is the result of a single inner search of PathFinder::findPath(): the path from a point
+//	to the next key or ending zone with a given inventory. It depends only on the maze, the point
+//	and the set of collected keys, so a leg is keyed by the content hash of the grid, the point and
+//	the sorted inventory. A whole query is a chain of legs, so repeated queries and queries that
+//	share a part of their route(the same point with the same keys) reuse the cached legs.
+//
+//	The points are kept as zigzag varint deltas(usually 2 bytes for every point) and the least
+//	recently used legs are dropped when the cache grows over its memory cap. Legs can also be
+//	kept in a directory, one file for every leg, which is read when a leg is not in memory
+class ResultCache {
+public:
+	static const uint32_t VERSION;
+
+	//	Extension of the leg files
+	static const char *EXTENSION;
+
+	//	Result of an inner search
+	struct Leg {
+		bool found = false;			//	*false* if neither a key nor an ending zone can be reached
+		bool end = false;			//	The leg ends in an ending zone
+		Pixel::pxl_t key = 0;		//	Color of the collected key if it does not end in an ending zone
+		std::vector<Point> points;	//	Waypoints from the target back to the start, as kept by PathFinder
+	};
+
+public:
+	//	*capacity* is the memory cap in bytes. Legs are also stored in *directory* if it is not empty
+	explicit ResultCache(size_t capacity, const std::string &directory = std::string());
+	ResultCache(const ResultCache &r) = delete;
+	ResultCache& operator=(const ResultCache &rhs) = delete;
+	~ResultCache() = default;
+
+public:
+	//	Returns *true* and fills *leg* if the leg from *from* with *inventory* is cached
+	bool find(uint64_t grid, const Point &from, const std::vector<Pixel::pxl_t> &inventory, Leg &leg);
+
+	//	Adds a leg, replacing the cached one with the same key
+	void insert(uint64_t grid, const Point &from, const std::vector<Pixel::pxl_t> &inventory, const Leg &leg);
+
+	void clear();
+
+	//	Approximate memory used by the cached legs, in bytes
+	size_t memory() const;
+	size_t size() const;
+
+	size_t hits() const;
+	size_t misses() const;
+
+private:
+	struct Key {
+		uint64_t grid;
+		Point::dim_t x;
+		Point::dim_t y;
+		std::vector<Pixel::pxl_t> inventory;	//	Sorted
+
+		bool operator==(const Key &rhs) const;
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key &key) const;
+	};
+
+	struct Entry {
+		Key key;
+		std::string data;	//	Encoded leg
+	};
+
+	using EntryList = std::list<Entry>;
+
+private:
+	static Key makeKey(uint64_t grid, const Point &from, const std::vector<Pixel::pxl_t> &inventory);
+
+	static std::string encode(const Leg &leg);
+	static bool decode(const std::string &data, Leg &leg);
+
+	//	Memory used by an entry, with the overhead of the list and the map
+	static size_t cost(const Entry &entry);
+
+	std::string filePath(const Key &key) const;
+	bool loadFile(const Key &key, std::string &data) const;
+	void saveFile(const Key &key, const std::string &data) const;
+
+	//	Adds an entry as the most recently used one and drops the least recently used ones over the cap
+	void store(const Key &key, std::string &&data);
+
+private:
+	mutable std::mutex m_mutex;
+	EntryList m_entries;	//	Most recently used first
+	std::unordered_map<Key, EntryList::iterator, KeyHash> m_index;
+	std::string m_directory;
+	size_t m_capacity;
+	size_t m_memory;
+	size_t m_hits;
+	size_t m_misses;
+};
+
+#endif // !RESULT_CACHE_CLASS_HEADER
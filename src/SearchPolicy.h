@@ -0,0 +1,73 @@
+#pragma once
+#ifndef SEARCH_POLICY_CLASS_HEADER
+#define SEARCH_POLICY_CLASS_HEADER
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+
+#include "Point.h"
+
+//	Movement rules of PathFinder. The search is instantiated for every combination at compile time,
+//	so the rules cost nothing in the inner loops and the runtime choice is made once per stage
+namespace SearchPolicy {
+	//	Moves between pixels
+	enum class Connectivity {
+		EIGHT,			//	8 directions, a diagonal step may pass the corner of a wall
+		EIGHT_STRICT,	//	8 directions, a diagonal step needs both pixels beside it to be free
+		FOUR			//	Horizontal and vertical steps only
+	};
+
+	//	Cost of the steps, the heuristic is the cost of the cheapest path without walls
+	enum class StepCost {
+		MANHATTAN,		//	1 for a straight step and 2 for a diagonal one
+		OCTILE,			//	1 for a straight step and sqrt(2) for a diagonal one, in thousandths
+		UNIT			//	1 for every step
+	};
+
+	//	Successors of an expanded pixel
+	enum class Engine {
+		JPS,			//	Jump point search: the scans skip the pixels with a single way on
+		ASTAR,			//	A* over the next pixels, no scans
+		FLOOD			//	The next pixels without the heuristic(Dijkstra), the search floods the maze
+	};
+
+	//	Rules chosen at runtime
+	struct Movement {
+		Connectivity connectivity = Connectivity::EIGHT;
+		StepCost cost = StepCost::MANHATTAN;
+
+		bool operator==(const Movement &rhs) const { return connectivity == rhs.connectivity && cost == rhs.cost; }
+		bool operator!=(const Movement &rhs) const { return !(*this == rhs); }
+	};
+
+	//	Cost of the cheapest path from *a* to *b* without walls
+	template <StepCost Cost>
+	inline size_t distance(const Point &a, const Point &b) {
+		const size_t dx = static_cast<size_t>(std::abs(a.x() - b.x()));
+		const size_t dy = static_cast<size_t>(std::abs(a.y() - b.y()));
+
+		if (Cost == StepCost::MANHATTAN) {
+			return dx + dy;
+		}
+		else if (Cost == StepCost::OCTILE) {
+			return 1000 * std::max(dx, dy) + 414 * std::min(dx, dy);
+		}
+
+		return std::max(dx, dy);
+	}
+
+	//	Same as distance(), for the cost chosen at runtime
+	inline size_t distance(StepCost cost, const Point &a, const Point &b) {
+		switch (cost) {
+		case StepCost::OCTILE:
+			return distance<StepCost::OCTILE>(a, b);
+		case StepCost::UNIT:
+			return distance<StepCost::UNIT>(a, b);
+		default:
+			return distance<StepCost::MANHATTAN>(a, b);
+		}
+	}
+}
+
+#endif // !SEARCH_POLICY_CLASS_HEADER
@@ -0,0 +1,66 @@
+#include <limits>
+#include "SearchState.h"
+
+const size_t SearchState::NO_COST = std::numeric_limits<size_t>::max();
+
+SearchState::SearchState(std::pmr::memory_resource *nodes)
+	: m_mode(Mode::DENSE)
+	, m_width(0)
+	, m_reached(nodes) {
+
+}
+
+void SearchState::reset(Mode mode, Point::dim_t width, size_t size) {
+	m_mode = mode;
+	m_width = width;
+
+	//	The buckets go back to the memory of the nodes too, not only the nodes
+	decltype(m_reached)(m_reached.get_allocator()).swap(m_reached);
+
+	//	The arrays keep their memory for the next image
+	if (m_mode == Mode::DENSE) {
+		m_parents.assign(size, Point{ -1, -1 });
+		m_costs.assign(size, NO_COST);
+	}
+	else {
+		m_parents.clear();
+		m_costs.clear();
+	}
+}
+
+void SearchState::reserve(size_t size) {
+	m_parents.reserve(size);
+	m_costs.reserve(size);
+}
+
+Point SearchState::parent(const Point &point) const {
+	if (m_mode == Mode::DENSE) {
+		return m_parents[index(point)];
+	}
+
+	auto iter = m_reached.find(index(point));
+	return iter != m_reached.end() ? iter->second.first : Point{ -1, -1 };
+}
+
+size_t SearchState::cost(const Point &point) const {
+	if (m_mode == Mode::DENSE) {
+		return m_costs[index(point)];
+	}
+
+	auto iter = m_reached.find(index(point));
+	return iter != m_reached.end() ? iter->second.second : NO_COST;
+}
+
+void SearchState::set(const Point &point, const Point &parent, size_t cost) {
+	if (m_mode == Mode::DENSE) {
+		m_parents[index(point)] = parent;
+		m_costs[index(point)] = cost;
+	}
+	else {
+		m_reached[index(point)] = std::make_pair(parent, cost);
+	}
+}
+
+size_t SearchState::index(const Point &point) const {
+	return static_cast<size_t>(point.x()) * m_width + point.y();
+}
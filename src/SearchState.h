@@ -0,0 +1,59 @@
+#pragma once
+#ifndef SEARCH_STATE_CLASS_HEADER
+#define SEARCH_STATE_CLASS_HEADER
+
+#include <cstddef>
+#include <memory_resource>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "PageAllocator.h"
+#include "Point.h"
+
+//	Parent and cost of the pixels reached by a search.
+//	DENSE keeps two arrays as large as the image, SPARSE keeps only the reached pixels,
+//	which is much smaller for Jump Point Search on huge images
+class SearchState {
+public:
+	enum class Mode {
+		DENSE,
+		SPARSE
+	};
+
+	//	Cost of the pixels that are not reached yet
+	static const size_t NO_COST;
+
+public:
+	//	The reached pixels of SPARSE are allocated from *nodes*
+	explicit SearchState(std::pmr::memory_resource *nodes = std::pmr::get_default_resource());
+	SearchState(const SearchState &r) = default;
+	SearchState& operator=(const SearchState &rhs) = default;
+	~SearchState() = default;
+
+public:
+	//	Forgets every reached pixel of an image with the given dimensions
+	void reset(Mode mode, Point::dim_t width, size_t size);
+
+	//	Keeps the memory of DENSE for images with up to *size* pixels
+	void reserve(size_t size);
+
+	//	Returns Point{ -1, -1 } if the pixel is not reached
+	Point parent(const Point &point) const;
+	size_t cost(const Point &point) const;
+
+	void set(const Point &point, const Point &parent, size_t cost);
+
+private:
+	size_t index(const Point &point) const;
+
+private:
+	Mode m_mode;
+	Point::dim_t m_width;
+
+	std::vector<Point, PageAllocator<Point>> m_parents;
+	std::vector<size_t, PageAllocator<size_t>> m_costs;
+	std::pmr::unordered_map<size_t, std::pair<Point, size_t>> m_reached;
+};
+
+#endif // !SEARCH_STATE_CLASS_HEADER
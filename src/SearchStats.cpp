@@ -0,0 +1,58 @@
+#include <fstream>
+#include "SearchStats.h"
+
+#ifdef SEARCH_STATS
+const bool SearchStats::ENABLED = true;
+#else
+const bool SearchStats::ENABLED = false;
+#endif
+
+void SearchStats::addCounters(const SearchStats &other) {
+	stages += other.stages;
+	cachedStages += other.cachedStages;
+	heapPushes += other.heapPushes;
+	heapPops += other.heapPops;
+	stalePops += other.stalePops;
+	jumpCalls += other.jumpCalls;
+	pixelsScanned += other.pixelsScanned;
+	forcedNeighbours += other.forcedNeighbours;
+	keyCostEvaluations += other.keyCostEvaluations;
+	stateResets += other.stateResets;
+	allocations += other.allocations;
+}
+
+bool SearchStats::save(const std::string &path) const {
+	std::ofstream ofile(path);
+	if (!ofile) {
+		return false;
+	}
+
+	ofile << "{\n";
+	ofile << "\t\"countersEnabled\": " << (ENABLED ? "true" : "false") << ",\n";
+	ofile << "\t\"status\": \"" << status << "\",\n";
+	ofile << "\t\"engine\": \"" << engine << "\",\n";
+
+	ofile << "\t\"phasesMs\": { \"load\": " << loadMs << ", \"analyze\": " << analyzeMs << ", \"findPath\": " << findPathMs
+		<< ", \"draw\": " << drawMs << ", \"save\": " << saveMs << " },\n";
+
+	ofile << "\t\"stagesMs\": [";
+	for (size_t i = 0; i < stageMs.size(); ++i) {
+		ofile << (i > 0 ? ", " : "") << stageMs[i];
+	}
+	ofile << "],\n";
+
+	ofile << "\t\"stages\": " << stages << ",\n";
+	ofile << "\t\"cachedStages\": " << cachedStages << ",\n";
+	ofile << "\t\"heapPushes\": " << heapPushes << ",\n";
+	ofile << "\t\"heapPops\": " << heapPops << ",\n";
+	ofile << "\t\"stalePops\": " << stalePops << ",\n";
+	ofile << "\t\"jumpCalls\": " << jumpCalls << ",\n";
+	ofile << "\t\"pixelsScanned\": " << pixelsScanned << ",\n";
+	ofile << "\t\"forcedNeighbours\": " << forcedNeighbours << ",\n";
+	ofile << "\t\"keyCostEvaluations\": " << keyCostEvaluations << ",\n";
+	ofile << "\t\"stateResets\": " << stateResets << ",\n";
+	ofile << "\t\"allocations\": " << allocations << "\n";
+	ofile << "}\n";
+
+	return ofile.good();
+}
@@ -0,0 +1,56 @@
+#pragma once
+#ifndef SEARCH_STATS_CLASS_HEADER
+#define SEARCH_STATS_CLASS_HEADER
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+//	The counters of the search are collected only when SEARCH_STATS is defined at compile time.
+//	Otherwise SEARCH_STAT(...) expands to nothing and the counters cost nothing
+#ifdef SEARCH_STATS
+#define SEARCH_STAT(...) __VA_ARGS__
+#else
+#define SEARCH_STAT(...)
+#endif
+
+//	What a solve did and where its time went
+struct SearchStats {
+	//	*true* if the counters and the stage times were collected(SEARCH_STATS)
+	static const bool ENABLED;
+
+	//	PathFinder::statusName() of the outcome of the search
+	std::string status;
+
+	//	EngineSelector::engineName() of the engine of the search
+	std::string engine;
+
+	//	Counters of PathFinder::findPath()
+	size_t stages = 0;				//	Inner searches, one for every key and the ending zone
+	size_t cachedStages = 0;		//	Stages taken from the result cache
+	size_t heapPushes = 0;
+	size_t heapPops = 0;
+	size_t stalePops = 0;			//	Popped points whose cost was lowered after they were pushed
+	size_t jumpCalls = 0;
+	size_t pixelsScanned = 0;		//	Pixels visited by jump(), including the skipped runs of RLE rows
+	size_t forcedNeighbours = 0;	//	Forced neighbours found
+	size_t keyCostEvaluations = 0;	//	Calls of closestKeyCost()
+	size_t stateResets = 0;			//	Resets of the parents and the costs
+	size_t allocations = 0;			//	Growths of the priority queue and vectors of successors that allocated
+
+	//	Wall time of the phases and of every stage of the search(ms)
+	double loadMs = 0.0;
+	double analyzeMs = 0.0;
+	double findPathMs = 0.0;
+	double drawMs = 0.0;
+	double saveMs = 0.0;
+	std::vector<double> stageMs;
+
+	//	Adds the counters of *other*(the times and the status are not changed)
+	void addCounters(const SearchStats &other);
+
+	//	Writes the stats as JSON. Returns *false* if the file cannot be written
+	bool save(const std::string &path) const;
+};
+
+#endif // !SEARCH_STATS_CLASS_HEADER
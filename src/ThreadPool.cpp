@@ -0,0 +1,121 @@
+#include <algorithm>
+#include "ThreadPool.h"
+
+ThreadPool::Job::Job(const std::function<void(size_t)> &task, size_t count)
+	: task(task)
+	, count(count)
+	, next(0)
+	, remaining(count)
+	, active(0) {
+
+}
+
+ThreadPool::ThreadPool(unsigned threads)
+	: m_stop(false) {
+
+	for (unsigned i = 1; i < threads; ++i) {
+		m_workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+
+	m_wake.notify_all();
+
+	for (auto &worker : m_workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)> &task) {
+	if (count == 0) {
+		return;
+	}
+
+	//	Nothing to share
+	if (m_workers.empty() || count == 1) {
+		for (size_t i = 0; i < count; ++i) {
+			task(i);
+		}
+
+		return;
+	}
+
+	Job job(task, count);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(&job);
+	}
+
+	m_wake.notify_all();
+	runIterations(job);
+
+	//	Wait for the last iterations and for every worker to leave the job,
+	//	the job is destroyed when this call returns
+	std::unique_lock<std::mutex> lock(m_mutex);
+	retire(job);
+	m_done.wait(lock, [&job]() { return job.remaining == 0 && job.active == 0; });
+}
+
+unsigned ThreadPool::size() const {
+	return static_cast<unsigned>(m_workers.size()) + 1;
+}
+
+ThreadPool& ThreadPool::shared() {
+	static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+	return pool;
+}
+
+void ThreadPool::workerLoop() {
+	while (true) {
+		Job *job = nullptr;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+
+			if (m_stop) {
+				return;
+			}
+
+			//	Rotate the queue, so the next worker helps the next job
+			job = m_jobs.front();
+			m_jobs.pop_front();
+			m_jobs.push_back(job);
+			++job->active;
+		}
+
+		runIterations(*job);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			retire(*job);
+			--job->active;
+		}
+
+		m_done.notify_all();
+	}
+}
+
+void ThreadPool::runIterations(Job &job) {
+	for (size_t i = job.next++; i < job.count; i = job.next++) {
+		job.task(i);
+
+		if (--job.remaining == 0) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_done.notify_all();
+		}
+	}
+}
+
+void ThreadPool::retire(Job &job) {
+	const auto it = std::find(m_jobs.begin(), m_jobs.end(), &job);
+	if (it != m_jobs.end()) {
+		m_jobs.erase(it);
+	}
+}
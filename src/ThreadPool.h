@@ -0,0 +1,67 @@
+#pragma once
+#ifndef THREAD_POOL_CLASS_HEADER
+#define THREAD_POOL_CLASS_HEADER
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//	Fixed set of worker threads that run the iterations of a loop in parallel
+class ThreadPool {
+public:
+	//	Creates threads - 1 workers, the thread that calls parallelFor() is the last one
+	explicit ThreadPool(unsigned threads);
+	ThreadPool(const ThreadPool &r) = delete;
+	ThreadPool& operator=(const ThreadPool &rhs) = delete;
+	~ThreadPool();
+
+public:
+	//	Runs task(i) for every i in [0, count) and waits for all of them.
+	//	Calls from different threads run at the same time, the workers help
+	//	every loop in turn while its caller takes its own iterations.
+	//	Must not be called from inside a task
+	void parallelFor(size_t count, const std::function<void(size_t)> &task);
+
+	//	Number of threads that run the tasks(including the calling one)
+	unsigned size() const;
+
+	//	Pool with one thread for every hardware thread
+	static ThreadPool& shared();
+
+private:
+	//	Loop of a single parallelFor() call, lives on the stack of its caller
+	struct Job {
+		Job(const std::function<void(size_t)> &task, size_t count);
+
+		const std::function<void(size_t)> &task;
+		const size_t count;
+		std::atomic<size_t> next;		//	Next iteration to be taken
+		std::atomic<size_t> remaining;	//	Iterations that are not finished yet
+		unsigned active;				//	Workers inside the loop, guarded by m_mutex
+	};
+
+	void workerLoop();
+
+	//	Takes iterations of the job until there are no more
+	void runIterations(Job &job);
+
+	//	Removes the job from the queue once all of its iterations are taken,
+	//	so no worker can enter it anymore. m_mutex must be held
+	void retire(Job &job);
+
+private:
+	std::vector<std::thread> m_workers;
+
+	std::mutex m_mutex;			//	Guards the queue and the workers of every job
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+
+	std::deque<Job*> m_jobs;	//	Jobs with iterations left to be taken
+	bool m_stop;
+};
+
+#endif // !THREAD_POOL_CLASS_HEADER
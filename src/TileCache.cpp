@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TILE_CACHE_USE_PREAD
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <cstdio>
+#endif
+
+#include "TileCache.h"
+#include "Trace.h"
+
+TileCache::TileCache(const std::string &path, size_t tileBytes, size_t tiles, size_t budget)
+	: m_path(path)
+	, m_tileBytes(tileBytes)
+	, m_capacity(std::max<size_t>(2, budget / tileBytes))
+	, m_stored(tiles, false)
+	, m_loads(0)
+#ifdef TILE_CACHE_USE_PREAD
+	, m_fd(::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600)) {
+
+	//	The file has no name any more, it goes away even if the process is killed
+	if (m_fd >= 0) {
+		::unlink(path.c_str());
+	}
+#else
+	, m_file(new std::fstream(path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc)) {
+#endif
+}
+
+TileCache::~TileCache() {
+#ifdef TILE_CACHE_USE_PREAD
+	if (m_fd >= 0) {
+		::close(m_fd);
+	}
+#else
+	m_file.reset();
+	std::remove(m_path.c_str());
+#endif
+}
+
+TileCache::operator bool() const {
+#ifdef TILE_CACHE_USE_PREAD
+	return m_fd >= 0;
+#else
+	return static_cast<bool>(*m_file);
+#endif
+}
+
+void TileCache::read(size_t tile, size_t offset, void *dst, size_t bytes) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	const Entry &entry = fetch(tile);
+	std::memcpy(dst, entry.data.get() + offset, bytes);
+}
+
+void TileCache::write(size_t tile, size_t offset, const void *src, size_t bytes) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	Entry &entry = fetch(tile);
+	std::memcpy(entry.data.get() + offset, src, bytes);
+	entry.dirty = true;
+}
+
+size_t TileCache::loads() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_loads;
+}
+
+size_t TileCache::capacity() const {
+	return m_capacity;
+}
+
+TileCache::Entry& TileCache::fetch(size_t tile) {
+	auto iter = m_resident.find(tile);
+
+	if (iter != m_resident.end()) {
+		m_recent.splice(m_recent.begin(), m_recent, iter->second.recent);
+		return iter->second;
+	}
+
+	std::unique_ptr<uint8_t[]> data;
+
+	//	Reuse the memory of the least recently used tile
+	if (m_resident.size() >= m_capacity) {
+		const size_t victim = m_recent.back();
+		Entry &old = m_resident.at(victim);
+
+		if (old.dirty) {
+			TRACE_SCOPE("page out", static_cast<int64_t>(victim));
+
+			if (!writeFile(static_cast<uint64_t>(victim) * m_tileBytes, old.data.get(), m_tileBytes)) {
+				throw std::runtime_error("The page file cannot be written!");
+			}
+
+			m_stored[victim] = true;
+		}
+
+		data = std::move(old.data);
+		m_resident.erase(victim);
+		m_recent.pop_back();
+	}
+	else {
+		data.reset(new uint8_t[m_tileBytes]);
+	}
+
+	if (m_stored[tile]) {
+		TRACE_SCOPE("page in", static_cast<int64_t>(tile));
+
+		if (!readFile(static_cast<uint64_t>(tile) * m_tileBytes, data.get(), m_tileBytes)) {
+			throw std::runtime_error("The page file cannot be read!");
+		}
+
+		++m_loads;
+	}
+	else {
+		std::memset(data.get(), 0, m_tileBytes);
+	}
+
+	m_recent.push_front(tile);
+	return m_resident.emplace(tile, Entry{ std::move(data), false, m_recent.begin() }).first->second;
+}
+
+bool TileCache::readFile(uint64_t offset, uint8_t *dst, size_t count) {
+#ifdef TILE_CACHE_USE_PREAD
+	while (count > 0) {
+		const ssize_t done = ::pread(m_fd, dst, count, static_cast<off_t>(offset));
+		if (done <= 0) {
+			return false;
+		}
+
+		dst += done;
+		offset += done;
+		count -= done;
+	}
+
+	return true;
+#else
+	m_file->seekg(offset, std::ios::beg);
+	m_file->read((char*)dst, count);
+
+	return static_cast<bool>(*m_file);
+#endif
+}
+
+bool TileCache::writeFile(uint64_t offset, const uint8_t *src, size_t count) {
+#ifdef TILE_CACHE_USE_PREAD
+	while (count > 0) {
+		const ssize_t done = ::pwrite(m_fd, src, count, static_cast<off_t>(offset));
+		if (done <= 0) {
+			return false;
+		}
+
+		src += done;
+		offset += done;
+		count -= done;
+	}
+
+	return true;
+#else
+	m_file->seekp(offset, std::ios::beg);
+	m_file->write((const char*)src, count);
+
+	return static_cast<bool>(*m_file);
+#endif
+}
@@ -0,0 +1,74 @@
+#pragma once
+#ifndef TILE_CACHE_CLASS_HEADER
+#define TILE_CACHE_CLASS_HEADER
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//	Fixed size tiles of bytes kept in a file, with at most *budget* bytes of them in memory.
+//	The least recently used tile is written back to the file when another one is needed, so
+//	a grid larger than the memory slows down instead of failing. A tile that was never written
+//	reads as zeros. The file is temporary, it is removed when the cache is destroyed.
+//	Every access copies the bytes under a lock, so the cache can be shared by several threads
+class TileCache {
+public:
+	TileCache(const std::string &path, size_t tileBytes, size_t tiles, size_t budget);
+	TileCache(const TileCache &r) = delete;
+	TileCache& operator=(const TileCache &rhs) = delete;
+	~TileCache();
+
+public:
+	//	Returns *false* if the file could not be created
+	explicit operator bool() const;
+
+	//	Copy *bytes* bytes at *offset* inside the tile. Throw std::runtime_error if the file fails
+	void read(size_t tile, size_t offset, void *dst, size_t bytes);
+	void write(size_t tile, size_t offset, const void *src, size_t bytes);
+
+	//	Number of tiles read back from the file
+	size_t loads() const;
+
+	//	Tiles kept in memory at most
+	size_t capacity() const;
+
+private:
+	struct Entry {
+		std::unique_ptr<uint8_t[]> data;
+		bool dirty;
+		std::list<size_t>::iterator recent;	//	Position in m_recent
+	};
+
+private:
+	//	Makes the tile resident and the most recently used one, the lock must be held
+	Entry& fetch(size_t tile);
+
+	bool readFile(uint64_t offset, uint8_t *dst, size_t count);
+	bool writeFile(uint64_t offset, const uint8_t *src, size_t count);
+
+private:
+	std::string m_path;
+	size_t m_tileBytes;
+	size_t m_capacity;
+
+	std::unordered_map<size_t, Entry> m_resident;
+	std::list<size_t> m_recent;		//	Resident tiles, the most recently used first
+	std::vector<bool> m_stored;		//	The tile was written to the file
+	size_t m_loads;
+
+	mutable std::mutex m_mutex;
+
+#if defined(__unix__) || defined(__APPLE__)
+	int m_fd;
+#else
+	std::unique_ptr<std::fstream> m_file;
+#endif
+};
+
+#endif // !TILE_CACHE_CLASS_HEADER
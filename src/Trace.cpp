@@ -0,0 +1,135 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Trace.h"
+
+namespace {
+
+struct Event {
+	const char *name;
+	int64_t arg;
+	uint64_t begin;
+	uint64_t end;
+};
+
+//	Ring buffer of a single thread. Only its thread writes the events, *written* is published
+//	with release semantics so save() sees complete events
+struct Buffer {
+	std::vector<Event> events;
+	std::atomic<uint64_t> written;
+	uint32_t tid;
+};
+
+std::mutex registryMutex;
+std::vector<std::unique_ptr<Buffer>> registry;	//	Buffers are kept after their threads exit
+
+thread_local Buffer *threadBuffer = nullptr;
+thread_local uint64_t threadScopes = 0;			//	Scopes seen by the thread, for sampling
+
+Buffer& buffer() {
+	if (!threadBuffer) {
+		std::unique_ptr<Buffer> created(new Buffer());
+		created->events.resize(Trace::BUFFER_EVENTS);
+		created->written = 0;
+
+		std::lock_guard<std::mutex> lock(registryMutex);
+		created->tid = static_cast<uint32_t>(registry.size() + 1);
+		threadBuffer = created.get();
+		registry.push_back(std::move(created));
+	}
+
+	return *threadBuffer;
+}
+
+} // namespace
+
+const size_t Trace::BUFFER_EVENTS = 1 << 16;
+
+std::atomic<bool> Trace::s_enabled(false);
+std::atomic<unsigned> Trace::s_sampleEvery(1);
+
+Trace::Scope::Scope(const char *name, int64_t arg)
+	: m_name(name)
+	, m_arg(arg)
+	, m_begin(0) {
+
+	if (s_enabled.load(std::memory_order_relaxed) && threadScopes++ % s_sampleEvery.load(std::memory_order_relaxed) == 0) {
+		m_begin = now();
+	}
+}
+
+Trace::Scope::~Scope() {
+	if (m_begin != 0) {
+		record(m_name, m_arg, m_begin, now());
+	}
+}
+
+void Trace::enable(unsigned sampleEvery) {
+	s_sampleEvery = sampleEvery > 0 ? sampleEvery : 1;
+	s_enabled = true;
+}
+
+void Trace::disable() {
+	s_enabled = false;
+}
+
+bool Trace::enabled() {
+	return s_enabled.load(std::memory_order_relaxed);
+}
+
+bool Trace::save(const std::string &path) {
+	std::ofstream ofile(path);
+	if (!ofile) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+	ofile << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+
+	char line[256];
+	bool first = true;
+
+	for (const auto &buf : registry) {
+		ofile << (first ? "\n" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buf->tid
+			<< ", \"args\": {\"name\": \"thread " << buf->tid << "\"}}";
+		first = false;
+
+		//	Only the last BUFFER_EVENTS events are still in the ring
+		const uint64_t written = buf->written.load(std::memory_order_acquire);
+		const uint64_t oldest = written > BUFFER_EVENTS ? written - BUFFER_EVENTS : 0;
+
+		for (uint64_t i = oldest; i < written; ++i) {
+			const Event &event = buf->events[i % BUFFER_EVENTS];
+
+			//	Timestamps are in microseconds
+			std::snprintf(line, sizeof(line), ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f",
+				event.name, buf->tid, event.begin / 1000.0, (event.end - event.begin) / 1000.0);
+			ofile << line;
+
+			if (event.arg >= 0) {
+				ofile << ", \"args\": {\"arg\": " << event.arg << "}";
+			}
+
+			ofile << "}";
+		}
+	}
+
+	ofile << "\n]}\n";
+	return ofile.good();
+}
+
+uint64_t Trace::now() {
+	static const auto epoch = std::chrono::steady_clock::now();
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count()) + 1;
+}
+
+void Trace::record(const char *name, int64_t arg, uint64_t begin, uint64_t end) {
+	Buffer &buf = buffer();
+	const uint64_t index = buf.written.load(std::memory_order_relaxed);
+
+	buf.events[index % BUFFER_EVENTS] = Event{ name, arg, begin, end };
+	buf.written.store(index + 1, std::memory_order_release);
+}
@@ -0,0 +1,60 @@
+#pragma once
+#ifndef TRACE_CLASS_HEADER
+#define TRACE_CLASS_HEADER
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+//	Timeline of the solver in the Chrome trace event format(chrome://tracing, ui.perfetto.dev).
+//
+//	Every thread records its events in its own ring buffer, without locks, so tracing can stay
+//	enabled in production. When a buffer is full the oldest events are overwritten. With sampling
+//	only every n-th scope of a thread is recorded. While tracing is disabled a scope costs a
+//	single relaxed load
+class Trace {
+public:
+	//	Events kept for every thread
+	static const size_t BUFFER_EVENTS;
+
+	//	Measures the lifetime of a scope. *name* must be a string literal(it is never copied)
+	class Scope {
+	public:
+		explicit Scope(const char *name, int64_t arg = -1);
+		Scope(const Scope &r) = delete;
+		Scope& operator=(const Scope &rhs) = delete;
+		~Scope();
+
+	private:
+		const char *m_name;
+		int64_t m_arg;		//	Shown as "arg" in the viewer if it is not negative
+		uint64_t m_begin;	//	0 if the scope is not recorded
+	};
+
+public:
+	//	Starts recording, every *sampleEvery*-th scope of a thread is recorded
+	static void enable(unsigned sampleEvery = 1);
+	static void disable();
+	static bool enabled();
+
+	//	Writes the recorded events as JSON. Should be called when no thread is recording
+	static bool save(const std::string &path);
+
+private:
+	//	Nanoseconds since the first use of the trace, never 0
+	static uint64_t now();
+
+	static void record(const char *name, int64_t arg, uint64_t begin, uint64_t end);
+
+private:
+	static std::atomic<bool> s_enabled;
+	static std::atomic<unsigned> s_sampleEvery;
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+//	Records the rest of the enclosing scope under *name*(and an optional integer argument)
+#define TRACE_SCOPE(...) Trace::Scope TRACE_CONCAT(traceScope, __LINE__)(__VA_ARGS__)
+
+#endif // !TRACE_CLASS_HEADER
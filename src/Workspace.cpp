@@ -0,0 +1,72 @@
+#include "Workspace.h"
+
+Workspace::Workspace()
+	: m_capacity(0)
+	, m_memory(&m_arena)
+	, m_state(&m_memory) {
+
+}
+
+void Workspace::begin(size_t size) {
+	//	Nothing may keep memory of the arena past the reset
+	m_state.reset(SearchState::Mode::SPARSE, 0, 0);
+	m_memory.release();
+	m_arena.reset();
+
+	m_queue.clear();
+
+	if (size > m_capacity) {
+		size_t capacity = 1;
+		while (capacity < size) {
+			capacity <<= 1;
+		}
+
+		m_state.reserve(capacity);
+		m_visited.reserve(capacity);
+		m_capacity = capacity;
+	}
+}
+
+size_t Workspace::capacity() const {
+	return m_capacity;
+}
+
+std::pmr::memory_resource* Workspace::memory() {
+	return &m_memory;
+}
+
+std::unique_ptr<Workspace> WorkspacePool::acquire(size_t size) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_free.empty()) {
+		return std::unique_ptr<Workspace>(new Workspace());
+	}
+
+	size_t best = 0;
+
+	for (size_t i = 1; i < m_free.size(); ++i) {
+		const size_t capacity = m_free[i]->capacity();
+		const size_t bestCapacity = m_free[best]->capacity();
+
+		const bool fits = capacity >= size;
+		const bool bestFits = bestCapacity >= size;
+
+		if ((fits && (!bestFits || capacity < bestCapacity)) || (!fits && !bestFits && capacity > bestCapacity)) {
+			best = i;
+		}
+	}
+
+	std::unique_ptr<Workspace> workspace = std::move(m_free[best]);
+	m_free.erase(m_free.begin() + best);
+
+	return workspace;
+}
+
+void WorkspacePool::release(std::unique_ptr<Workspace> workspace) {
+	if (!workspace) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_free.push_back(std::move(workspace));
+}
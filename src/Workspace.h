@@ -0,0 +1,79 @@
+#pragma once
+#ifndef WORKSPACE_CLASS_HEADER
+#define WORKSPACE_CLASS_HEADER
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "Arena.h"
+#include "BidirectionalSearch.h"
+#include "ParallelSearch.h"
+#include "SearchState.h"
+
+//	Memory of a solve that is kept for the next one: the arrays of the search and of the analysis,
+//	the priority queue, the searches with their own arrays and threads, and an arena for the
+//	transient objects. A batch reuses it for every maze instead of allocating and faulting the
+//	pages of the arrays again. A workspace is used by a single solve at a time
+class Workspace {
+	friend class ImageInfo;
+	friend class PathFinder;
+
+public:
+	Workspace();
+	Workspace(const Workspace &r) = delete;
+	Workspace& operator=(const Workspace &rhs) = delete;
+	~Workspace() = default;
+
+public:
+	//	Starts the solve of an image with *size* pixels. Frees everything in the arena and keeps
+	//	the memory of the arrays for images up to the next power of two
+	void begin(size_t size);
+
+	//	Pixels of the largest image the arrays were kept for
+	size_t capacity() const;
+
+	//	Memory of the transient objects of the solve, freed memory is reused by the next ones
+	//	and everything is freed by the next begin()
+	std::pmr::memory_resource* memory();
+
+private:
+	size_t m_capacity;
+
+	Arena m_arena;
+	//	Pools of blocks of every size over the arena, for the nodes of the sparse search
+	//	states and the queues of the analysis
+	std::pmr::unsynchronized_pool_resource m_memory;
+
+	SearchState m_state;
+	std::vector<std::pair<Point, size_t>> m_queue;
+	std::vector<bool> m_visited;
+
+	std::unique_ptr<ParallelSearch> m_parallel;
+	std::unique_ptr<BidirectionalSearch> m_bidirectional;
+};
+
+//	Free workspaces of a batch, shared by its workers
+class WorkspacePool {
+public:
+	WorkspacePool() = default;
+	WorkspacePool(const WorkspacePool &r) = delete;
+	WorkspacePool& operator=(const WorkspacePool &rhs) = delete;
+	~WorkspacePool() = default;
+
+public:
+	//	Returns the free workspace with the smallest capacity for an image with *size* pixels,
+	//	or the largest one if none of them is large enough, or a new one
+	std::unique_ptr<Workspace> acquire(size_t size);
+
+	void release(std::unique_ptr<Workspace> workspace);
+
+private:
+	std::mutex m_mutex;
+	std::vector<std::unique_ptr<Workspace>> m_free;
+};
+
+#endif // !WORKSPACE_CLASS_HEADER
@@ -1,35 +1,616 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "CoarseGrid.h"
+#include "EngineSelector.h"
 #include "Image.h"
 #include "ImageInfo.h"
 #include "PathFinder.h"
+#include "Pipeline.h"
+#include "MazeCache.h"
+#include "Trace.h"
+#include "Workspace.h"
 
-int main() {
-	Image img("./images/example.bmp");
-	if (!img.loadImage()) {
-		std::cout << "The image was not loaded properly!\n";
-		return 1;
+//	Options given on the command line
+struct Options {
+	Image::Layout layout = Image::Layout::ROW_MAJOR;
+	unsigned decodeThreads = 1;
+	size_t pageBudgetMb = 256;	//	Memory of the tiles of the paged layout
+	Point::dim_t lineWidth = 1;	//	Thickness of the drawn path
+	bool cache = false;			//	Use/build a .mzc file next to every image
+	bool cacheRle = false;		//	Run-length encode the pixels of new cache files
+	bool streamOutput = false;	//	Stream the output from the source file instead of drawing on the grid
+	unsigned outputBits = 24;	//	Bits per pixel of the saved images, 24 or 8
+	PathWriter::Format pointsFormat = PathWriter::Format::TEXT;
+	std::string pointsFile;		//	Single file with the paths of all mazes, if not empty
+	size_t resultCacheMb = 0;	//	Memory cap of the cache of solved stages, 0 disables it
+	std::string resultCacheDir;	//	Directory that keeps the solved stages between runs
+	size_t timeLimitMs = 0;		//	Time limit of every search, 0 means no limit
+	size_t maxExpansions = 0;	//	Expansion limit of every search, 0 means no limit
+	double anytimeWeight = 1.0;	//	Weight of the heuristic of the first pass of the anytime search
+	bool anytimeGiven = false;
+	unsigned searchThreads = 1;	//	Threads of every stage of the search, 0 uses every hardware thread
+	bool searchThreadsGiven = false;
+	SearchPolicy::Engine engine = SearchPolicy::Engine::JPS;
+	bool autoEngine = false;	//	Choose the engine, the weight and the threads of every maze from its statistics
+	EngineSelector engineModel;	//	Predicts the fastest engine for --engine=auto
+	bool bidirectional = false;	//	Search the last stage from both ends
+	SearchPolicy::Movement movement;	//	Connectivity and cost of the steps of the path
+	unsigned landmarks = 0;		//	Landmarks of the heuristic, 0 uses only the distance without walls
+	bool coarseGrid = false;	//	Search regular mazes on their cells instead of their pixels
+	bool hugePages = false;		//	Back the arrays of the search with transparent huge pages
+	std::vector<unsigned> pipeline;	//	Threads of loading, analyzing, searching and saving, empty for one maze at a time
+	size_t pipelineDepth = 2;	//	Mazes waiting before every stage of the pipeline
+	bool stats = false;			//	Write the stats of every solve next to its image
+	std::string trace;			//	Chrome trace of the whole run, if not empty
+	unsigned traceSample = 1;	//	Record every n-th traced scope of a thread
+	std::vector<std::string> paths;
+};
+
+static void printUsage() {
+	std::cout << "Usage: solver [--layout=row-major|tiled|rle|paged] [--page-budget=MB] [--decode-threads=N] [--line-width=N] [--stream-output] [--output-bpp=24|8] [--points-format=text|binary|json] [--points-file=FILE] [--result-cache=MB] [--result-cache-dir=DIR] [--time-limit=MS] [--max-expansions=N] [--anytime=W] [--search-threads=N] [--engine=jps|astar|flood|auto] [--engine-model=FILE] [--bidirectional] [--moves=8|8-strict|4] [--step-cost=manhattan|octile|unit] [--landmarks=N] [--coarse-grid] [--huge-pages] [--pipeline=L,A,S,W] [--pipeline-depth=N] [--cache] [--cache-rle] [--stats] [--trace=FILE] [--trace-sample=N] [image.bmp ...]\n";
+}
+
+//	Returns *false* if the argument is not valid
+static bool parseArgument(const std::string &arg, Options &options) {
+	if (arg == "--layout=row-major") {
+		options.layout = Image::Layout::ROW_MAJOR;
+	}
+	else if (arg == "--layout=tiled") {
+		options.layout = Image::Layout::TILED;
+	}
+	else if (arg == "--layout=rle") {
+		options.layout = Image::Layout::RLE;
+	}
+	else if (arg == "--layout=paged") {
+		options.layout = Image::Layout::PAGED;
+	}
+	else if (arg.compare(0, 14, "--page-budget=") == 0) {
+		options.pageBudgetMb = std::stoul(arg.substr(14));
+	}
+	else if (arg.compare(0, 17, "--decode-threads=") == 0) {
+		options.decodeThreads = static_cast<unsigned>(std::stoul(arg.substr(17)));
+	}
+	else if (arg.compare(0, 13, "--line-width=") == 0) {
+		options.lineWidth = static_cast<Point::dim_t>(std::stoul(arg.substr(13)));
+	}
+	else if (arg == "--stream-output") {
+		options.streamOutput = true;
+	}
+	else if (arg == "--output-bpp=24") {
+		options.outputBits = 24;
+	}
+	else if (arg == "--output-bpp=8") {
+		options.outputBits = 8;
+	}
+	else if (arg == "--points-format=text") {
+		options.pointsFormat = PathWriter::Format::TEXT;
+	}
+	else if (arg == "--points-format=binary") {
+		options.pointsFormat = PathWriter::Format::BINARY;
+	}
+	else if (arg == "--points-format=json") {
+		options.pointsFormat = PathWriter::Format::JSON;
+	}
+	else if (arg.compare(0, 14, "--points-file=") == 0) {
+		options.pointsFile = arg.substr(14);
+	}
+	else if (arg.compare(0, 15, "--result-cache=") == 0) {
+		options.resultCacheMb = std::stoul(arg.substr(15));
+	}
+	else if (arg.compare(0, 19, "--result-cache-dir=") == 0) {
+		options.resultCacheDir = arg.substr(19);
+	}
+	else if (arg.compare(0, 13, "--time-limit=") == 0) {
+		options.timeLimitMs = std::stoul(arg.substr(13));
+	}
+	else if (arg.compare(0, 17, "--max-expansions=") == 0) {
+		options.maxExpansions = std::stoul(arg.substr(17));
+	}
+	else if (arg.compare(0, 10, "--anytime=") == 0) {
+		options.anytimeWeight = std::stod(arg.substr(10));
+		options.anytimeGiven = true;
+	}
+	else if (arg.compare(0, 17, "--search-threads=") == 0) {
+		options.searchThreads = static_cast<unsigned>(std::stoul(arg.substr(17)));
+		options.searchThreadsGiven = true;
 	}
+	else if (arg == "--engine=jps") {
+		options.engine = SearchPolicy::Engine::JPS;
+		options.autoEngine = false;
+	}
+	else if (arg == "--engine=astar") {
+		options.engine = SearchPolicy::Engine::ASTAR;
+		options.autoEngine = false;
+	}
+	else if (arg == "--engine=flood") {
+		options.engine = SearchPolicy::Engine::FLOOD;
+		options.autoEngine = false;
+	}
+	else if (arg == "--engine=auto") {
+		options.autoEngine = true;
+	}
+	else if (arg.compare(0, 15, "--engine-model=") == 0) {
+		return options.engineModel.load(arg.substr(15));
+	}
+	else if (arg == "--bidirectional") {
+		options.bidirectional = true;
+	}
+	else if (arg == "--moves=8") {
+		options.movement.connectivity = SearchPolicy::Connectivity::EIGHT;
+	}
+	else if (arg == "--moves=8-strict") {
+		options.movement.connectivity = SearchPolicy::Connectivity::EIGHT_STRICT;
+	}
+	else if (arg == "--moves=4") {
+		options.movement.connectivity = SearchPolicy::Connectivity::FOUR;
+	}
+	else if (arg == "--step-cost=manhattan") {
+		options.movement.cost = SearchPolicy::StepCost::MANHATTAN;
+	}
+	else if (arg == "--step-cost=octile") {
+		options.movement.cost = SearchPolicy::StepCost::OCTILE;
+	}
+	else if (arg == "--step-cost=unit") {
+		options.movement.cost = SearchPolicy::StepCost::UNIT;
+	}
+	else if (arg.compare(0, 12, "--landmarks=") == 0) {
+		options.landmarks = static_cast<unsigned>(std::stoul(arg.substr(12)));
+	}
+	else if (arg == "--coarse-grid") {
+		options.coarseGrid = true;
+	}
+	else if (arg == "--huge-pages") {
+		options.hugePages = true;
+	}
+	else if (arg.compare(0, 11, "--pipeline=") == 0) {
+		options.pipeline.clear();
 
-	ImageInfo imgInfo(img);
-	PathFinder finder(imgInfo);
+		for (size_t begin = 11; begin <= arg.size(); ) {
+			const size_t end = std::min(arg.find(',', begin), arg.size());
+			options.pipeline.push_back(static_cast<unsigned>(std::stoul(arg.substr(begin, end - begin))));
+			begin = end + 1;
+		}
+
+		if (options.pipeline.size() != 4) {
+			std::cout << "The pipeline needs the threads of 4 stages: " << arg << '\n';
+			return false;
+		}
+	}
+	else if (arg.compare(0, 17, "--pipeline-depth=") == 0) {
+		options.pipelineDepth = std::stoul(arg.substr(17));
+	}
+	else if (arg == "--cache") {
+		options.cache = true;
+	}
+	else if (arg == "--cache-rle") {
+		options.cache = true;
+		options.cacheRle = true;
+	}
+	else if (arg == "--stats") {
+		options.stats = true;
+	}
+	else if (arg.compare(0, 8, "--trace=") == 0) {
+		options.trace = arg.substr(8);
+	}
+	else if (arg.compare(0, 15, "--trace-sample=") == 0) {
+		options.traceSample = static_cast<unsigned>(std::stoul(arg.substr(15)));
+	}
+	else if (arg.compare(0, 2, "--") == 0) {
+		std::cout << "Unknown option: " << arg << '\n';
+		return false;
+	}
+	else {
+		options.paths.push_back(arg);
+	}
+
+	return true;
+}
+
+//	Returns *false* if the command line is not valid
+static bool parseOptions(int argc, char *argv[], Options &options) {
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+
+		//	Numeric values are parsed with std::stoul, which throws on invalid input
+		try {
+			if (!parseArgument(arg, options)) {
+				return false;
+			}
+		}
+		catch (std::exception &) {
+			std::cout << "Invalid value: " << arg << '\n';
+			return false;
+		}
+	}
+
+	//	Keep the old behaviour when there are no arguments
+	if (options.paths.empty()) {
+		options.paths.push_back("./images/example.bmp");
+	}
+
+	return true;
+}
+
+//	Set by SIGINT, stops the current search and the remaining mazes
+static std::atomic<bool> cancelled(false);
+
+static void cancel(int) {
+	cancelled = true;
+}
+
+//	Milliseconds since *begin*
+static double elapsedMs(std::chrono::steady_clock::time_point begin) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+//	A maze on its way from its file to its results
+struct MazeJob {
+	MazeJob(size_t index, const std::string &path, const Options &options);
+
+	size_t index;				//	Position in the command line
+	EngineSelector::Choice choice;	//	Engine, weight and threads of the search
+	ImageInfo imgInfo;
+	PathFinder finder;
+	SearchStats stats;
+	std::unique_ptr<Workspace> workspace;
+	PathOverlay overlay;		//	The drawn path, with --stream-output
+	PathWriter points;			//	The path for the file of all mazes, with --points-file
+	MazeCache::Source source;	//	The image file, for the maze cache
+	bool cached;				//	The maze is kept in the maze cache
+	bool analyzed;				//	The analysis was loaded from the maze cache
+	bool found;
+	bool failed;				//	The maze has no result, the exit code is 1
+};
+
+MazeJob::MazeJob(size_t index, const std::string &path, const Options &options)
+	: index(index)
+	, imgInfo(Image(path))
+	, points(options.pointsFormat, true)
+	, cached(false)
+	, analyzed(false)
+	, found(false)
+	, failed(false) {
+
+	choice.engine = options.engine;
+	choice.weight = options.anytimeWeight;
+	choice.threads = options.searchThreads;
+
+	imgInfo.getImage().setLayout(options.layout);
+	imgInfo.getImage().setDecodeThreads(options.decodeThreads);
+	imgInfo.getImage().setOutputBitsPerPixel(options.outputBits);
+	imgInfo.getImage().setPageBudget(options.pageBudgetMb << 20);
+	finder.setImageData(imgInfo);
+}
+
+//	Loads a maze, from its cache file with its analysis if there is a valid one
+static void loadMaze(MazeJob &job, const Options &options) {
+	Image &img = job.imgInfo.getImage();
+	const auto begin = std::chrono::steady_clock::now();
 
 	try {
-		imgInfo.analyzeImage();
-		
-		if (finder.findPath()) {
-			finder.drawPath();
-			imgInfo.saveImage();
+		//	A paged grid does not fit in memory, it is not cached
+		job.cached = options.cache && options.layout != Image::Layout::PAGED && MazeCache::source(img.path(), job.source);
+
+		if (job.cached && MazeCache::load(MazeCache::cachePath(img.path()), job.source, job.imgInfo)) {
+			img.setLayout(options.layout);
+			job.analyzed = true;
 		}
-		else {
+		else if (!img.loadImage()) {
+			std::cout << "The image was not loaded properly!\n";
+			job.failed = true;
+		}
+	}
+	catch (std::exception &x) {
+		std::cout << x.what() << '\n';
+		job.failed = true;
+	}
+
+	job.stats.loadMs = elapsedMs(begin);
+}
+
+//	Analyzes a loaded maze and saves its cache file. The memory of its solve is taken from *workspaces*
+static void analyzeMaze(MazeJob &job, const Options &options, WorkspacePool &workspaces) {
+	if (job.failed) {
+		return;
+	}
+
+	Image &img = job.imgInfo.getImage();
+	const auto begin = std::chrono::steady_clock::now();
+
+	try {
+		//	Compact images are searched with sparse states, the dense arrays are not needed
+		const size_t size = img.compact() ? 0 : img.size();
+
+		job.workspace = workspaces.acquire(size);
+		job.workspace->begin(size);
+
+		if (!job.analyzed) {
+			job.imgInfo.analyzeImage(job.workspace.get());
+			job.stats.analyzeMs = elapsedMs(begin);
+
+			if (job.cached && !MazeCache::save(MazeCache::cachePath(img.path()), job.imgInfo, job.source, options.cacheRle)) {
+				std::cout << "The maze cache could not be saved!\n";
+			}
+		}
+
+		//	The cells are found again from the pixels, they are not kept in the maze cache. A maze
+		//	that is not drawn on a regular grid is searched on its pixels
+		if (options.coarseGrid) {
+			const auto coarseBegin = std::chrono::steady_clock::now();
+
+			job.imgInfo.buildCoarseGrid();
+			job.stats.analyzeMs += elapsedMs(coarseBegin);
+		}
+
+		//	The statistics of the maze the search runs on, the options given on the command line are kept
+		if (options.autoEngine) {
+			const auto selectBegin = std::chrono::steady_clock::now();
+
+			CoarseGrid *grid = job.imgInfo.coarseGrid();
+			ImageInfo &searched = grid ? grid->info() : job.imgInfo;
+			const auto movement = grid ? CoarseGrid::movement(options.movement) : options.movement;
+			const auto choice = options.engineModel.choose(searched.statistics(), movement, options.timeLimitMs, std::thread::hardware_concurrency());
+
+			job.choice.engine = choice.engine;
+			if (!options.anytimeGiven) {
+				job.choice.weight = choice.weight;
+			}
+			if (!options.searchThreadsGiven) {
+				job.choice.threads = choice.threads;
+			}
+			job.stats.analyzeMs += elapsedMs(selectBegin);
+		}
+
+		//	The costs of the landmarks depend on the movement, they are not kept in the maze cache.
+		//	They are computed for the maze the search runs on. The flood has no heuristic
+		if (options.landmarks > 0 && job.choice.engine != SearchPolicy::Engine::FLOOD) {
+			const auto landmarksBegin = std::chrono::steady_clock::now();
+
+			if (CoarseGrid *grid = job.imgInfo.coarseGrid()) {
+				grid->info().buildLandmarks(options.landmarks, CoarseGrid::movement(options.movement));
+			}
+			else {
+				job.imgInfo.buildLandmarks(options.landmarks, options.movement);
+			}
+			job.stats.analyzeMs += elapsedMs(landmarksBegin);
+		}
+	}
+	catch (std::exception &x) {
+		std::cout << x.what() << '\n';
+		job.failed = true;
+	}
+}
+
+//	Searches and draws the path of an analyzed maze. The stages are cached in *results* if it is not
+//	null. The workspace goes back to *workspaces*
+static void searchMaze(MazeJob &job, const Options &options, ResultCache *results, WorkspacePool &workspaces) {
+	if (job.failed) {
+		workspaces.release(std::move(job.workspace));
+		return;
+	}
+
+	PathFinder &finder = job.finder;
+	finder.setResultCache(results);
+	finder.setSearchThreads(job.choice.threads);
+	finder.setEngine(job.choice.engine);
+	finder.setBidirectional(options.bidirectional);
+	finder.setMovement(options.movement);
+	finder.setWorkspace(job.workspace.get());
+
+	try {
+		PathFinder::Budget budget;
+		budget.maxExpansions = options.maxExpansions;
+		budget.cancel = &cancelled;
+		budget.weight = job.choice.weight;
+
+		if (options.timeLimitMs > 0) {
+			budget.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(options.timeLimitMs);
+		}
+
+		finder.setBudget(budget);
+		job.found = finder.findPath();
+
+		//	The search fills the counters and its own times
+		const double loadMs = job.stats.loadMs;
+		const double analyzeMs = job.stats.analyzeMs;
+		job.stats = finder.stats();
+		job.stats.loadMs = loadMs;
+		job.stats.analyzeMs = analyzeMs;
+		job.stats.engine = EngineSelector::engineName(job.choice.engine);
+
+		if (job.found) {
+			const auto begin = std::chrono::steady_clock::now();
+			if (options.streamOutput) {
+				finder.drawPath(job.overlay, options.lineWidth);
+			}
+			else {
+				finder.drawPath(options.lineWidth);
+			}
+			job.stats.drawMs = elapsedMs(begin);
+		}
+	}
+	catch (std::exception &x) {
+		std::cout << x.what() << '\n';
+		job.failed = true;
+	}
+
+	finder.setWorkspace(nullptr);
+	workspaces.release(std::move(job.workspace));
+}
+
+//	Saves the image with the path, the points and the stats of a searched maze
+static void saveMaze(MazeJob &job, const Options &options) {
+	if (job.failed) {
+		return;
+	}
+
+	PathFinder &finder = job.finder;
+
+	try {
+		if (job.found) {
+			const auto begin = std::chrono::steady_clock::now();
+			if (options.streamOutput) {
+				job.imgInfo.saveImage(job.overlay);
+			}
+			else {
+				job.imgInfo.saveImage();
+			}
+			job.stats.saveMs = elapsedMs(begin);
+		}
+		else if (finder.status() == PathFinder::Status::NO_PATH) {
 			std::cout << "There is no path!\n";
 		}
 
-		finder.savePathPoints();
+		if (finder.status() == PathFinder::Status::APPROXIMATE) {
+			std::cout << "The search budget was exhausted, the path is not refined!\n";
+		}
+
+		//	Without a path there is nothing to save, "No solution!" would be wrong
+		const bool stopped = finder.status() == PathFinder::Status::BUDGET_EXHAUSTED || (!job.found && finder.status() == PathFinder::Status::CANCELLED);
+
+		if (stopped) {
+			std::cout << (finder.status() == PathFinder::Status::CANCELLED ? "The search was cancelled!\n" : "The search budget was exhausted!\n");
+		}
+		else if (!options.pointsFile.empty()) {
+			finder.appendPathPoints(job.points);
+		}
+		else {
+			finder.savePathPoints(options.pointsFormat);
+		}
+
+		//	Next to the _outputPoints.txt file
+		const std::string &path = job.imgInfo.getImage().path();
+		if (options.stats && !job.stats.save(path.substr(0, path.rfind('.')) + "_stats.json")) {
+			std::cout << "The stats file cannot be generated!\n";
+		}
+
+		if (stopped) {
+			job.failed = true;
+		}
 	}
 	catch (std::exception &x) {
 		std::cout << x.what() << '\n';
+		job.failed = true;
+	}
+}
+
+int main(int argc, char *argv[]) {
+	Options options;
+	if (!parseOptions(argc, argv, options)) {
+		printUsage();
 		return 1;
 	}
-	
-	return 0;
+
+	if (!options.trace.empty()) {
+		Trace::enable(options.traceSample);
+	}
+
+	//	The paths of all mazes are kept in memory and written at once
+	PathWriter points(options.pointsFormat, true);
+	const bool batch = !options.pointsFile.empty();
+
+	//	Shared by all mazes, the stages of a maze are keyed by its content
+	const bool cacheResults = options.resultCacheMb > 0 || !options.resultCacheDir.empty();
+	ResultCache results(options.resultCacheMb > 0 ? options.resultCacheMb << 20 : 64u << 20, options.resultCacheDir);
+
+	//	The memory of a solve is reused by the next ones
+	PageMemory::setHugePages(options.hugePages);
+	WorkspacePool workspaces;
+
+	std::signal(SIGINT, cancel);
+
+	int result = 0;
+
+	if (options.pipeline.empty()) {
+		for (size_t index = 0; index < options.paths.size(); ++index) {
+			TRACE_SCOPE("solve");
+
+			if (cancelled) {
+				result = 1;
+				break;
+			}
+
+			MazeJob job(index, options.paths[index], options);
+
+			loadMaze(job, options);
+			analyzeMaze(job, options, workspaces);
+			searchMaze(job, options, cacheResults ? &results : nullptr, workspaces);
+			saveMaze(job, options);
+
+			points.append(job.points);
+			result |= job.failed ? 1 : 0;
+		}
+	}
+	else {
+		//	The paths of the mazes are appended in the order of the command line
+		std::vector<PathWriter> mazePoints(options.paths.size(), PathWriter(options.pointsFormat, true));
+		std::atomic<int> failed(0);
+
+		Pipeline<MazeJob> pipeline(options.pipelineDepth);
+
+		pipeline.addStage(options.pipeline[0], [&](MazeJob &job) {
+			loadMaze(job, options);
+		});
+
+		pipeline.addStage(options.pipeline[1], [&](MazeJob &job) {
+			analyzeMaze(job, options, workspaces);
+		});
+
+		pipeline.addStage(options.pipeline[2], [&](MazeJob &job) {
+			searchMaze(job, options, cacheResults ? &results : nullptr, workspaces);
+		});
+
+		pipeline.addStage(options.pipeline[3], [&](MazeJob &job) {
+			saveMaze(job, options);
+
+			mazePoints[job.index] = std::move(job.points);
+			failed |= job.failed ? 1 : 0;
+		});
+
+		size_t next = 0;
+
+		pipeline.run([&]() {
+			if (next == options.paths.size()) {
+				return std::unique_ptr<MazeJob>();
+			}
+
+			if (cancelled) {
+				failed = 1;
+				return std::unique_ptr<MazeJob>();
+			}
+
+			std::unique_ptr<MazeJob> job(new MazeJob(next, options.paths[next], options));
+			++next;
+
+			//	The queue before the loading holds it back, so the reads ahead are limited too
+			job->imgInfo.getImage().prefetch();
+			return job;
+		});
+
+		for (const auto &maze : mazePoints) {
+			points.append(maze);
+		}
+
+		result = failed;
+	}
+
+	if (batch && !points.save(options.pointsFile)) {
+		std::cout << "The file with path points cannot be generated!\n";
+		result = 1;
+	}
+
+	if (!options.trace.empty() && !Trace::save(options.trace)) {
+		std::cout << "The trace file cannot be generated!\n";
+		result = 1;
+	}
+
+	return result;
 }
@@ -0,0 +1,143 @@
+//	Checks that the bidirectional search of the last stage costs the same as the single direction one
+//
+//	Usage: bidirectional_regression [images directory(default ./images)]
+//
+//	Every bundled map is solved with the default options, once with PathFinder::setBidirectional(true).
+//	The cost of the last leg(from the last key to the ending zone) is read from the binary points
+//	file of both paths. Prints the maps whose costs differ and exits with 1 if there is any
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+#include "../src/ImageInfo.h"
+#include "../src/PathFinder.h"
+#include "../src/PathWriter.h"
+
+namespace {
+
+const char *MAPS[] = { "example.bmp", "map1.bmp", "map2.bmp", "map3.bmp", "map4.bmp" };
+
+//	No last leg
+const size_t NO_COST = static_cast<size_t>(-1);
+
+//	Reads the binary points file of a single maze
+class Reader {
+public:
+	explicit Reader(const std::string &data)
+		: m_data(data), m_pos(4) {
+
+	}
+
+	uint64_t varint() {
+		uint64_t value = 0;
+
+		for (unsigned shift = 0; m_pos < m_data.size(); shift += 7) {
+			const auto byte = static_cast<unsigned char>(m_data[m_pos++]);
+			value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+
+			if (!(byte & 0x80)) {
+				break;
+			}
+		}
+
+		return value;
+	}
+
+	int64_t delta() {
+		const uint64_t value = varint();
+		return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+	}
+
+	void skip(size_t count) {
+		m_pos += count;
+	}
+
+private:
+	const std::string &m_data;
+	size_t m_pos;
+};
+
+//	Cost of the last leg with the default steps(a diagonal step costs 2), NO_COST if there is no path
+size_t lastLegCost(const std::string &path, bool bidirectional) {
+	Image img(path);
+	if (!img.loadImage()) {
+		std::cout << "Could not load " << path << '\n';
+		return NO_COST;
+	}
+
+	ImageInfo info(std::move(img));
+	info.analyzeImage();
+
+	PathFinder finder(info);
+	finder.setBidirectional(bidirectional);
+
+	if (!finder.findPath()) {
+		std::cout << "No path in " << path << '\n';
+		return NO_COST;
+	}
+
+	const std::string pointsPath = "bidirectional_regression_points.bin";
+
+	PathWriter writer(PathWriter::Format::BINARY);
+	finder.appendPathPoints(writer);
+	if (!writer.save(pointsPath)) {
+		std::cout << "Could not write " << pointsPath << '\n';
+		return NO_COST;
+	}
+
+	std::ifstream ifile(pointsPath, std::ios::binary);
+	const std::string data((std::istreambuf_iterator<char>(ifile)), std::istreambuf_iterator<char>());
+
+	ifile.close();
+	std::remove(pointsPath.c_str());
+
+	Reader reader(data);
+	reader.skip(reader.varint());
+
+	size_t cost = NO_COST;
+
+	for (uint64_t segments = reader.varint(); segments > 0; --segments) {
+		const uint64_t points = reader.varint();
+		reader.varint();
+
+		//	The first point of a leg is the last one of the previous leg
+		cost = 0;
+
+		for (uint64_t i = 0; i < points; ++i) {
+			const int64_t dx = reader.delta();
+			const int64_t dy = reader.delta();
+
+			if (i > 0) {
+				cost += static_cast<size_t>(std::llabs(dx) + std::llabs(dy));
+			}
+		}
+	}
+
+	return cost;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	const std::string images = argc > 1 ? argv[1] : "images";
+	size_t failed = 0;
+
+	for (const char *map : MAPS) {
+		const size_t single = lastLegCost(images + "/" + map, false);
+		const size_t both = lastLegCost(images + "/" + map, true);
+
+		if (single == NO_COST || single != both) {
+			std::cout << map << ": the last leg costs " << single << " from the start and " << both << " from both ends\n";
+			++failed;
+		}
+	}
+
+	std::cout << (failed == 0 ? "All last legs cost the same\n" : "Some last legs differ\n");
+
+	return failed == 0 ? 0 : 1;
+}
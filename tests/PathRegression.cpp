@@ -0,0 +1,91 @@
+//	Checks paths of the bundled maps against points that earlier versions lost
+//
+//	Usage: path_regression [images directory(default ./images)]
+//
+//	Every case solves a map with the default options and looks for points that have to be in
+//	its path. Prints the missing points and exits with 1 if any is missing
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/ImageInfo.h"
+#include "../src/PathFinder.h"
+#include "../src/PathWriter.h"
+
+namespace {
+
+struct Case {
+	std::string image;
+	std::vector<std::string> points;		//	Lines of the text points file
+};
+
+//	addNewPath() dropped a turn point between two jumps of the same length, so the segment cut
+//	the corner of a wall
+const Case CASES[] = {
+	{ "map2.bmp", { "26 114", "44 280" } },
+};
+
+//	Returns the lines of the text points file of the path, empty if there is no path
+std::vector<std::string> solve(const std::string &path) {
+	Image img(path);
+	if (!img.loadImage()) {
+		std::cout << "Could not load " << path << '\n';
+		return {};
+	}
+
+	ImageInfo info(std::move(img));
+	info.analyzeImage();
+
+	PathFinder finder(info);
+	if (!finder.findPath()) {
+		std::cout << "No path in " << path << '\n';
+		return {};
+	}
+
+	const std::string pointsPath = "path_regression_points.txt";
+
+	PathWriter writer;
+	finder.appendPathPoints(writer);
+	if (!writer.save(pointsPath)) {
+		std::cout << "Could not write " << pointsPath << '\n';
+		return {};
+	}
+
+	std::vector<std::string> lines;
+	std::ifstream ifile(pointsPath);
+
+	for (std::string line; std::getline(ifile, line); ) {
+		lines.push_back(line);
+	}
+
+	ifile.close();
+	std::remove(pointsPath.c_str());
+
+	return lines;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	const std::string images = argc > 1 ? argv[1] : "images";
+	size_t failed = 0;
+
+	for (const auto &test : CASES) {
+		const auto lines = solve(images + "/" + test.image);
+
+		for (const auto &point : test.points) {
+			if (std::find(lines.begin(), lines.end(), point) == lines.end()) {
+				std::cout << test.image << ": the point " << point << " is missing\n";
+				++failed;
+			}
+		}
+	}
+
+	std::cout << (failed == 0 ? "All points found\n" : "Some points are missing\n");
+
+	return failed == 0 ? 0 : 1;
+}
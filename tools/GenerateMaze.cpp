@@ -0,0 +1,128 @@
+//	Generates a maze for the solver
+//
+//	Usage: generate_maze [options] output.bmp
+//		--width=N, --height=N	size of the maze in pixels(default 1024x1024)
+//		--corridor=N			width of the corridors in pixels(default 8)
+//		--wall=N				thickness of the walls in pixels(default 4)
+//		--depth=N				number of doors between the start and the ending zones(default 2)
+//		--decoys=N				number of keys without doors(default 0)
+//		--ends=N				number of ending zones(default 1)
+//		--unsolvable			leaves out the key of the last door
+//		--seed=N				seed of the random choices(default 1)
+//		--threads=N				generating threads, 0 means one for every core(default 0)
+//		--answer				solves the maze and writes the answer next to it(output_answer.txt)
+//
+//	The same options and seed always give the same maze, for any number of threads
+
+#include <exception>
+#include <iostream>
+#include <string>
+
+#include "../src/MazeGenerator.h"
+
+namespace {
+
+struct Options {
+	MazeGenerator::Params params;
+	unsigned threads = 0;
+	bool answer = false;
+	std::string path;
+};
+
+//	Returns *false* if the argument is not valid
+bool parseArgument(const std::string &arg, Options &options) {
+	const size_t eq = arg.find('=');
+	const std::string name = arg.substr(0, eq);
+	const std::string value = eq == std::string::npos ? std::string() : arg.substr(eq + 1);
+
+	if (name == "--width") {
+		options.params.width = static_cast<uint32_t>(std::stoul(value));
+	}
+	else if (name == "--height") {
+		options.params.height = static_cast<uint32_t>(std::stoul(value));
+	}
+	else if (name == "--corridor") {
+		options.params.corridor = static_cast<uint32_t>(std::stoul(value));
+	}
+	else if (name == "--wall") {
+		options.params.wall = static_cast<uint32_t>(std::stoul(value));
+	}
+	else if (name == "--depth") {
+		options.params.depth = static_cast<uint32_t>(std::stoul(value));
+	}
+	else if (name == "--decoys") {
+		options.params.decoys = static_cast<uint32_t>(std::stoul(value));
+	}
+	else if (name == "--ends") {
+		options.params.ends = static_cast<uint32_t>(std::stoul(value));
+	}
+	else if (name == "--unsolvable") {
+		options.params.solvable = false;
+	}
+	else if (name == "--seed") {
+		options.params.seed = std::stoull(value);
+	}
+	else if (name == "--threads") {
+		options.threads = static_cast<unsigned>(std::stoul(value));
+	}
+	else if (name == "--answer") {
+		options.answer = true;
+	}
+	else if (arg.compare(0, 2, "--") == 0) {
+		std::cout << "Unknown option: " << arg << '\n';
+		return false;
+	}
+	else {
+		options.path = arg;
+	}
+
+	return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	Options options;
+
+	for (int i = 1; i < argc; ++i) {
+		//	Numeric values are parsed with std::stoul, which throws on invalid input
+		try {
+			if (!parseArgument(argv[i], options)) {
+				return 1;
+			}
+		}
+		catch (std::exception &) {
+			std::cout << "Invalid value: " << argv[i] << '\n';
+			return 1;
+		}
+	}
+
+	if (options.path.empty()) {
+		std::cout << "Usage: generate_maze [--width=N] [--height=N] [--corridor=N] [--wall=N] [--depth=N] [--decoys=N] "
+			"[--ends=N] [--unsolvable] [--seed=N] [--threads=N] [--answer] output.bmp\n";
+		return 1;
+	}
+
+	try {
+		MazeGenerator generator(options.params);
+
+		if (!generator.saveImage(options.path, options.threads)) {
+			return 1;
+		}
+
+		if (options.answer) {
+			std::string answerPath = options.path.substr(0, options.path.rfind('.'));
+			answerPath.append("_answer.txt");
+
+			if (!MazeGenerator::saveAnswer(answerPath, generator.solve(options.threads))) {
+				return 1;
+			}
+		}
+	}
+	catch (std::exception &x) {
+		std::cout << x.what() << '\n';
+		return 1;
+	}
+
+	return 0;
+}